@@ -0,0 +1,97 @@
+# Turns kernel files into C++ byte arrays.
+#   cmake -DMODE=sources -DOUTPUT=<header> -DINPUTS=<a.cl,b.cl> -P embed_kernels.cmake
+#       Header with one constexpr array per OpenCL source plus a name lookup table.
+#   cmake -DMODE=spirv -DOUTPUT=<source> -DINPUTS=<mat_mult-float.spv,...> -P embed_kernels.cmake
+#       Source file that registers each SPIR-V module with oclUtil::KernelRegistry at startup.
+#       File names are <kernel>-<type>.spv and map to kernel <kernel>.cl built with -DT=<type>.
+
+function(to_byte_array file out_var)
+    file(READ ${file} content HEX)
+    string(LENGTH "${content}" length)
+    set(result "")
+    set(offset 0)
+    while(offset LESS length)
+        string(SUBSTRING "${content}" ${offset} 32 line)
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " line "${line}")
+        string(APPEND result "${line}\n    ")
+        math(EXPR offset "${offset} + 32")
+    endwhile()
+    string(REGEX REPLACE "[ \n]+$" "" result "${result}")
+    set(${out_var} "${result}" PARENT_SCOPE)
+endfunction()
+
+function(to_identifier name out_var)
+    string(MAKE_C_IDENTIFIER "${name}" identifier)
+    set(${out_var} "${identifier}" PARENT_SCOPE)
+endfunction()
+
+string(REPLACE "," ";" INPUTS "${INPUTS}")
+
+if(MODE STREQUAL "sources")
+    set(arrays "")
+    set(entries "")
+    foreach(input IN LISTS INPUTS)
+        get_filename_component(name ${input} NAME)
+        to_identifier(${name} identifier)
+        to_byte_array(${input} bytes)
+        string(APPEND arrays "inline constexpr unsigned char ${identifier}[] = {\n    ${bytes}\n    0x00\n};\n\n")
+        string(APPEND entries "    EmbeddedKernel{\"${name}\", ${identifier}, sizeof(${identifier}) - 1},\n")
+    endforeach()
+
+    file(WRITE ${OUTPUT}.tmp
+"// Generated by cmake/embed_kernels.cmake, do not edit.
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace embeddedKernels
+{
+
+struct EmbeddedKernel
+{
+    std::string_view name;
+    const unsigned char *data;
+    std::size_t size;
+};
+
+${arrays}inline constexpr EmbeddedKernel all[] = {
+${entries}};
+
+} // namespace embeddedKernels
+")
+elseif(MODE STREQUAL "spirv")
+    set(arrays "")
+    set(registrations "")
+    foreach(input IN LISTS INPUTS)
+        get_filename_component(stem ${input} NAME_WE)
+        string(REGEX MATCH "^(.+)-([a-z0-9]+)$" _ "${stem}")
+        set(kernel "${CMAKE_MATCH_1}.cl")
+        set(type "${CMAKE_MATCH_2}")
+        to_identifier(${stem}_spv identifier)
+        to_byte_array(${input} bytes)
+        string(APPEND arrays "constexpr unsigned char ${identifier}[] = {\n    ${bytes}\n};\n\n")
+        string(APPEND registrations "    registry.registerIl(\"${kernel}\", \"-DT=${type}\", ${identifier}, sizeof(${identifier}));\n")
+    endforeach()
+
+    file(WRITE ${OUTPUT}.tmp
+"// Generated by cmake/embed_kernels.cmake, do not edit.
+#include \"kernel_registry.hpp\"
+
+namespace
+{
+
+${arrays}const bool registered = []()
+{
+    auto &registry = oclUtil::KernelRegistry::instance();
+${registrations}    return true;
+}();
+
+} // namespace
+")
+else()
+    message(FATAL_ERROR "Unknown embed mode: ${MODE}")
+endif()
+
+configure_file(${OUTPUT}.tmp ${OUTPUT} COPYONLY)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "matrix.hpp"
+
+#include <boost/numeric/ublas/matrix.hpp>
+
+#ifdef HAVE_CBLAS
+#include <cblas.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace baselines
+{
+
+// cblas only has floating point gemm.
+template<typename T>
+inline constexpr bool blasSupports =
+#ifdef HAVE_CBLAS
+    std::is_same_v<T, float> || std::is_same_v<T, double>;
+#else
+    false;
+#endif
+
+} // namespace baselines
+
+// Reference uBLAS product. The operands are copied into uBLAS matrices first, which is O(n^2) against the
+// O(n^3) product and is part of the measured time.
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::Ublas, MatrixA, MatrixB> 
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b) 
+    {
+        using DataT = typename MatrixA::DataT;
+        using UblasMatrix = boost::numeric::ublas::matrix<DataT, boost::numeric::ublas::row_major, std::vector<DataT>>;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+
+        const UblasMatrix ua(MatrixA::Rows, MatrixA::Columns, std::vector<DataT>(a.data().begin(), a.data().end()));
+        const UblasMatrix ub(MatrixB::Rows, MatrixB::Columns, std::vector<DataT>(b.data().begin(), b.data().end()));
+        UblasMatrix uc(MatrixA::Rows, MatrixB::Columns);
+        boost::numeric::ublas::noalias(uc) = boost::numeric::ublas::prod(ua, ub);
+
+        ResultMatrix result;
+        std::ranges::copy(uc.data(), result.data().begin());
+        return result;
+    }
+};
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::Blas, MatrixA, MatrixB> 
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b) 
+    {
+        using DataT = typename MatrixA::DataT;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
+#ifdef HAVE_CBLAS
+        constexpr int M = MatrixA::Rows;
+        constexpr int N = MatrixB::Columns;
+        constexpr int K = MatrixA::Columns;
+        if constexpr (std::is_same_v<DataT, float>)
+        {
+            cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, M, N, K, 1.0f, a.data().data(), K, 
+                        b.data().data(), N, 0.0f, result.data().data(), N);
+        } else if constexpr (std::is_same_v<DataT, double>)
+        {
+            cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, M, N, K, 1.0, a.data().data(), K, 
+                        b.data().data(), N, 0.0, result.data().data(), N);
+        } else
+        {
+            throw std::runtime_error("cblas has no gemm for this data type");
+        }
+#else
+        (void)a;
+        (void)b;
+        throw std::runtime_error("Built without cblas, reconfigure with a BLAS library and cblas.h available");
+#endif
+        return result;
+    }
+};
@@ -1,51 +1,143 @@
 #pragma once
 
+#include "benchmark_stats.hpp"
+#include "cache_control.hpp"
 #include "constants.hpp"
+#include "energy.hpp"
 #include "matrix.hpp"
+#include "memory_stats.hpp"
 #include "ocl_utils.hpp"
+#include "perf_counters.hpp"
 #include "thread_pool.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
+#include "verification.hpp"
 
 #include <boost/json.hpp>
 
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <filesystem>
 #include <format>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <string_view>
+#include <vector>
 
 namespace Benchmarks 
 {
 inline constexpr const uint32_t DEFAULT_TASK_COUNT = 5;
 
+struct RunnerConfig
+{
+    uint32_t warmupIterations = 1;
+    uint32_t minIterations = DEFAULT_TASK_COUNT;
+    uint32_t maxIterations = 100;
+    // Stop once the 95% confidence interval of the mean is within this fraction of the mean.
+    double targetRelativeCi = 0.02;
+    // Stop once this much wall time has been spent measuring, as long as minIterations have run.
+    double timeBudgetSeconds = 2.0;
+    // Modified z-score above which a sample is treated as an outlier, 0 disables rejection.
+    double outlierThreshold = 3.5;
+    // Count hardware events around each timed compute() call, see perf::PerfCounterGroup.
+    bool hardwareCounters = true;
+    // Read package and DRAM energy around each timed compute() call, see energy::EnergyMeter.
+    bool energy = true;
+    // Benchmarks prepare their operands in setUp() according to this mode.
+    cache::Mode cacheMode = cache::Mode::Warm;
+    // Check of the last result after the timed iterations, see Benchmark::verify.
+    verification::Config verification{};
+};
+
+inline RunnerConfig &defaultRunnerConfig()
+{
+    static RunnerConfig config;
+    return config;
+}
+
 class Runner 
 {
 public:
+    Runner() : m_config(defaultRunnerConfig()) {}
+
+    // Runs at least max(TaskCount, minIterations) iterations. Iterations that throw are logged and left out
+    // of the statistics; outliers are rejected before the stopping rule and the final statistics are evaluated.
     template<uint32_t TaskCount = DEFAULT_TASK_COUNT>
     double run() 
     {
-        std::array<double, TaskCount> executionTimes;
-        for (uint32_t i = TaskCount; i > 0; --i)
+        const uint32_t minIterations = std::max({TaskCount, m_config.minIterations, 1u});
+        const uint32_t maxIterations = std::max(minIterations, m_config.maxIterations);
+
+        m_executionTimes.clear();
+        m_failedIterations = 0;
+        m_outliersRejected = 0;
+        m_counterTotals = {};
+        if (m_config.hardwareCounters && not m_counters)
+        {
+            m_counters = std::make_unique<perf::PerfCounterGroup>();
+        }
+        m_energyTotals = {};
+        m_allocationTotals = {};
+        m_peakResidentSetReset = memory::resetPeakResidentSet();
+        if (m_config.energy && not m_energyMeter)
         {
-            try 
+            m_energyMeter = std::make_unique<energy::EnergyMeter>();
+        }
+
+        for (uint32_t i = 0; i < m_config.warmupIterations; ++i)
+        {
+            runIteration(nullptr, nullptr);
+        }
+
+        const auto budgetStart{std::chrono::steady_clock::now()};
+        for (uint32_t attempt = 1; attempt <= maxIterations; ++attempt)
+        {
+            perf::CounterValues counters;
+            energy::EnergyValues energy;
+            if (auto seconds = runIteration(&counters, &energy))
             {
-                this->setUp();
-                const auto start{std::chrono::high_resolution_clock::now()};
-                this->compute();
-                const auto finish{std::chrono::high_resolution_clock::now()};
-                executionTimes[TaskCount - i] = std::chrono::duration<double>{finish - start}.count();
-            } catch (const std::runtime_error &e) 
+                m_executionTimes.push_back(*seconds);
+                m_counterTotals += counters;
+                m_energyTotals += energy;
+            } else
             {
-                std::cerr << e.what() << '\n';
+                ++m_failedIterations;
             }
+
+            if (attempt < minIterations) continue;
+
+            updateStatistics();
+            const double elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - budgetStart}.count();
+            if (m_statistics.count > 1 && m_statistics.relativeCi <= m_config.targetRelativeCi) break;
+            if (elapsed >= m_config.timeBudgetSeconds) break;
         }
-        m_averageExecutionTime = std::accumulate(executionTimes.begin(), executionTimes.end(), 0.0) / static_cast<double>(TaskCount);
+
+        updateStatistics();
+        m_averageExecutionTime = m_statistics.mean;
         return m_averageExecutionTime;
     }
+
+    RunnerConfig &config() { return m_config; }
+    const SampleStatistics &statistics() const { return m_statistics; }
+    uint32_t failedIterations() const { return m_failedIterations; }
+    size_t outliersRejected() const { return m_outliersRejected; }
+    // Summed over the successful timed iterations, outliers included.
+    const perf::CounterValues &counterTotals() const { return m_counterTotals; }
+    const perf::PerfCounterGroup *counters() const { return m_counters.get(); }
+    // Summed like counterTotals().
+    const energy::EnergyValues &energyTotals() const { return m_energyTotals; }
+    const energy::EnergyMeter *energyMeter() const { return m_energyMeter.get(); }
+    // Summed over the timed compute() calls of successful iterations, peak live bytes is the maximum.
+    const memory::AllocationStats &allocationTotals() const { return m_allocationTotals; }
 protected:
     virtual void setUp() { return; }
 
@@ -53,9 +145,124 @@ protected:
 
     const double &getAvgExecutionTime() { return m_averageExecutionTime; }
 
+    RunnerConfig m_config;
+    std::vector<double> m_executionTimes;
+    SampleStatistics m_statistics;
+    uint32_t m_failedIterations = 0;
+    size_t m_outliersRejected = 0;
+    std::unique_ptr<perf::PerfCounterGroup> m_counters;
+    perf::CounterValues m_counterTotals;
+    std::unique_ptr<energy::EnergyMeter> m_energyMeter;
+    energy::EnergyValues m_energyTotals;
+    memory::AllocationStats m_allocationTotals;
+    bool m_peakResidentSetReset = false;
     double m_averageExecutionTime = 0;
+private:
+    std::optional<double> runIteration(perf::CounterValues *counters, energy::EnergyValues *energy)
+    {
+        const bool counting = counters && m_counters && m_counters->available();
+        const bool metering = energy && m_energyMeter && m_energyMeter->available();
+        try 
+        {
+            {
+                TRACE_SCOPE("setUp", "runner");
+                this->setUp();
+            }
+            TRACE_SCOPE("compute", "runner");
+            if (metering) m_energyMeter->start();
+            if (counting) m_counters->start();
+            if (counters) memory::beginRegion();
+            const auto start{std::chrono::steady_clock::now()};
+            this->compute();
+            const auto finish{std::chrono::steady_clock::now()};
+            if (counters) m_allocationTotals += memory::endRegion();
+            if (counting) *counters = m_counters->stop();
+            if (metering) *energy = m_energyMeter->stop();
+            return std::chrono::duration<double>{finish - start}.count();
+        } catch (const std::exception &e) 
+        {
+            if (counters) memory::endRegion();
+            if (counting) m_counters->stop();
+            if (metering) m_energyMeter->stop();
+            std::cerr << e.what() << '\n';
+            return std::nullopt;
+        }
+    }
+
+    void updateStatistics()
+    {
+        const auto kept = m_config.outlierThreshold > 0.0 
+            ? rejectOutliers(m_executionTimes, m_config.outlierThreshold, &m_outliersRejected)
+            : m_executionTimes;
+        m_statistics = computeStatistics(kept);
+    }
+};
+
+// Destination of benchmark records: pretty printed JSON objects (what the GUI reads) or one object per line.
+class ResultSink
+{
+public:
+    enum class Format
+    {
+        Pretty = 0,
+        Ndjson
+    };
+
+    static Format formatFromString(std::string_view str)
+    {
+        const std::string strLower = util::toLower(str);
+        if (strLower == "pretty" || strLower == "json") { return Format::Pretty; }
+        if (strLower == "ndjson") { return Format::Ndjson; }
+        throw std::invalid_argument("Unknown output format: " + std::string(str));
+    }
+
+    void setFormat(Format format) { m_format = format; }
+
+    // Called with every record once it has been written, e.g. to persist it in a ResultsStore.
+    void setObserver(std::function<void(const boost::json::object &)> observer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_observer = std::move(observer);
+    }
+
+    // "-" writes to stdout, anything else is appended to.
+    void open(const std::filesystem::path &path)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_file.close();
+        if (path == "-") return;
+
+        m_file.open(path, std::ios::app);
+        if (not m_file) throw std::runtime_error("Failed to open output file " + path.string());
+    }
+
+    void write(const boost::json::object &record)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::ostream &os = m_file.is_open() ? static_cast<std::ostream &>(m_file) : std::cout;
+        if (m_format == Format::Ndjson)
+        {
+            os << boost::json::serialize(record) << '\n';
+        } else
+        {
+            util::prettyPrint(os, record);
+        }
+        os.flush();
+        if (m_observer) m_observer(record);
+    }
+private:
+    std::ofstream m_file;
+    std::function<void(const boost::json::object &)> m_observer;
+    Format m_format = Format::Pretty;
+    std::mutex m_mutex;
 };
 
+inline ResultSink &defaultResultSink()
+{
+    static ResultSink sink;
+    return sink;
+}
+
 template<typename Derived>
 class Benchmark : protected Runner 
 {
@@ -64,17 +271,49 @@ public:
 
     void measure() 
     {
+        TRACE_SCOPE(trace::intern(m_name), "benchmark");
         run<Derived::taskCount>();
-        util::prettyPrint(std::cout, getOutput());
-        std::cout.flush();
+        if (m_statistics.count > 0 && m_config.verification.rounds > 0)
+        {
+            TRACE_SCOPE("verify", "runner");
+            verify();
+        }
+        defaultResultSink().write(getOutput());
     };
 private:
     boost::json::object getOutput() const 
     {
         boost::json::object output;
         output["name"] = m_name;
-        output["times_executed"] = Derived::taskCount;
+        output["times_executed"] = m_statistics.count;
         output["avg_execution_time_seconds"] = m_averageExecutionTime;
+        output["min_execution_time_seconds"] = m_statistics.min;
+        output["median_execution_time_seconds"] = m_statistics.median;
+        output["p90_execution_time_seconds"] = m_statistics.p90;
+        output["p99_execution_time_seconds"] = m_statistics.p99;
+        output["stddev_execution_time_seconds"] = m_statistics.stddev;
+        output["mad_execution_time_seconds"] = m_statistics.mad;
+        if (std::isfinite(m_statistics.relativeCi)) output["relative_ci"] = m_statistics.relativeCi;
+        output["warmup_iterations"] = m_config.warmupIterations;
+        output["cache_mode"] = cache::toString(m_config.cacheMode);
+        output["outliers_rejected"] = m_outliersRejected;
+        output["failed_iterations"] = m_failedIterations;
+        if (m_counters)
+        {
+            auto counters = perf::toJson(m_counterTotals, static_cast<uint32_t>(m_executionTimes.size()), flopsPerIteration());
+            if (not m_counters->available()) counters["reason"] = m_counters->unavailableReason();
+            output["perf_counters"] = counters;
+        }
+        if (m_energyMeter)
+        {
+            const double timedSeconds = std::accumulate(m_executionTimes.begin(), m_executionTimes.end(), 0.0);
+            auto energy = energy::toJson(m_energyTotals, static_cast<uint32_t>(m_executionTimes.size()), timedSeconds, 
+                                         flopsPerIteration());
+            if (not m_energyMeter->available()) energy["reason"] = m_energyMeter->unavailableReason();
+            output["energy"] = energy;
+        }
+        output["memory"] = memory::toJson(m_allocationTotals, static_cast<uint32_t>(m_executionTimes.size()),
+                                          memory::processMemory(), m_peakResidentSetReset);
         injectOutputParams(output);
 
         return output;
@@ -82,6 +321,12 @@ private:
 protected: 
     virtual void injectOutputParams(boost::json::object &) const { return; }
 
+    // Untimed check of the result of the last iteration, reported through injectOutputParams.
+    virtual void verify() { return; }
+
+    // Used to normalize counter totals, 0 when the benchmark has no meaningful flop count.
+    virtual double flopsPerIteration() const { return 0.0; }
+
     std::string m_name;
 };
 
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace Benchmarks
+{
+
+struct SampleStatistics
+{
+    size_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double median = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double stddev = 0.0;
+    double mad = 0.0;
+    // Half width of the 95% confidence interval of the mean divided by the mean.
+    double relativeCi = 0.0;
+};
+
+// Linear interpolation between closest ranks, q in [0, 1]. Expects sorted samples.
+inline double percentile(const std::vector<double> &sorted, double q)
+{
+    if (sorted.empty()) throw std::invalid_argument("percentile of an empty sample");
+    if (q < 0.0 || q > 1.0) throw std::invalid_argument("percentile rank must be in [0, 1]");
+
+    const double rank = q * static_cast<double>(sorted.size() - 1);
+    const size_t lower = static_cast<size_t>(std::floor(rank));
+    const size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (rank - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+}
+
+inline double median(std::vector<double> samples)
+{
+    std::ranges::sort(samples);
+    return percentile(samples, 0.5);
+}
+
+// Median absolute deviation, unscaled.
+inline double medianAbsoluteDeviation(const std::vector<double> &samples)
+{
+    const double center = median(samples);
+    std::vector<double> deviations(samples.size());
+    std::ranges::transform(samples, deviations.begin(), [center](double x) { return std::abs(x - center); });
+    return median(std::move(deviations));
+}
+
+// Two-sided 95% Student t quantile, falls back to the normal quantile for large samples.
+inline double studentT95(size_t degreesOfFreedom)
+{
+    constexpr std::array<double, 30> table =
+    {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (degreesOfFreedom == 0) return std::numeric_limits<double>::infinity();
+    return degreesOfFreedom <= table.size() ? table[degreesOfFreedom - 1] : 1.960;
+}
+
+inline SampleStatistics computeStatistics(std::vector<double> samples)
+{
+    SampleStatistics stats;
+    stats.count = samples.size();
+    if (samples.empty()) return stats;
+
+    std::ranges::sort(samples);
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = percentile(samples, 0.5);
+    stats.p90 = percentile(samples, 0.9);
+    stats.p99 = percentile(samples, 0.99);
+    stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    stats.mad = medianAbsoluteDeviation(samples);
+
+    if (samples.size() > 1)
+    {
+        const double squares = std::accumulate(samples.begin(), samples.end(), 0.0,
+                                               [&stats](double acc, double x) { return acc + (x - stats.mean) * (x - stats.mean); });
+        stats.stddev = std::sqrt(squares / static_cast<double>(samples.size() - 1));
+        const double halfWidth = studentT95(samples.size() - 1) * stats.stddev / std::sqrt(static_cast<double>(samples.size()));
+        stats.relativeCi = stats.mean > 0.0 ? halfWidth / stats.mean : 0.0;
+    } else
+    {
+        stats.relativeCi = std::numeric_limits<double>::infinity();
+    }
+
+    return stats;
+}
+
+// Drops samples whose modified z-score (0.6745 * |x - median| / MAD) exceeds threshold. Samples are kept as they are
+// when there are too few of them or the MAD is zero, since the spread cannot be estimated then.
+inline std::vector<double> rejectOutliers(const std::vector<double> &samples, double threshold, size_t *rejected = nullptr)
+{
+    std::vector<double> kept;
+    const double mad = samples.size() < 3 ? 0.0 : medianAbsoluteDeviation(samples);
+    if (mad == 0.0)
+    {
+        kept = samples;
+    } else
+    {
+        const double center = median(samples);
+        std::ranges::copy_if(samples, std::back_inserter(kept), 
+                             [&](double x) { return 0.6745 * std::abs(x - center) / mad <= threshold; });
+    }
+
+    if (rejected) *rejected = samples.size() - kept.size();
+    return kept;
+}
+
+// Regularized incomplete beta function I_x(a, b), continued fraction evaluated with the modified Lentz method.
+inline double incompleteBeta(double a, double b, double x)
+{
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    if (x > (a + 1.0) / (a + b + 2.0)) return 1.0 - incompleteBeta(b, a, 1.0 - x);
+
+    constexpr double tiny = 1e-300;
+    constexpr double epsilon = 1e-14;
+    const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x)) / a;
+
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    d = 1.0 / (std::abs(d) < tiny ? tiny : d);
+    double result = d;
+    for (int m = 1; m <= 300; ++m)
+    {
+        for (int step = 0; step < 2; ++step)
+        {
+            const double numerator = step == 0 
+                ? m * (b - m) * x / ((a + 2.0 * m - 1.0) * (a + 2.0 * m))
+                : -(a + m) * (a + b + m) * x / ((a + 2.0 * m) * (a + 2.0 * m + 1.0));
+            d = 1.0 + numerator * d;
+            d = 1.0 / (std::abs(d) < tiny ? tiny : d);
+            c = 1.0 + numerator / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            result *= c * d;
+        }
+        if (std::abs(c * d - 1.0) < epsilon) break;
+    }
+    return front * result;
+}
+
+inline double studentTCdf(double t, double degreesOfFreedom)
+{
+    const double tail = 0.5 * incompleteBeta(0.5 * degreesOfFreedom, 0.5, degreesOfFreedom / (degreesOfFreedom + t * t));
+    return t > 0.0 ? 1.0 - tail : tail;
+}
+
+struct WelchResult
+{
+    double t = 0.0;
+    double degreesOfFreedom = 0.0;
+    // One-sided p-value for the alternative "mean of b is larger than mean of a".
+    double pValue = 1.0;
+};
+
+inline WelchResult welchTTest(double meanA, double stddevA, size_t countA, double meanB, double stddevB, size_t countB)
+{
+    WelchResult result;
+    if (countA < 2 || countB < 2) return result;
+
+    const double varA = stddevA * stddevA / static_cast<double>(countA);
+    const double varB = stddevB * stddevB / static_cast<double>(countB);
+    const double standardError = std::sqrt(varA + varB);
+    if (standardError == 0.0)
+    {
+        result.pValue = meanB > meanA ? 0.0 : 1.0;
+        return result;
+    }
+
+    result.t = (meanB - meanA) / standardError;
+    result.degreesOfFreedom = (varA + varB) * (varA + varB) 
+        / (varA * varA / static_cast<double>(countA - 1) + varB * varB / static_cast<double>(countB - 1));
+    result.pValue = 1.0 - studentTCdf(result.t, result.degreesOfFreedom);
+    return result;
+}
+
+} // namespace Benchmarks
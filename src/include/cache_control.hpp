@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace cache
+{
+
+// State of the caches when a timed iteration starts.
+//  Warm:     the operands are read once, untimed, right before the iteration.
+//  Cold:     the operands are flushed from every cache level before the iteration.
+//  Rotating: the benchmark cycles through enough distinct operand sets to overflow the last level cache, so every
+//            iteration finds its inputs evicted by the traffic of the previous ones.
+enum class Mode
+{
+    Warm = 0,
+    Cold,
+    Rotating,
+    Last
+};
+
+std::string toString(Mode mode);
+Mode modeFromString(std::string_view str);
+
+// Largest data or unified cache reported by sysfs, 32 MiB when it cannot be read.
+size_t lastLevelCacheBytes();
+
+// Reads one byte per cache line of the buffer.
+void touch(std::span<const std::byte> buffer);
+
+// Writes the buffer back and invalidates it in all cache levels, with clflush where available. Elsewhere the
+// whole last level cache is evicted by streaming through a buffer twice its size.
+void flush(std::span<const std::byte> buffer);
+
+// Operand sets of setBytes each needed to cycle through twice the last level cache, at least 2.
+size_t rotatingSetCount(size_t setBytes, size_t maxSets = 4096);
+
+template<typename Range>
+std::span<const std::byte> bytesOf(const Range &range)
+{
+    return std::as_bytes(std::span(range.data(), range.size()));
+}
+
+} // namespace cache
@@ -16,4 +16,8 @@ inline constexpr const int DEFAULT_MATRIX_ORDER = 256;
 
 inline const std::filesystem::path KERNELS_DIR = std::filesystem::path("..") / "kernels";
 inline const std::filesystem::path KERNELS_BIN_DIR = KERNELS_DIR / "bin";
+inline const std::filesystem::path OCL_TUNING_DB_PATH = "ocl_tuning_db.json";
+inline const std::filesystem::path SIMD_TUNING_DB_PATH = "simd_tuning_db.json";
+inline const std::filesystem::path AUTO_CALIBRATION_PATH = "auto_calibration.json";
+inline const std::filesystem::path RESULTS_DIR = "results";
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "benchmark.hpp"
+#include "matrix_benchmarks.hpp"
+#include "thread_pool.hpp"
+#include "thread_team.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+// Ways of running one short task on each of N threads and waiting for all of them.
+enum class DispatchMechanism
+{
+    // A std::thread per task, what MultithreadSimd did for every product.
+    Threads = 0,
+    // ThreadPool tasks, woken through its condition variable, counted down by the last one to finish.
+    ThreadPool,
+    // ThreadTeam::tryRun, the caller being one of the N.
+    ThreadTeam
+};
+
+inline std::string toString(DispatchMechanism mechanism)
+{
+    switch (mechanism)
+    {
+        case DispatchMechanism::Threads: return "Threads";
+        case DispatchMechanism::ThreadPool: return "ThreadPool";
+        default: return "ThreadTeam";
+    }
+}
+
+// ThreadPool median per thread count, the other mechanisms are reported against it.
+inline std::map<uint32_t, double> &threadPoolLatencies()
+{
+    static std::map<uint32_t, double> latencies;
+    return latencies;
+}
+
+// Fork-join latency with empty tasks: every timed iteration dispatches one task per thread and waits for all,
+// so the execution time is the overhead a parallel kernel pays on top of its math.
+class DispatchLatencyBenchmark : public Benchmark<DispatchLatencyBenchmark>
+{
+public:
+    static constexpr uint32_t taskCount = DEFAULT_TASK_COUNT;
+
+    DispatchLatencyBenchmark(DispatchMechanism mechanism, uint32_t threads)
+        : Benchmark<DispatchLatencyBenchmark>("Dispatch_" + toString(mechanism))
+        , m_mechanism(mechanism)
+        , m_threads(threads)
+        , m_counters(threads)
+    {
+        if (mechanism == DispatchMechanism::ThreadPool) m_pool = std::make_unique<ThreadPool>(threads);
+        if (mechanism == DispatchMechanism::ThreadTeam) m_team = std::make_unique<ThreadTeam>(threads);
+    }
+protected:
+    void compute() override
+    {
+        const int threads = static_cast<int>(m_threads);
+        switch (m_mechanism)
+        {
+            case DispatchMechanism::Threads:
+            {
+                std::vector<std::thread> workers;
+                for (int tid = 0; tid < threads; ++tid) workers.emplace_back([this, tid]() { touch(tid); });
+                for (auto &worker : workers) worker.join();
+                break;
+            }
+            case DispatchMechanism::ThreadPool:
+            {
+                m_pending.store(threads);
+                for (int tid = 0; tid < threads; ++tid)
+                {
+                    m_pool->enqueue([this, tid]()
+                    {
+                        touch(tid);
+                        if (m_pending.fetch_sub(1) == 1) m_pending.notify_all();
+                    });
+                }
+                for (int pending = m_pending.load(); pending != 0; pending = m_pending.load()) m_pending.wait(pending);
+                break;
+            }
+            default:
+                m_team->tryRun(threads, [this](int tid, int) { touch(tid); });
+                break;
+        }
+    }
+
+    virtual void injectOutputParams(boost::json::object &obj) const
+    {
+        const double median = this->m_statistics.median;
+        obj["mechanism"] = toString(m_mechanism);
+        obj["threads"] = m_threads;
+        obj["median_latency_us"] = median * 1e6;
+        obj["p99_latency_us"] = this->m_statistics.p99 * 1e6;
+
+        if (m_mechanism == DispatchMechanism::ThreadPool)
+        {
+            threadPoolLatencies()[m_threads] = median;
+            return;
+        }
+        auto it = threadPoolLatencies().find(m_threads);
+        if (it != threadPoolLatencies().end() && median > 0.0)
+        {
+            obj["speedup_vs_thread_pool"] = it->second / median;
+        }
+    }
+private:
+    struct alignas(64) Counter
+    {
+        uint64_t value = 0;
+    };
+
+    void touch(int tid) { ++m_counters[tid].value; }
+
+    DispatchMechanism m_mechanism;
+    uint32_t m_threads;
+    std::vector<Counter> m_counters;
+    std::atomic<int> m_pending{0};
+    std::unique_ptr<ThreadPool> m_pool;
+    std::unique_ptr<ThreadTeam> m_team;
+};
+
+// Mechanism and thread count of every measurement in run order, ThreadPool first at every count so Threads and
+// ThreadTeam are reported relative to it. Defaults to 1, 2, 4, ... hardware threads.
+inline std::vector<std::pair<DispatchMechanism, uint32_t>> dispatchLatencyPoints(std::vector<uint32_t> threadCounts)
+{
+    if (threadCounts.empty()) threadCounts = scalingSteps(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::pair<DispatchMechanism, uint32_t>> points;
+    for (uint32_t threads : threadCounts)
+    {
+        for (DispatchMechanism mechanism : { DispatchMechanism::ThreadPool, DispatchMechanism::Threads, DispatchMechanism::ThreadTeam })
+        {
+            points.emplace_back(mechanism, threads);
+        }
+    }
+    return points;
+}
+
+inline std::vector<std::string> dispatchLatencyPlan(const std::vector<uint32_t> &threadCounts)
+{
+    std::vector<std::string> plan;
+    for (const auto &[mechanism, threads] : dispatchLatencyPoints(threadCounts))
+    {
+        plan.push_back(std::format("{:<20}threads={}", toString(mechanism), threads));
+    }
+    return plan;
+}
+
+inline int runDispatchLatency(const std::vector<uint32_t> &threadCounts)
+{
+    for (const auto &[mechanism, threads] : dispatchLatencyPoints(threadCounts))
+    {
+        DispatchLatencyBenchmark(mechanism, threads).measure();
+    }
+    return 0;
+}
+
+} // namespace Benchmarks
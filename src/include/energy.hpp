@@ -0,0 +1,83 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace energy
+{
+
+enum class Domain
+{
+    Package = 0,
+    Dram,
+    Last
+};
+
+inline constexpr size_t DOMAIN_COUNT = static_cast<size_t>(Domain::Last);
+
+const char *domainName(Domain domain);
+
+struct EnergyValues
+{
+    std::array<double, DOMAIN_COUNT> joules{};
+    std::array<bool, DOMAIN_COUNT> valid{};
+
+    double operator[](Domain domain) const { return joules[static_cast<size_t>(domain)]; }
+    bool has(Domain domain) const { return valid[static_cast<size_t>(domain)]; }
+
+    EnergyValues &operator+=(const EnergyValues &other)
+    {
+        for (size_t i = 0; i < DOMAIN_COUNT; ++i)
+        {
+            joules[i] += other.joules[i];
+            valid[i] = valid[i] || other.valid[i];
+        }
+        return *this;
+    }
+};
+
+// Difference of two readings of a counter that wraps to zero after maxRange, 0 meaning it never wraps.
+uint64_t counterDelta(uint64_t start, uint64_t end, uint64_t maxRange);
+
+// Package and DRAM energy of all sockets, read from the powercap RAPL zones (/sys/class/powercap/intel-rapl*,
+// which recent kernels also expose on AMD) or else from the amd_energy hwmon driver. Counters are in microjoules
+// and updated about every millisecond, so totals over many iterations are more meaningful than single readings.
+// The interface is often root-only; when no zone can be read the meter is unavailable and start()/stop() do
+// nothing.
+class EnergyMeter
+{
+public:
+    EnergyMeter();
+
+    bool available() const { return not m_zones.empty(); }
+    const std::string &unavailableReason() const { return m_reason; }
+
+    void start();
+    EnergyValues stop();
+private:
+    struct Zone
+    {
+        Domain domain = Domain::Package;
+        std::filesystem::path energyFile;
+        uint64_t maxRange = 0;
+        uint64_t startValue = 0;
+    };
+
+    void discoverPowercap();
+    void discoverHwmon();
+
+    std::vector<Zone> m_zones;
+    std::string m_reason;
+};
+
+// Totals over the timed iterations and derived metrics: average watts over the timed seconds and GFLOPS/W
+// (GFLOP per joule) when flopsPerIteration is known.
+boost::json::object toJson(const EnergyValues &totals, uint32_t iterations, double seconds, double flopsPerIteration);
+
+} // namespace energy
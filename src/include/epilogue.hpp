@@ -0,0 +1,157 @@
+#pragma once
+
+#include "simd_traits.hpp"
+
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+namespace epilogue
+{
+
+enum class Activation
+{
+    None = 0,
+    Relu,
+    Gelu
+};
+
+inline std::string toString(Activation activation)
+{
+    switch (activation)
+    {
+        case Activation::Relu: return "relu";
+        case Activation::Gelu: return "gelu";
+        default: return "none";
+    }
+}
+
+// tanh form of GELU, the one the OpenCL kernels use as well.
+template<typename T>
+T gelu(T x)
+{
+    constexpr T sqrtTwoOverPi = T(0.7978845608028654);
+    return T(0.5) * x * (T(1) + std::tanh(sqrtTwoOverPi * (x + T(0.044715) * x * x * x)));
+}
+
+// C = activation(alpha * A * B + bias) + beta * residual, applied to the accumulators of the microkernel right
+// before its single store of C. bias holds one value per column of C, residual has the layout of C with leading
+// dimension ldr and may be C itself, every element is read right before it is overwritten. Every op is a
+// template parameter, so a kernel only contains the ops it uses and Identity reduces to the plain store.
+template<typename T, bool Scale, bool Bias, Activation Act, bool Residual>
+struct Ops
+{
+    static_assert(Act != Activation::Gelu || std::is_floating_point_v<T>, "GELU needs a floating point type");
+
+    using Simd = SimdTraits<T>;
+    using Vec = typename Simd::vec;
+
+    static constexpr bool identity = not Scale && not Bias && Act == Activation::None && not Residual;
+    static constexpr bool scales = Scale;
+    static constexpr bool addsBias = Bias;
+    static constexpr Activation activation = Act;
+    static constexpr bool addsResidual = Residual;
+
+    T alpha = T(1);
+    const T *bias = nullptr;
+    const T *residual = nullptr;
+    int ldr = 0;
+    T beta = T(1);
+
+    // The same epilogue with its operands offset to the tile of C starting at (row, col).
+    Ops at([[maybe_unused]] int row, [[maybe_unused]] int col) const
+    {
+        Ops ops = *this;
+        if constexpr (Bias) ops.bias += col;
+        if constexpr (Residual) ops.residual += row * ldr + col;
+        return ops;
+    }
+
+    Vec operator()(Vec v, int row, int col) const
+    {
+        return apply(v, row, col, [](const T *ptr) { return Simd::load(ptr); });
+    }
+
+    // Partial vector on the right edge, whose operand loads must not read past the last column.
+    Vec operator()(Vec v, int row, int col, __m256i mask) const
+    {
+        return apply(v, row, col, [mask](const T *ptr) { return Simd::maskLoad(ptr, mask); });
+    }
+
+    T scalar(T v, [[maybe_unused]] int row, [[maybe_unused]] int col) const
+    {
+        if constexpr (Scale) v *= alpha;
+        if constexpr (Bias) v += bias[col];
+        if constexpr (Act == Activation::Relu) v = v > T(0) ? v : T(0);
+        else if constexpr (Act == Activation::Gelu) v = gelu(v);
+        if constexpr (Residual) v += beta * residual[row * ldr + col];
+        return v;
+    }
+
+    // What the fused epilogue replaces: one pass over C per enabled op.
+    void applyInPasses(T *c, int rows, int cols, int ldc) const
+    {
+        auto pass = [&](auto op)
+        {
+            for (int i = 0; i < rows; ++i)
+            {
+                for (int j = 0; j < cols; ++j) op(c[i * ldc + j], i, j);
+            }
+        };
+        if constexpr (Scale) pass([this](T &v, int, int) { v *= alpha; });
+        if constexpr (Bias) pass([this](T &v, int, int j) { v += bias[j]; });
+        if constexpr (Act == Activation::Relu) pass([](T &v, int, int) { v = v > T(0) ? v : T(0); });
+        else if constexpr (Act == Activation::Gelu) pass([](T &v, int, int) { v = gelu(v); });
+        if constexpr (Residual) pass([this](T &v, int i, int j) { v += beta * residual[i * ldr + j]; });
+    }
+
+    static std::string description()
+    {
+        if constexpr (identity) return "none";
+        std::string str;
+        auto append = [&str](const std::string &op) { str += (str.empty() ? "" : "+") + op; };
+        if constexpr (Scale) append("scale");
+        if constexpr (Bias) append("bias");
+        if constexpr (Act != Activation::None) append(toString(Act));
+        if constexpr (Residual) append("residual");
+        return str;
+    }
+
+    // Defines that select the same ops in mat_mult.cl. TF is the type the activation is computed in.
+    static std::string oclBuildOptions()
+    {
+        std::string options = std::is_same_v<T, double> ? "-DTF=double" : "-DTF=float";
+        if constexpr (identity) return options;
+        options += " -DEPILOGUE";
+        if constexpr (Scale) options += " -DEPI_SCALE";
+        if constexpr (Bias) options += " -DEPI_BIAS";
+        if constexpr (Act == Activation::Relu) options += " -DEPI_RELU";
+        else if constexpr (Act == Activation::Gelu) options += " -DEPI_GELU";
+        if constexpr (Residual) options += " -DEPI_RESIDUAL";
+        return options;
+    }
+private:
+    template<typename Load>
+    Vec apply(Vec v, [[maybe_unused]] int row, [[maybe_unused]] int col, [[maybe_unused]] Load load) const
+    {
+        if constexpr (Scale) v = Simd::mul(v, Simd::broadcast(alpha));
+        if constexpr (Bias) v = Simd::add(v, load(bias + col));
+        if constexpr (Act == Activation::Relu)
+        {
+            v = Simd::max(v, Simd::zero());
+        } else if constexpr (Act == Activation::Gelu)
+        {
+            alignas(32) T lanes[Simd::width];
+            Simd::store(lanes, v);
+            for (T &lane : lanes) lane = gelu(lane);
+            v = Simd::load(lanes);
+        }
+        if constexpr (Residual) v = Simd::add(v, Simd::mul(Simd::broadcast(beta), load(residual + row * ldr + col)));
+        return v;
+    }
+};
+
+template<typename T>
+using Identity = Ops<T, false, false, Activation::None, false>;
+
+} // namespace epilogue
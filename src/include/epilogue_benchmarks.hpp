@@ -0,0 +1,246 @@
+#pragma once
+
+#include "epilogue.hpp"
+#include "matrix_benchmarks.hpp"
+#include "utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+// The epilogue of a typical dense layer: bias, activation and a skip connection. Integer types use ReLU.
+template<typename T>
+using PipelineEpilogue = epilogue::Ops<T, false, true,
+                                       std::is_floating_point_v<T> ? epilogue::Activation::Gelu : epilogue::Activation::Relu,
+                                       true>;
+
+inline bool supportsEpilogue(MatMultType multType)
+{
+    return multType == MatMultType::Simd || multType == MatMultType::MultithreadSimd || multType == MatMultType::TiledOcl;
+}
+
+// Median of the unfused run per (data type, order, kernel), the fused run of the same point is reported against it.
+inline std::map<std::tuple<std::string, int, MatMultType>, double> &unfusedMedians()
+{
+    static std::map<std::tuple<std::string, int, MatMultType>, double> medians;
+    return medians;
+}
+
+// Multiplication followed by PipelineEpilogue, either fused into the store of the kernel or run as the separate
+// passes over C it replaces.
+template<typename DataType, uint32_t Order, MatMultType MultType, bool Fused>
+class EpilogueBenchmark : public Benchmark<EpilogueBenchmark<DataType, Order, MultType, Fused>>
+{
+    static_assert(MultType == MatMultType::Simd || MultType == MatMultType::MultithreadSimd
+                  || MultType == MatMultType::TiledOcl, "Kernel without an epilogue");
+
+    using MatrixType = Matrix<DataType, Order, Order>;
+    using Impl = MatrixMultImpl<MultType, MatrixType, MatrixType>;
+    using Epi = PipelineEpilogue<DataType>;
+public:
+    static constexpr uint32_t taskCount = DEFAULT_TASK_COUNT;
+
+    EpilogueBenchmark()
+        : Benchmark<EpilogueBenchmark>(std::format("Epilogue_{}_{}", Fused ? "Fused" : "Unfused", util::toString(MultType)))
+    {
+        m_residual.randomFill();
+        // Any row of random values serves as the bias vector.
+        m_bias.assign(m_residual.data().begin(), m_residual.data().begin() + Order);
+        m_residual.randomFill();
+        m_epilogue.bias = m_bias.data();
+        m_epilogue.residual = m_residual.data().data();
+        m_epilogue.ldr = Order;
+    }
+protected:
+    void setUp() override
+    {
+        m_operands.prepare(this->m_config.cacheMode);
+    }
+
+    void compute() override
+    {
+        const MatrixType &a = m_operands.a();
+        const MatrixType &b = m_operands.b();
+        if constexpr (MultType == MatMultType::TiledOcl)
+        {
+            m_matC = Impl::multiply(a, b, m_epilogue, Fused);
+        } else if constexpr (MultType == MatMultType::MultithreadSimd)
+        {
+            const int threadCount = static_cast<int>(effectiveHostThreadCount());
+            if constexpr (Fused)
+            {
+                m_matC = Impl::multiply(a, b, threadCount, m_epilogue);
+            } else
+            {
+                m_matC = Impl::multiply(a, b, threadCount);
+                applyInParallel(threadCount);
+            }
+        } else if constexpr (Fused)
+        {
+            m_matC = Impl::multiply(a, b, m_epilogue);
+        } else
+        {
+            m_matC = Impl::multiply(a, b);
+            m_epilogue.applyInPasses(m_matC.data().data(), Order, Order, Order);
+        }
+    }
+
+    double flopsPerIteration() const override { return 2.0 * Order * Order * Order; }
+
+    virtual void injectOutputParams(boost::json::object &obj) const
+    {
+        obj["data_type"] = typeid(DataType).name();
+        obj["matrix_dims"] = std::format("{}x{}", Order, Order);
+        obj["kernel"] = util::toString(MultType);
+        obj["epilogue"] = Epi::description();
+        obj["fused"] = Fused;
+        m_operands.injectOutputParams(obj);
+        injectRoofline<DataType, Order, Order>(obj, MultType, this->m_statistics.median);
+        if constexpr (MultType == MatMultType::MultithreadSimd)
+        {
+            obj["threads"] = effectiveHostThreadCount();
+        }
+
+        const auto key = std::make_tuple(std::string(typeid(DataType).name()), static_cast<int>(Order), MultType);
+        const double median = this->m_statistics.median;
+        if constexpr (not Fused)
+        {
+            unfusedMedians()[key] = median;
+        } else
+        {
+            auto it = unfusedMedians().find(key);
+            if (it != unfusedMedians().end() && median > 0.0)
+            {
+                obj["unfused_median_seconds"] = it->second;
+                obj["fusion_speedup"] = it->second / median;
+            }
+        }
+    }
+private:
+    // Every worker runs the passes over its own rows, so the unfused variant scales like the fused one.
+    void applyInParallel(int threadCount)
+    {
+        std::vector<std::thread> threads;
+        const int rowsPerThread = (static_cast<int>(Order) + threadCount - 1) / threadCount;
+        for (int rowBegin = 0; rowBegin < static_cast<int>(Order); rowBegin += rowsPerThread)
+        {
+            const int rows = std::min(rowsPerThread, static_cast<int>(Order) - rowBegin);
+            threads.emplace_back([this, rowBegin, rows]()
+            {
+                m_epilogue.at(rowBegin, 0).applyInPasses(&m_matC.data()[rowBegin * Order], rows, Order, Order);
+            });
+        }
+        for (auto &thread : threads) thread.join();
+    }
+
+    MatMultOperands<DataType, Order, Order> m_operands;
+    std::vector<DataType> m_bias;
+    MatrixType m_residual;
+    MatrixType m_matC;
+    Epi m_epilogue;
+};
+
+template<typename DataType, uint32_t Order, MatMultType MultType>
+int runEpiloguePair()
+{
+    EpilogueBenchmark<DataType, Order, MultType, false>().measure();
+    EpilogueBenchmark<DataType, Order, MultType, true>().measure();
+    return 0;
+}
+
+template <typename DataType, MatMultType MultType, size_t... OrderIndices>
+int dispatchEpilogueOrder(int order, std::index_sequence<OrderIndices...>)
+{
+    int result{-1};
+    const bool dispatched = ((order == MatMultOrders[OrderIndices]
+                              && (result = runEpiloguePair<DataType, MatMultOrders[OrderIndices], MultType>(), true)) || ...);
+    if (not dispatched) throw std::runtime_error("Unsupported mat mult order\n");
+    return result;
+}
+
+template <typename DataType>
+int dispatchEpilogue(int order, MatMultType multType)
+{
+    constexpr auto orders = std::make_index_sequence<MatMultOrders.size()>{};
+    switch (multType)
+    {
+        case MatMultType::Simd: return dispatchEpilogueOrder<DataType, MatMultType::Simd>(order, orders);
+        case MatMultType::MultithreadSimd: return dispatchEpilogueOrder<DataType, MatMultType::MultithreadSimd>(order, orders);
+        case MatMultType::TiledOcl: return dispatchEpilogueOrder<DataType, MatMultType::TiledOcl>(order, orders);
+        default: throw std::runtime_error("Unsupported mat mult type\n");
+    }
+}
+
+// What runEpilogueComparison measures, in the same order; kernels without an epilogue are left out.
+inline std::vector<std::string> epiloguePlan(const std::vector<int> &orders, const std::vector<MatMultType> &multTypes,
+                                             const std::vector<MatMultDataType> &dataTypes)
+{
+    std::vector<std::string> plan;
+    for (MatMultType multType : multTypes)
+    {
+        if (not supportsEpilogue(multType)) continue;
+        for (int order : orders)
+        {
+            for (MatMultDataType dataType : dataTypes)
+            {
+                for (const char *path : { "unfused", "fused" })
+                {
+                    plan.push_back(std::format("{:<20}{:<8}{}x{} {}", util::toString(multType),
+                                               util::toString(dataType), order, order, path));
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// Unfused and fused epilogue for every kernel that has one. Kernels without an epilogue and OpenCL kernels
+// without a usable device are skipped with a message.
+inline int runEpilogueComparison(const std::vector<int> &orders, const std::vector<MatMultType> &multTypes,
+                                 const std::vector<MatMultDataType> &dataTypes)
+{
+    for (MatMultType multType : multTypes)
+    {
+        if (not supportsEpilogue(multType))
+        {
+            std::cerr << "Skipping " << util::toString(multType) << ": no fused epilogue\n";
+            continue;
+        }
+        for (int order : orders)
+        {
+            for (MatMultDataType dataType : dataTypes)
+            {
+                try
+                {
+                    switch (dataType)
+                    {
+                        case MatMultDataType::Int32: dispatchEpilogue<int32_t>(order, multType); break;
+                        case MatMultDataType::Uint32: dispatchEpilogue<uint32_t>(order, multType); break;
+                        case MatMultDataType::Float: dispatchEpilogue<float>(order, multType); break;
+                        default: dispatchEpilogue<double>(order, multType); break;
+                    }
+                } catch (const std::exception &e)
+                {
+                    if (multType != MatMultType::TiledOcl) throw;
+                    std::cerr << "Skipping " << util::toString(multType) << ": " << e.what() << '\n';
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace oclUtil
+{
+
+using KernelBinary = std::vector<unsigned char>;
+
+// In-process store of everything needed to create a program without touching the filesystem:
+// kernel sources embedded at build time, SPIR-V modules and device binaries registered at startup
+// by optional generated sources, and binaries built or saved by Program during the run. Binaries are always
+// looked up by build options, a binary built for another type or configuration is never reused.
+class KernelRegistry
+{
+public:
+    static KernelRegistry &instance();
+
+    std::optional<std::string_view> source(std::string_view kernelFilename) const;
+
+    std::vector<std::string_view> sourceNames() const;
+
+    void registerBinary(std::string_view kernelFilename, std::string_view deviceKey, std::string_view options, 
+                        const unsigned char *data, size_t size);
+
+    std::optional<KernelBinary> binary(std::string_view kernelFilename, std::string_view deviceKey, std::string_view options) const;
+
+    void registerIl(std::string_view kernelFilename, std::string_view options, const unsigned char *data, size_t size);
+
+    std::optional<KernelBinary> il(std::string_view kernelFilename, std::string_view options) const;
+private:
+    using BinaryKey = std::tuple<std::string, std::string, std::string>;
+    using IlKey = std::pair<std::string, std::string>;
+
+    std::map<BinaryKey, KernelBinary, std::less<>> m_binaries;
+    std::map<IlKey, KernelBinary, std::less<>> m_ils;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace oclUtil
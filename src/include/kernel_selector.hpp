@@ -0,0 +1,145 @@
+#pragma once
+
+#include "constants.hpp"
+#include "matrix.hpp"
+#include "ocl_utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace kernelSelector
+{
+
+// Backend picked for one multiplication. threads is the worker count of MultithreadSimd and 0 for the others.
+struct Choice
+{
+    MatMultType type = MatMultType::Naive;
+    uint32_t threads = 0;
+
+    std::string description() const
+    {
+        return threads ? std::format("{} threads={}", util::toString(type), threads) : util::toString(type);
+    }
+
+    bool operator==(const Choice &) const = default;
+};
+
+// Backends MatrixMultImpl<MatMultType::Auto> dispatches to, the only ones a crossover may name.
+constexpr bool isSelectable(MatMultType type)
+{
+    return type == MatMultType::Naive || type == MatMultType::Simd || type == MatMultType::MultithreadSimd 
+        || type == MatMultType::TiledOcl;
+}
+
+// Fastest backend measured at an order; it is used from that order up to the next calibrated one.
+struct Crossover
+{
+    int order = 0;
+    Choice choice;
+    double seconds = 0.0;
+};
+
+// Crossover points per data type, produced by calibrate() on this host and persisted as JSON.
+class CrossoverTable
+{
+public:
+    explicit CrossoverTable(std::filesystem::path path) : m_path(std::move(path)) {}
+
+    // Process-wide table at constants::AUTO_CALIBRATION_PATH, loaded on first use.
+    static CrossoverTable &instance();
+
+    std::optional<Choice> lookup(std::string_view dataType, int order) const;
+
+    void store(std::string_view dataType, std::vector<Crossover> crossovers);
+
+    void load();
+
+    void save() const;
+
+    // Bumped on every change so that cached choices can be revalidated cheaply.
+    uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+
+    const std::filesystem::path &path() const { return m_path; }
+private:
+    std::filesystem::path m_path;
+    std::map<std::string, std::vector<Crossover>, std::less<>> m_entries;
+    std::atomic<uint64_t> m_generation{0};
+    mutable std::mutex m_mutex;
+};
+
+// Used without a calibration: spawning threads only pays off once each of them gets a few register blocks of
+// rows, and below the SIMD block size the plain loops win.
+Choice heuristicChoice(int order, uint32_t hardwareThreads = std::thread::hardware_concurrency());
+
+template<typename T>
+Choice select(int order)
+{
+    if (auto choice = CrossoverTable::instance().lookup(oclUtil::getOpenCLTypeName<T>(), order)) return *choice;
+    return heuristicChoice(order);
+}
+
+template<typename T>
+boost::json::object choiceJson(int order)
+{
+    const auto calibrated = CrossoverTable::instance().lookup(oclUtil::getOpenCLTypeName<T>(), order);
+    const Choice choice = calibrated ? *calibrated : heuristicChoice(order);
+    boost::json::object obj;
+    obj["kernel"] = util::toString(choice.type);
+    if (choice.threads) obj["threads"] = choice.threads;
+    obj["source"] = calibrated ? "calibration" : "heuristic";
+    return obj;
+}
+
+// Measures Naive, Simd, MultithreadSimd over 2..N threads and, when a device is available, TiledOcl at every
+// order and data type, then stores the fastest backend per order. Naive is dropped once it loses by a wide margin.
+boost::json::array calibrate(CrossoverTable &table, const std::vector<int> &orders,
+                             const std::vector<MatMultDataType> &dataTypes, uint32_t repeats = 3);
+
+} // namespace kernelSelector
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::Auto, MatrixA, MatrixB>
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b)
+    {
+        const kernelSelector::Choice choice = cachedChoice();
+        switch (choice.type)
+        {
+            case MatMultType::Simd: return MatrixMultImpl<MatMultType::Simd, MatrixA, MatrixB>::multiply(a, b);
+            case MatMultType::MultithreadSimd:
+                return MatrixMultImpl<MatMultType::MultithreadSimd, MatrixA, MatrixB>::multiply(a, b, static_cast<int>(choice.threads));
+            case MatMultType::TiledOcl: return MatrixMultImpl<MatMultType::TiledOcl, MatrixA, MatrixB>::multiply(a, b);
+            default: return MatrixMultImpl<MatMultType::Naive, MatrixA, MatrixB>::multiply(a, b);
+        }
+    }
+private:
+    // The choice only depends on the shape and the table, so it is looked up again only after the table changed.
+    static kernelSelector::Choice cachedChoice()
+    {
+        struct Cached
+        {
+            uint64_t generation = ~0ull;
+            kernelSelector::Choice choice;
+        };
+        thread_local Cached cached;
+
+        const uint64_t generation = kernelSelector::CrossoverTable::instance().generation();
+        if (cached.generation != generation)
+        {
+            cached.choice = kernelSelector::select<typename MatrixA::DataT>(MatrixA::Rows);
+            cached.generation = generation;
+        }
+        return cached.choice;
+    }
+};
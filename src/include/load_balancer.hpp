@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+// Splits work items between workers of different speed. Ratios follow the smoothed
+// throughput measured on previous runs, so repeated runs converge to an even finish.
+class LoadBalancer
+{
+public:
+    explicit LoadBalancer(size_t workerCount, double smoothing = 0.5) : 
+        m_throughput(workerCount, 1.0), 
+        m_measured(workerCount, false),
+        m_smoothing(smoothing) 
+    {
+        if (workerCount == 0) throw std::invalid_argument("LoadBalancer needs at least one worker");
+        if (smoothing <= 0.0 || smoothing > 1.0) throw std::invalid_argument("LoadBalancer smoothing must be in (0, 1]");
+    }
+
+    size_t workerCount() const { return m_throughput.size(); }
+
+    std::vector<double> ratios() const 
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return ratiosUnlocked();
+    }
+
+    // Returns workerCount() + 1 boundaries; worker i owns items [bounds[i], bounds[i + 1]).
+    std::vector<size_t> partition(size_t itemCount) const
+    {
+        const std::vector<double> r = ratios();
+        std::vector<size_t> bounds(r.size() + 1, 0);
+
+        double accumulated = 0.0;
+        for (size_t i = 0; i < r.size(); ++i)
+        {
+            accumulated += r[i];
+            bounds[i + 1] = std::min(itemCount, static_cast<size_t>(accumulated * static_cast<double>(itemCount) + 0.5));
+            bounds[i + 1] = std::max(bounds[i + 1], bounds[i]);
+        }
+        bounds.back() = itemCount;
+        return bounds;
+    }
+
+    // Workers that received no items keep their previous estimate.
+    void update(const std::vector<size_t> &itemsProcessed, const std::vector<double> &secondsTaken)
+    {
+        if (itemsProcessed.size() != workerCount() || secondsTaken.size() != workerCount())
+        {
+            throw std::invalid_argument("LoadBalancer::update size mismatch");
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < workerCount(); ++i)
+        {
+            if (itemsProcessed[i] == 0 || secondsTaken[i] <= 0.0) continue;
+
+            const double measured = static_cast<double>(itemsProcessed[i]) / secondsTaken[i];
+            m_throughput[i] = m_measured[i] 
+                ? (1.0 - m_smoothing) * m_throughput[i] + m_smoothing * measured 
+                : measured;
+            m_measured[i] = true;
+        }
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::ranges::fill(m_throughput, 1.0);
+        std::fill(m_measured.begin(), m_measured.end(), false);
+    }
+private:
+    std::vector<double> ratiosUnlocked() const
+    {
+        // Until every worker has been measured, unmeasured workers get the mean throughput of the others.
+        const size_t measuredCount = static_cast<size_t>(std::ranges::count(m_measured, true));
+        double measuredSum = 0.0;
+        for (size_t i = 0; i < workerCount(); ++i)
+        {
+            if (m_measured[i]) measuredSum += m_throughput[i];
+        }
+        const double fallback = measuredCount ? measuredSum / static_cast<double>(measuredCount) : 1.0;
+
+        std::vector<double> r(workerCount());
+        for (size_t i = 0; i < workerCount(); ++i)
+        {
+            r[i] = m_measured[i] ? m_throughput[i] : fallback;
+        }
+        const double total = std::accumulate(r.begin(), r.end(), 0.0);
+        for (auto &ratio : r) ratio /= total;
+        return r;
+    }
+
+    std::vector<double> m_throughput;
+    std::vector<bool> m_measured;
+    double m_smoothing;
+    mutable std::mutex m_mutex;
+};
@@ -1,18 +1,28 @@
 #pragma once
 
 #include "constants.hpp"
+#include "epilogue.hpp"
+#include "load_balancer.hpp"
+#include "ocl_tuner.hpp"
 #include "ocl_utils.hpp"
 #include "utils.hpp"
 #include "simd_traits.hpp"
+#include "simd_tuner.hpp"
+#include "thread_team.hpp"
+#include "trace.hpp"
 
 #include <CL/cl.h>
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <thread>
+#include <utility>
 #include <vector>
 
 template<typename Mat>
@@ -32,6 +42,18 @@ enum class MatMultType
     MultithreadElement,
     MultithreadSimd,
     NaiveOcl,
+    HeterogeneousOcl,
+    TiledOcl,
+    // Runtime provided parallelism around the same microkernel, see parallel_backends.hpp.
+    OmpStatic,
+    OmpDynamic,
+    OmpGuided,
+    ParUnseq,
+    // Picks one of the above per shape and data type, see kernel_selector.hpp.
+    Auto,
+    // Reference implementations our kernels are compared against, see baseline_kernels.hpp.
+    Ublas,
+    Blas,
     Last
 };
 
@@ -44,6 +66,18 @@ enum class MatMultDataType
     Last 
 };
 
+// Worker count of the multithreaded host kernels, 0 keeps the hardware default.
+inline uint32_t &hostThreadCount()
+{
+    static uint32_t count = 0;
+    return count;
+}
+
+inline uint32_t effectiveHostThreadCount()
+{
+    return hostThreadCount() ? hostThreadCount() : std::max(4u, std::thread::hardware_concurrency());
+}
+
 template<typename T, size_t Size>
 struct MatrixStorage {
     static constexpr bool stackAllocation = false; // (sizeof(T) * Size <= constants::getStackSize() / 100);
@@ -88,6 +122,19 @@ public:
     requires ValidDims<Matrix>
     Matrix() : Matrix(static_cast<DataType>(0)) {}
 
+    // Evaluates a lazy expression such as a * b * c, see matrix_expr.hpp.
+    template<typename Expr>
+    requires requires(const Expr &expr, Matrix &dest) { expr.evaluateInto(dest); }
+    Matrix(const Expr &expr) : Matrix() { expr.evaluateInto(*this); }
+
+    template<typename Expr>
+    requires requires(const Expr &expr, Matrix &dest) { expr.evaluateInto(dest); }
+    Matrix &operator=(const Expr &expr)
+    {
+        expr.evaluateInto(*this);
+        return *this;
+    }
+
     template<MatMultType MultType, typename OtherMatrix>
     requires CompatibleMatrices<Matrix<DataType, Rows, Columns>, OtherMatrix>
     Matrix<DataType, Rows, OtherMatrix::Columns> mult(const OtherMatrix& other) const 
@@ -133,8 +180,9 @@ public:
 #define B(i,j) b[(i) * ldb + (j)]
 #define C(i,j) c[(i) * ldc + (j)]
 
-    template <typename T, int RA, int RB>
-    static void matmul_dot_inner(int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc) 
+    // The epilogue runs on the accumulators right before they are stored, see epilogue.hpp.
+    template <typename T, int RA, int RB, int KU = 1, typename Epi = epilogue::Identity<T>>
+    static void matmul_dot_inner(int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc, const Epi &epi = {}) 
     {
         using Simd = SimdTraits<T>;
         using Vec = typename Simd::vec;
@@ -142,7 +190,7 @@ public:
 
         Vec csum[RA][RB] = {};
 
-        for (int p = 0; p < k; ++p) 
+        auto step = [&](int p)
         {
             for (int bi = 0; bi < RB; ++bi) 
             {
@@ -153,17 +201,59 @@ public:
                     csum[ai][bi] = Simd::add(csum[ai][bi], Simd::mul(aa, bb));
                 }
             }
+        };
+
+        int p = 0;
+        for (; p + KU <= k; p += KU) 
+        {
+            for (int u = 0; u < KU; ++u) step(p + u);
         }
+        for (; p < k; ++p) step(p);
 
         for (int ai = 0; ai < RA; ++ai) 
         {
             for (int bi = 0; bi < RB; ++bi) 
             {
-                Simd::store(&C(ai, bi * W), csum[ai][bi]);
+                Simd::store(&C(ai, bi * W), epi(csum[ai][bi], ai, bi * W));
             }
         }
     }
 
+    // Same register block with a partial last column vector of lastLanes lanes, for the tiles on the right edge.
+    template <typename T, int RA, int RB, typename Epi = epilogue::Identity<T>>
+    static void matmul_dot_edge(int k, const T* a, int lda, const T* b, int ldb, T* c, int ldc, int lastLanes, 
+                                const Epi &epi = {}) 
+    {
+        using Simd = SimdTraits<T>;
+        using Vec = typename Simd::vec;
+        constexpr int W = Simd::width;
+        const auto mask = Simd::mask(lastLanes);
+
+        Vec csum[RA][RB] = {};
+
+        for (int p = 0; p < k; ++p) 
+        {
+            for (int bi = 0; bi < RB; ++bi) 
+            {
+                Vec bb = bi == RB - 1 ? Simd::maskLoad(&B(p, bi * W), mask) : Simd::load(&B(p, bi * W));
+                for (int ai = 0; ai < RA; ++ai) 
+                {
+                    Vec aa = Simd::broadcast(A(ai, p));
+                    csum[ai][bi] = Simd::add(csum[ai][bi], Simd::mul(aa, bb));
+                }
+            }
+        }
+
+        for (int ai = 0; ai < RA; ++ai) 
+        {
+            for (int bi = 0; bi < RB - 1; ++bi) 
+            {
+                Simd::store(&C(ai, bi * W), epi(csum[ai][bi], ai, bi * W));
+            }
+            Simd::maskStore(&C(ai, (RB - 1) * W), mask, epi(csum[ai][RB - 1], ai, (RB - 1) * W, mask));
+        }
+    }
+
 #undef A
 #undef B
 #undef C
@@ -196,46 +286,108 @@ struct MatrixMultImpl<MatMultType::Naive, MatrixA, MatrixB>
 };
 
 
-template <typename MatrixA, typename MatrixB>
-struct MatrixMultImpl<MatMultType::Simd, MatrixA, MatrixB> 
+// Computes one output tile of up to RA rows and RB vectors of columns, shrinking the register block at the
+// bottom and right edges so that partial tiles stay vectorized instead of falling back to scalar loops.
+template <typename T, int RA, int RB, typename Epi = epilogue::Identity<T>>
+void simdEdgeTile(int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, int rows, int cols, const Epi &epi = {})
 {
-    static auto multiply(const MatrixA& a, const MatrixB& b) 
+    constexpr int W = SimdTraits<T>::width;
+    if constexpr (RA > 1)
     {
-        using ResultMatrix = Matrix<typename MatrixA::DataT, MatrixA::Rows, MatrixB::Columns>;
-        ResultMatrix result;
-        constexpr int regsA = 3;
-        constexpr int regsB = 4;
-        constexpr int blockCols = regsB * SimdTraits<typename MatrixA::DataT>::width;
-        constexpr int M = MatrixA::Rows;
-        constexpr int N = MatrixB::Columns;
-        constexpr int K = MatrixA::Columns;
-        constexpr int lda = MatrixA::Columns;
-        constexpr int ldb = MatrixB::Columns;
-        constexpr int ldc = MatrixB::Columns;
+        if (rows < RA) return simdEdgeTile<T, RA - 1, RB>(k, a, lda, b, ldb, c, ldc, rows, cols, epi);
+    }
+    if constexpr (RB > 1)
+    {
+        if (cols <= (RB - 1) * W) return simdEdgeTile<T, RA, RB - 1>(k, a, lda, b, ldb, c, ldc, rows, cols, epi);
+    }
+
+    if (cols == RB * W) Matrix<>::matmul_dot_inner<T, RA, RB>(k, a, lda, b, ldb, c, ldc, epi);
+    else Matrix<>::matmul_dot_edge<T, RA, RB>(k, a, lda, b, ldb, c, ldc, cols - (RB - 1) * W, epi);
+}
 
-        for (int i = 0; i <= M - regsA; i += regsA) 
+// epi is relative to the tile, see epilogue::Ops::at.
+template <typename T, int RA, int RB, int KU, typename Epi = epilogue::Identity<T>>
+void simdTile(int k, const T *a, int lda, const T *b, int ldb, T *c, int ldc, int rows, int cols, const Epi &epi = {})
+{
+    if (rows == RA && cols == RB * SimdTraits<T>::width) Matrix<>::matmul_dot_inner<T, RA, RB, KU>(k, a, lda, b, ldb, c, ldc, epi);
+    else simdEdgeTile<T, RA, RB>(k, a, lda, b, ldb, c, ldc, rows, cols, epi);
+}
+
+// Rows [rowBegin, rowEnd) of C = A * B for an n column B and inner dimension k, tiled with one microkernel shape.
+// epi is relative to c.
+template <typename T, int RA, int RB, int KU, typename Epi = epilogue::Identity<T>>
+void simdMultRowsShaped(const T *a, const T *b, T *c, int n, int k, int rowBegin, int rowEnd, const Epi &epi)
+{
+    constexpr int blockCols = RB * SimdTraits<T>::width;
+
+    for (int i = rowBegin; i < rowEnd; i += RA) 
+    {
+        const int rows = std::min(RA, rowEnd - i);
+        for (int j = 0; j < n; j += blockCols) 
         {
-            for (int j = 0; j <= N - blockCols; j += blockCols) 
-            {
-                Matrix<>::matmul_dot_inner<typename MatrixA::DataT, regsA, regsB>(
-                    K,
-                    &a[i * lda], lda,
-                    &b[j], ldb,
-                    &result[i * ldc + j], ldc
-                );
-            }
+            simdTile<T, RA, RB, KU>(
+                k,
+                &a[i * k], k,
+                &b[j], n,
+                &c[i * n + j], n,
+                rows, std::min(blockCols, n - j),
+                epi.at(i, j)
+            );
         }
+    }
+}
+
+template <typename T, typename Epi = epilogue::Identity<T>>
+using SimdRowKernel = void (*)(const T *, const T *, T *, int, int, int, int, const Epi &);
+
+template <typename T, typename Epi, size_t... I>
+constexpr auto makeSimdRowKernels(std::index_sequence<I...>)
+{
+    using simdTuner::MicroKernelShapes;
+    return std::array<SimdRowKernel<T, Epi>, sizeof...(I)>{
+        &simdMultRowsShaped<T, MicroKernelShapes[I].regsA, MicroKernelShapes[I].regsB, MicroKernelShapes[I].kUnroll, Epi>...
+    };
+}
+
+// One instantiation per entry of simdTuner::MicroKernelShapes, indexed like it.
+template <typename T, typename Epi = epilogue::Identity<T>>
+inline constexpr auto simdRowKernels = 
+    makeSimdRowKernels<T, Epi>(std::make_index_sequence<simdTuner::MicroKernelShapes.size()>{});
+
+template <typename T, typename Epi = epilogue::Identity<T>>
+using SimdTileKernel = void (*)(int, const T *, int, const T *, int, T *, int, int, int, const Epi &);
+
+template <typename T, typename Epi, size_t... I>
+constexpr auto makeSimdTileKernels(std::index_sequence<I...>)
+{
+    using simdTuner::MicroKernelShapes;
+    return std::array<SimdTileKernel<T, Epi>, sizeof...(I)>{
+        &simdTile<T, MicroKernelShapes[I].regsA, MicroKernelShapes[I].regsB, MicroKernelShapes[I].kUnroll, Epi>...
+    };
+}
+
+// Single tile variants of simdRowKernels for callers that schedule tiles themselves.
+template <typename T, typename Epi = epilogue::Identity<T>>
+inline constexpr auto simdTileKernels = 
+    makeSimdTileKernels<T, Epi>(std::make_index_sequence<simdTuner::MicroKernelShapes.size()>{});
+
+template <typename T, int N, int K, typename Epi = epilogue::Identity<T>>
+void simdMultRows(const T *a, const T *b, T *c, int rowBegin, int rowEnd, const Epi &epi = {})
+{
+    simdRowKernels<T, Epi>[simdTuner::activeShapeIndex<T>()](a, b, c, N, K, rowBegin, rowEnd, epi);
+}
 
-        for (int i = M - M % regsA; i < M; ++i)
-            for (int j = 0; j < N; ++j)
-                for (int k = 0; k < K; ++k)
-                    result[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::Simd, MatrixA, MatrixB> 
+{
+    template <typename Epi = epilogue::Identity<typename MatrixA::DataT>>
+    static auto multiply(const MatrixA& a, const MatrixB& b, const Epi &epi = {}) 
+    {
+        using ResultMatrix = Matrix<typename MatrixA::DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
 
-        for (int i = 0; i <= M - regsA; i += regsA)
-            for (int j = N - N % blockCols; j < N; ++j)
-                for (int k = 0; k < K; ++k)
-                    for (int ii = 0; ii < regsA; ++ii)
-                        result[(i + ii) * ldc + j] += a[(i + ii) * lda + k] * b[k * ldb + j];
+        simdMultRows<typename MatrixA::DataT, MatrixB::Columns, MatrixA::Columns>(
+            a.data().data(), b.data().data(), result.data().data(), 0, MatrixA::Rows, epi);
         
         return result;
     }
@@ -259,6 +411,7 @@ struct MatrixMultImpl<MatMultType::MultithreadRow, MatrixA, MatrixB>
         {
             threads[i] = std::thread([&a, &b, &result, i] ()
             {
+                TRACE_SCOPE("row", "kernel");
                 for (int j = 0; j < N; ++j) 
                 {
                     for (int k = 0; k < K; ++k)
@@ -319,25 +472,25 @@ struct MatrixMultImpl<MatMultType::MultithreadElement, MatrixA, MatrixB>
 template <typename MatrixA, typename MatrixB>
 struct MatrixMultImpl<MatMultType::MultithreadSimd, MatrixA, MatrixB> 
 {
+    // Row blocks, including the partial one at the bottom edge, are split evenly across the workers; each worker
+    // also covers the right edge columns of its rows with the masked tiles.
     static auto multiply(const MatrixA& a, const MatrixB& b) 
     {
-        using ResultMatrix = Matrix<typename MatrixA::DataT, MatrixA::Rows, MatrixB::Columns>;
+        return multiply(a, b, static_cast<int>(effectiveHostThreadCount()));
+    }
+
+    template <typename Epi = epilogue::Identity<typename MatrixA::DataT>>
+    static auto multiply(const MatrixA& a, const MatrixB& b, int threadCount, const Epi &epi = {}) 
+    {
+        using DataT = typename MatrixA::DataT;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
         ResultMatrix result;
-        constexpr int regsA = 3;
-        constexpr int regsB = 4;
-        constexpr int blockCols = regsB * SimdTraits<typename MatrixA::DataT>::width;
         constexpr int M = MatrixA::Rows;
         constexpr int N = MatrixB::Columns;
         constexpr int K = MatrixA::Columns;
-        constexpr int lda = MatrixA::Columns;
-        constexpr int ldb = MatrixB::Columns;
-        constexpr int ldc = MatrixB::Columns;
-        constexpr int numRowBlocks = M / regsA;
-        constexpr int numColBlocks = N / blockCols;
+        const int regsA = simdTuner::activeShape<DataT>().regsA;
+        const int numRowBlocks = (M + regsA - 1) / regsA;
         
-        const int threadCount = std::max(4u, std::thread::hardware_concurrency());
-        std::vector<std::thread> threads(threadCount);
-
         std::vector<int> startRows(threadCount + 1);
         int blocksPerThreadBase = numRowBlocks / threadCount;
         int blocksPerThreadRemainder = numRowBlocks % threadCount;
@@ -347,43 +500,28 @@ struct MatrixMultImpl<MatMultType::MultithreadSimd, MatrixA, MatrixB>
         }
         startRows[threadCount] = numRowBlocks;
 
-        for (int tid = 0; tid < threadCount; ++tid) 
+        auto work = [regsA, &startRows, &a, &b, &result, &epi](int tid)
         {
-            threads[tid] = std::thread([tid, &startRows, &a, &b, &result, lda, ldb, ldc]() 
+            TRACE_SCOPE("row blocks", "kernel");
+            const int rowBegin = startRows[tid] * regsA;
+            const int rowEnd = std::min(startRows[tid + 1] * regsA, static_cast<int>(M));
+            if (rowBegin < rowEnd)
             {
-                int startRow = startRows[tid];
-                int endRow = startRows[tid + 1];
-            
-                for (int blockRow = startRow; blockRow < endRow; ++blockRow) 
-                {
-                    int i = blockRow * regsA;
-                    for (int blockCol = 0; blockCol < numColBlocks; ++blockCol) 
-                    {
-                        int j = blockCol * blockCols;
-                        Matrix<>::matmul_dot_inner<typename MatrixA::DataT, regsA, regsB>(
-                            K,
-                            &a[i * lda], lda,
-                            &b[j], ldb,
-                            &result[i * ldc + j], ldc
-                        );
-                    }
-                }
+                simdMultRows<DataT, N, K>(a.data().data(), b.data().data(), result.data().data(), rowBegin, rowEnd, epi);
+            }
+        };
 
-                if (tid == 0) 
-                {
-                    for (int i = M - M % regsA; i < M; ++i)
-                        for (int j = 0; j < N; ++j)
-                            for (int k = 0; k < K; ++k)
-                                result[i * ldc + j] += a[i * lda + k] * b[k * ldb + j];
-        
-        
-                    for (int i = 0; i <= M - regsA; i += regsA)
-                        for (int j = N - N % blockCols; j < N; ++j)
-                            for (int k = 0; k < K; ++k)
-                                for (int ii = 0; ii < regsA; ++ii)
-                                    result[(i + ii) * ldc + j] += a[(i + ii) * lda + k] * b[k * ldb + j];
-                }
-            });
+        // Short products are dominated by starting threads, they run on the persistent team unless it is busy.
+        if (2.0 * M * N * K <= THREAD_TEAM_MAX_FLOPS 
+            && sharedThreadTeam(threadCount)->tryRun(threadCount, [&work](int tid, int) { work(tid); }))
+        {
+            return result;
+        }
+
+        std::vector<std::thread> threads(threadCount);
+        for (int tid = 0; tid < threadCount; ++tid) 
+        {
+            threads[tid] = std::thread(work, tid);
         }
 
         for (auto it = threads.begin(); it < threads.end(); ++it) 
@@ -407,7 +545,8 @@ struct MatrixMultImpl<MatMultType::NaiveOcl, MatrixA, MatrixB>
         
         oclUtil::ProgramWithQueue program{"mat_mult.cl"};
         program.initialize();
-        program.loadFromBinary();
+        const std::string buildOptions = "-DT=" + oclUtil::getOpenCLTypeName<typename MatrixA::DataT>();
+        program.build(buildOptions.c_str());
         program.createQueueAndKernel("naive_mat_mult");
 
         oclUtil::memWrapper bufA = clCreateBuffer(program.getContext(),
@@ -439,6 +578,8 @@ struct MatrixMultImpl<MatMultType::NaiveOcl, MatrixA, MatrixB>
         clSetKernelArg(program.getKernel(), 5, sizeof(int), &ResultMatrix::Columns);
 
         const size_t globalWorkSize[2] = {ResultMatrix::Rows, ResultMatrix::Columns};
+        const oclUtil::KernelTrace kernelTrace("naive_mat_mult");
+        oclUtil::eventWrapper kernelEvent;
         err = clEnqueueNDRangeKernel(program.getCmdQueue(), 
                                      program.getKernel(), 
                                      2, 
@@ -447,9 +588,11 @@ struct MatrixMultImpl<MatMultType::NaiveOcl, MatrixA, MatrixB>
                                      nullptr, 
                                      0, 
                                      nullptr, 
-                                     nullptr);
+                                     &kernelEvent);
         CHECK_CL_ERROR(err, "clEnqueueNDRangeKernel");
+        kernelTrace.complete(kernelEvent, program.getDevice());
     
+        TRACE_SCOPE("read result", "opencl");
         clEnqueueReadBuffer(program.getCmdQueue(), 
                             bufC, 
                             CL_TRUE, 
@@ -464,6 +607,308 @@ struct MatrixMultImpl<MatMultType::NaiveOcl, MatrixA, MatrixB>
     }
 };
 
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::HeterogeneousOcl, MatrixA, MatrixB> 
+{
+    using DataT = typename MatrixA::DataT;
+
+    // Worker 0 is the host SIMD kernel, workers 1..n are the selected OpenCL devices.
+    static auto multiply(const MatrixA& a, const MatrixB& b) 
+    {
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
+        constexpr int M = MatrixA::Rows;
+        constexpr int N = MatrixB::Columns;
+        constexpr int K = MatrixA::Columns;
+
+        auto &programs = oclUtil::matMultDevicePrograms<DataT>();
+        static std::mutex multiplyMutex;
+        std::lock_guard<std::mutex> lock(multiplyMutex);
+
+        const size_t workerCount = balancer().workerCount();
+        const std::vector<size_t> bounds = balancer().partition(M);
+        std::vector<size_t> rowsProcessed(workerCount);
+        std::vector<double> secondsTaken(workerCount);
+        std::vector<std::exception_ptr> errors(workerCount);
+
+        std::vector<std::thread> deviceThreads;
+        for (size_t worker = 1; worker < workerCount; ++worker)
+        {
+            const int rowBegin = static_cast<int>(bounds[worker]);
+            const int rowEnd = static_cast<int>(bounds[worker + 1]);
+            rowsProcessed[worker] = rowEnd - rowBegin;
+            if (rowBegin == rowEnd) continue;
+
+            deviceThreads.emplace_back([&, worker, rowBegin, rowEnd]()
+            {
+                TRACE_SCOPE("device rows", "kernel");
+                try
+                {
+                    const auto start{std::chrono::steady_clock::now()};
+                    multiplyOnDevice(*programs[worker - 1], a, b, result, rowBegin, rowEnd);
+                    secondsTaken[worker] = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+                } catch (...)
+                {
+                    errors[worker] = std::current_exception();
+                }
+            });
+        }
+
+        rowsProcessed[0] = bounds[1] - bounds[0];
+        const auto hostStart{std::chrono::steady_clock::now()};
+        {
+            TRACE_SCOPE("host rows", "kernel");
+            simdMultRows<DataT, N, K>(a.data().data(), b.data().data(), result.data().data(), 
+                                      static_cast<int>(bounds[0]), static_cast<int>(bounds[1]));
+        }
+        secondsTaken[0] = std::chrono::duration<double>{std::chrono::steady_clock::now() - hostStart}.count();
+
+        for (auto &thread : deviceThreads) 
+        {
+            thread.join();
+        }
+
+        for (const auto &error : errors)
+        {
+            if (error) std::rethrow_exception(error);
+        }
+
+        balancer().update(rowsProcessed, secondsTaken);
+
+        return result;
+    }
+
+    static LoadBalancer &balancer()
+    {
+        static LoadBalancer instance(oclUtil::matMultDevicePrograms<DataT>().size() + 1);
+        return instance;
+    }
+private:
+    template<typename ResultMatrix>
+    static void multiplyOnDevice(oclUtil::ProgramWithQueue &program, const MatrixA& a, const MatrixB& b, 
+                                 ResultMatrix &result, int rowBegin, int rowEnd)
+    {
+        cl_int err;
+        const cl_uint rows = static_cast<cl_uint>(rowEnd - rowBegin);
+        const cl_uint inner = MatrixA::Columns;
+        const cl_uint columns = ResultMatrix::Columns;
+
+        oclUtil::memWrapper bufA = clCreateBuffer(program.getContext(),
+                                                  CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                  sizeof(DataT) * rows * inner,
+                                                  const_cast<DataT*>(&a[rowBegin * inner]), 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        oclUtil::memWrapper bufB = clCreateBuffer(program.getContext(), 
+                                                  CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
+                                                  sizeof(DataT) * MatrixB::Size, 
+                                                  const_cast<DataT*>(b.data().data()), 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        oclUtil::memWrapper bufC = clCreateBuffer(program.getContext(), 
+                                                  CL_MEM_WRITE_ONLY, 
+                                                  sizeof(DataT) * rows * columns, 
+                                                  nullptr, 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        clSetKernelArg(program.getKernel(), 0, sizeof(cl_mem), &bufA);
+        clSetKernelArg(program.getKernel(), 1, sizeof(cl_mem), &bufB);
+        clSetKernelArg(program.getKernel(), 2, sizeof(cl_mem), &bufC);
+        clSetKernelArg(program.getKernel(), 3, sizeof(cl_uint), &rows);
+        clSetKernelArg(program.getKernel(), 4, sizeof(cl_uint), &inner);
+        clSetKernelArg(program.getKernel(), 5, sizeof(cl_uint), &columns);
+
+        const size_t globalWorkSize[2] = {rows, columns};
+        const oclUtil::KernelTrace kernelTrace("naive_mat_mult rows");
+        oclUtil::eventWrapper kernelEvent;
+        err = clEnqueueNDRangeKernel(program.getCmdQueue(), 
+                                     program.getKernel(), 
+                                     2, 
+                                     nullptr, 
+                                     globalWorkSize, 
+                                     nullptr, 
+                                     0, 
+                                     nullptr, 
+                                     &kernelEvent);
+        CHECK_CL_ERROR(err, "clEnqueueNDRangeKernel");
+        kernelTrace.complete(kernelEvent, program.getDevice());
+
+        TRACE_SCOPE("read result", "opencl");
+
+        err = clEnqueueReadBuffer(program.getCmdQueue(), 
+                                  bufC, 
+                                  CL_TRUE, 
+                                  0, 
+                                  sizeof(DataT) * rows * columns, 
+                                  &result[rowBegin * columns], 
+                                  0, 
+                                  nullptr,
+                                  nullptr);
+        CHECK_CL_ERROR(err, "clEnqueueReadBuffer");
+    }
+};
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::TiledOcl, MatrixA, MatrixB> 
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b) 
+    {
+        return multiply(a, b, epilogue::Identity<typename MatrixA::DataT>{}, true);
+    }
+
+    // Fused, the epilogue is compiled into the tiled kernel. Otherwise every op of it is one epilogue_pass launch
+    // over C after the multiplication, both before the single read back.
+    template <typename Epi>
+    static auto multiply(const MatrixA& a, const MatrixB& b, const Epi &epi, bool fused) 
+    {
+        using DataT = typename MatrixA::DataT;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
+        cl_int err;
+
+        if (Epi::addsResidual && epi.ldr != ResultMatrix::Columns)
+        {
+            throw std::runtime_error("The OpenCL epilogue needs a residual with the layout of C");
+        }
+
+        const std::string extraOptions = Epi::identity ? "" 
+            : fused ? Epi::oclBuildOptions() : epilogue::Identity<DataT>::oclBuildOptions();
+        auto &tiled = oclTuner::tiledProgram<DataT>(MatrixA::Rows, extraOptions);
+        auto &program = *tiled.program;
+
+        oclUtil::memWrapper bufA = clCreateBuffer(program.getContext(),
+                                                  CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                                  sizeof(DataT) * MatrixA::Size,
+                                                  const_cast<DataT*>(a.data().data()), 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        oclUtil::memWrapper bufB = clCreateBuffer(program.getContext(), 
+                                                  CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
+                                                  sizeof(DataT) * MatrixB::Size, 
+                                                  const_cast<DataT*>(b.data().data()), 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        oclUtil::memWrapper bufC = clCreateBuffer(program.getContext(), 
+                                                  fused ? CL_MEM_WRITE_ONLY : CL_MEM_READ_WRITE, 
+                                                  sizeof(DataT) * ResultMatrix::Size, 
+                                                  nullptr, 
+                                                  &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        auto operandBuffer = [&program, &err](const DataT *data, size_t count) -> cl_mem
+        {
+            if (not data) return nullptr;
+            cl_mem buffer = clCreateBuffer(program.getContext(), 
+                                           CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, 
+                                           sizeof(DataT) * count, 
+                                           const_cast<DataT*>(data), 
+                                           &err);
+            CHECK_CL_ERROR(err, "clCreateBuffer");
+            return buffer;
+        };
+        oclUtil::memWrapper bufBias = operandBuffer(Epi::addsBias ? epi.bias : nullptr, ResultMatrix::Columns);
+        oclUtil::memWrapper bufResidual = operandBuffer(Epi::addsResidual ? epi.residual : nullptr, ResultMatrix::Size);
+
+        const cl_uint rows = MatrixA::Rows;
+        const cl_uint inner = MatrixA::Columns;
+        const cl_uint columns = ResultMatrix::Columns;
+        // The kernels are shared by every order of the shape class, but arguments are captured at enqueue time, so
+        // only setting and enqueueing is serialized on the program. Transfers and waiting for the result overlap with
+        // other callers on the queue.
+        std::unique_lock<std::mutex> lock(tiled.kernelMutex);
+        clSetKernelArg(program.getKernel(), 0, sizeof(cl_mem), &bufA);
+        clSetKernelArg(program.getKernel(), 1, sizeof(cl_mem), &bufB);
+        clSetKernelArg(program.getKernel(), 2, sizeof(cl_mem), &bufC);
+        clSetKernelArg(program.getKernel(), 3, sizeof(cl_uint), &rows);
+        clSetKernelArg(program.getKernel(), 4, sizeof(cl_uint), &inner);
+        clSetKernelArg(program.getKernel(), 5, sizeof(cl_uint), &columns);
+        if (not Epi::identity && fused)
+        {
+            clSetKernelArg(program.getKernel(), 6, sizeof(DataT), &epi.alpha);
+            clSetKernelArg(program.getKernel(), 7, sizeof(cl_mem), &bufBias);
+            clSetKernelArg(program.getKernel(), 8, sizeof(cl_mem), &bufResidual);
+            clSetKernelArg(program.getKernel(), 9, sizeof(DataT), &epi.beta);
+        }
+
+        const auto [globalWorkSize, localWorkSize] = oclTuner::workSizes(tiled.config, rows, columns);
+        const oclUtil::KernelTrace kernelTrace("tiled_mat_mult");
+        oclUtil::eventWrapper kernelEvent;
+        err = clEnqueueNDRangeKernel(program.getCmdQueue(), 
+                                     program.getKernel(), 
+                                     2, 
+                                     nullptr, 
+                                     globalWorkSize.data(), 
+                                     localWorkSize.data(), 
+                                     0, 
+                                     nullptr, 
+                                     &kernelEvent);
+        CHECK_CL_ERROR(err, "clEnqueueNDRangeKernel");
+
+        if (not Epi::identity && not fused)
+        {
+            enqueueEpiloguePasses(tiled, epi, bufC, bufBias, bufResidual, rows, columns);
+        }
+        lock.unlock();
+        kernelTrace.complete(kernelEvent, program.getDevice());
+    
+        TRACE_SCOPE("read result", "opencl");
+        err = clEnqueueReadBuffer(program.getCmdQueue(), 
+                                  bufC, 
+                                  CL_TRUE, 
+                                  0, 
+                                  sizeof(DataT) * ResultMatrix::Size, 
+                                  result.data().data(), 
+                                  0, 
+                                  nullptr,
+                                  nullptr);
+        CHECK_CL_ERROR(err, "clEnqueueReadBuffer");
+
+        return result;
+    }
+private:
+    // In-order queue, so every pass sees the result of the previous launch. Called with tiled.kernelMutex held.
+    template <typename Epi>
+    static void enqueueEpiloguePasses(oclTuner::TiledProgram &tiled, const Epi &epi, cl_mem c, cl_mem bias, 
+                                      cl_mem residual, cl_uint rows, cl_uint columns)
+    {
+        using DataT = typename MatrixA::DataT;
+        auto &program = *tiled.program;
+        if (not tiled.epiloguePassKernel.get())
+        {
+            cl_int err;
+            tiled.epiloguePassKernel = clCreateKernel(program.getProgram(), "epilogue_pass", &err);
+            CHECK_CL_ERROR(err, "clCreateKernel");
+        }
+        cl_kernel kernel = tiled.epiloguePassKernel.get();
+
+        auto pass = [&](cl_uint op, cl_mem operand, DataT scalar)
+        {
+            clSetKernelArg(kernel, 0, sizeof(cl_mem), &c);
+            clSetKernelArg(kernel, 1, sizeof(cl_mem), &operand);
+            clSetKernelArg(kernel, 2, sizeof(DataT), &scalar);
+            clSetKernelArg(kernel, 3, sizeof(cl_uint), &rows);
+            clSetKernelArg(kernel, 4, sizeof(cl_uint), &columns);
+            clSetKernelArg(kernel, 5, sizeof(cl_uint), &op);
+            const std::array<size_t, 2> globalWorkSize = { rows, columns };
+            const cl_int err = clEnqueueNDRangeKernel(program.getCmdQueue(), kernel, 2, nullptr, globalWorkSize.data(),
+                                                      nullptr, 0, nullptr, nullptr);
+            CHECK_CL_ERROR(err, "clEnqueueNDRangeKernel");
+        };
+
+        // The unused operand is bound to C, the kernel ignores it.
+        if constexpr (Epi::scales) pass(0, c, epi.alpha);
+        if constexpr (Epi::addsBias) pass(1, bias, DataT(0));
+        if constexpr (Epi::activation == epilogue::Activation::Relu) pass(2, c, DataT(0));
+        else if constexpr (Epi::activation == epilogue::Activation::Gelu) pass(3, c, DataT(0));
+        if constexpr (Epi::addsResidual) pass(4, residual, epi.beta);
+    }
+};
+
 template<util::ElementIterable T, typename D>
 std::vector<std::vector<D>> matMult(const T &matA, const T &matB) 
 {
@@ -5,12 +5,66 @@
 
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <iterator>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
 namespace MatBenchmarkProgOpts
 {
 
+// Expands "n", "first:last" (doubling), "first:last:xF" (geometric) and "first:last:+S" (arithmetic) into the
+// listed values, last included when the progression hits it. Every value has to be positive.
+inline std::vector<int> expandRangeSpec(std::string_view spec)
+{
+    auto parseInt = [spec](std::string_view str)
+    {
+        int value{0};
+        const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (ec != std::errc() || ptr != str.data() + str.size() || str.empty())
+        {
+            throw std::invalid_argument("Invalid range: " + std::string(spec));
+        }
+        return value;
+    };
+
+    const auto firstColon = spec.find(':');
+    if (firstColon == std::string_view::npos)
+    {
+        const int value = parseInt(spec);
+        if (value <= 0) throw std::invalid_argument("Invalid range: " + std::string(spec));
+        return { value };
+    }
+
+    const auto secondColon = spec.find(':', firstColon + 1);
+    const int first = parseInt(spec.substr(0, firstColon));
+    const int last = parseInt(spec.substr(firstColon + 1, secondColon == std::string_view::npos
+                                                             ? std::string_view::npos
+                                                             : secondColon - firstColon - 1));
+    const std::string_view step = secondColon == std::string_view::npos ? "x2" : spec.substr(secondColon + 1);
+    if (step.size() < 2 || (step[0] != 'x' && step[0] != '+'))
+    {
+        throw std::invalid_argument("Invalid range step (use xF or +S): " + std::string(spec));
+    }
+
+    const bool geometric = step[0] == 'x';
+    const int amount = parseInt(step.substr(1));
+    if (first <= 0 || last < first || (geometric ? amount < 2 : amount < 1))
+    {
+        throw std::invalid_argument("Invalid range: " + std::string(spec));
+    }
+
+    std::vector<int> values;
+    for (long long value = first; value <= last; value = geometric ? value * amount : value + amount)
+    {
+        values.push_back(static_cast<int>(value));
+    }
+    return values;
+}
+
 template <typename OptType>
 void validate(boost::any& v, const std::vector<std::string>& values, OptType*, int)
 {
@@ -19,24 +73,69 @@ void validate(boost::any& v, const std::vector<std::string>& values, OptType*, i
     validators::check_first_occurrence(v);
 
     std::vector<OptValueType> parsed;
-    for (auto& s : values) 
+    auto isAllowed = [](OptValueType val)
     {
-        OptValueType val;
-        if constexpr (std::is_enum_v<OptValueType>) 
+        return std::find(OptType::allowed.begin(), OptType::allowed.end(), val) != OptType::allowed.end();
+    };
+    auto accept = [&parsed, &isAllowed](const std::string &s, OptValueType val)
+    {
+        if (not isAllowed(val))
         {
-            val = fromString<OptValueType>(s);
+            throw validation_error(validation_error::invalid_option_value, s);
         }
-        else if constexpr (std::is_integral_v<OptValueType>)
-        {
-            val = std::stoi(s);
-        } 
+        if (std::find(parsed.begin(), parsed.end(), val) == parsed.end()) parsed.push_back(val);
+    };
 
-        if (std::find(OptType::allowed.begin(), OptType::allowed.end(), val) == OptType::allowed.end()) 
+    for (auto& s : values)
+    {
+        if (util::toLower(s) == "all")
         {
-            throw validation_error(validation_error::invalid_option_value, s);
+            for (auto val : OptType::allowed) accept(s, val);
+            continue;
         }
 
-        parsed.push_back(val);
+        if constexpr (std::is_enum_v<OptValueType>)
+        {
+            accept(s, util::fromString<OptValueType>(s));
+        }
+        else if constexpr (std::is_integral_v<OptValueType>)
+        {
+            std::vector<int> expanded;
+            try
+            {
+                expanded = expandRangeSpec(s);
+            } catch (const std::invalid_argument &)
+            {
+                throw validation_error(validation_error::invalid_option_value, s);
+            }
+            if (s.find(':') == std::string::npos)
+            {
+                accept(s, static_cast<OptValueType>(expanded.front()));
+                continue;
+            }
+
+            // A range only has to hit some of the allowed values, the others are dropped with a warning.
+            std::vector<int> dropped;
+            std::ranges::copy_if(expanded, std::back_inserter(dropped), [&isAllowed](int val)
+            {
+                return not isAllowed(static_cast<OptValueType>(val));
+            });
+            if (dropped.size() == expanded.size())
+            {
+                throw std::invalid_argument("Range " + s + " of --" + OptType::name + " contains none of: " 
+                                            + OptType::allowedStr());
+            }
+            if (not dropped.empty())
+            {
+                std::cerr << "warning: --" << OptType::name << " " << s << " skips";
+                for (int val : dropped) std::cerr << " " << val;
+                std::cerr << ", allowed are: " << OptType::allowedStr() << "\n";
+            }
+            for (int val : expanded)
+            {
+                if (isAllowed(static_cast<OptValueType>(val))) accept(s, static_cast<OptValueType>(val));
+            }
+        }
     }
     v = OptType{parsed};
 }
@@ -50,41 +149,55 @@ struct Option
 
     Option(const std::vector<value_type>& _opts) : opts(_opts) {}
 
-    static std::string allowedStr(const std::string& sep = ", ") 
+    static std::string allowedStr(const std::string& sep = ", ")
     {
         std::ostringstream oss;
-        for (size_t i = 0; i < allowed.size(); ++i) 
+        for (size_t i = 0; i < allowed.size(); ++i)
         {
-            oss << allowed[i];
+            if constexpr (std::is_enum_v<value_type>)
+                oss << util::toString(allowed[i]);
+            else
+                oss << allowed[i];
             if (i + 1 < allowed.size())
                 oss << sep;
         }
         return oss.str();
     }
 
-    std::vector<value_type> opts; 
+    std::vector<value_type> opts;
 };
 
-struct MatrixDimsOpt : Option<MatrixDimsOpt, decltype(Benchmarks::MatMultOrders)> 
+struct MatrixDimsOpt : Option<MatrixDimsOpt, decltype(Benchmarks::MatMultOrders)>
 {
     using Option::Option;
 
-    inline static constexpr const char *name = "matrix_dims";
+    inline static constexpr const char *name = "shapes";
 };
 
 template<>
-decltype(Benchmarks::MatMultOrders)
+inline const decltype(Benchmarks::MatMultOrders)
 Option<MatrixDimsOpt, decltype(Benchmarks::MatMultOrders)>::allowed = Benchmarks::MatMultOrders;
 
-struct MatMultTypeOpt : Option<MatMultTypeOpt, decltype(Benchmarks::MatMultOrders)> 
+struct MatMultTypeOpt : Option<MatMultTypeOpt, decltype(util::enumAll<MatMultType>())>
 {
     using Option::Option;
 
-    inline static constexpr const char *name = "mult_type";
+    inline static constexpr const char *name = "kernels";
 };
 
 template<>
-const decltype(util::enumAll<MatMultType>())
+inline const decltype(util::enumAll<MatMultType>())
 Option<MatMultTypeOpt, decltype(util::enumAll<MatMultType>())>::allowed = util::enumAll<MatMultType>();
 
-} // namespace MatBenchmarkProgOpts
\ No newline at end of file
+struct MatMultDataTypeOpt : Option<MatMultDataTypeOpt, decltype(util::enumAll<MatMultDataType>())>
+{
+    using Option::Option;
+
+    inline static constexpr const char *name = "dtypes";
+};
+
+template<>
+inline const decltype(util::enumAll<MatMultDataType>())
+Option<MatMultDataTypeOpt, decltype(util::enumAll<MatMultDataType>())>::allowed = util::enumAll<MatMultDataType>();
+
+} // namespace MatBenchmarkProgOpts
@@ -1,17 +1,177 @@
 #pragma once
 
+#include "baseline_kernels.hpp"
 #include "benchmark.hpp"
+#include "cache_control.hpp"
+#include "kernel_selector.hpp"
+#include "parallel_backends.hpp"
+#include "roofline.hpp"
+
+#include <map>
+#include <optional>
+#include <random>
+#include <typeinfo>
+#include <utility>
 
 namespace Benchmarks
 {
 
-constexpr const std::array<int, 5> MatMultOrders =
+inline bool isBaseline(MatMultType multType)
+{
+    return multType == MatMultType::Ublas || multType == MatMultType::Blas;
+}
+
+struct BaselineResult
+{
+    MatMultType multType = MatMultType::Ublas;
+    double gflops = 0.0;
+};
+
+// Fastest baseline measured so far in this process per (data type, order).
+inline std::map<std::pair<std::string, int>, BaselineResult> &baselineResults()
+{
+    static std::map<std::pair<std::string, int>, BaselineResult> results;
+    return results;
+}
+
+// Baselines record their throughput, every other kernel is reported relative to the best baseline measured
+// before it at the same data type and order. Results that failed verification take no part in either.
+template<typename DataType>
+void injectBaselineRatio(boost::json::object &obj, MatMultType multType, int order)
+{
+    const auto *value = obj.if_contains("gflops");
+    if (not value || not value->is_number() || verification::failed(obj)) return;
+    const double gflops = value->to_number<double>();
+
+    const auto key = std::make_pair(std::string(typeid(DataType).name()), order);
+    auto &results = baselineResults();
+    if (isBaseline(multType))
+    {
+        auto it = results.find(key);
+        if (it == results.end() || it->second.gflops < gflops)
+        {
+            results[key] = {multType, gflops};
+        }
+        return;
+    }
+
+    auto it = results.find(key);
+    if (it == results.end() || it->second.gflops <= 0.0) return;
+    obj["baseline_kernel"] = util::toString(it->second.multType);
+    obj["baseline_gflops"] = it->second.gflops;
+    obj["baseline_ratio"] = gflops / it->second.gflops;
+}
+
+// Rates are derived from the median execution time, which is less sensitive to stragglers than the mean.
+template<typename DataType, uint32_t Rows, uint32_t Columns>
+void injectRoofline(boost::json::object &obj, MatMultType multType, double seconds, uint32_t tileSize = 16)
+{
+    const auto work = roofline::matMultWork(multType, sizeof(DataType), Rows, Columns, Columns, tileSize,
+                                            simdTuner::activeShape<DataType>().regsA);
+    util::mergeJsonObjects(obj, roofline::report<DataType>(multType, work, seconds));
+    injectBaselineRatio<DataType>(obj, multType, Rows);
+}
+
+inline void injectDevicePartition(boost::json::object &obj)
+{
+    const auto &partition = oclUtil::defaultDevicePartition();
+    if (partition.kind == oclUtil::DevicePartition::Kind::None) return;
+
+    obj["device_partition"] = partition.description();
+    if (partition.kind == oclUtil::DevicePartition::Kind::Equally)
+    {
+        obj["compute_units"] = partition.computeUnits;
+    }
+}
+
+// Input matrices of a multiplication benchmark, refilled before every timed iteration and left in the cache state
+// the runner asks for. Rotating mode keeps enough sets to overflow the last level cache and fills them once.
+template<typename DataType, uint32_t Rows, uint32_t Columns>
+class MatMultOperands
+{
+public:
+    using MatrixType = Matrix<DataType, Rows, Columns>;
+
+    void prepare(cache::Mode mode)
+    {
+        if (mode == cache::Mode::Rotating)
+        {
+            const size_t setCount = cache::rotatingSetCount(2 * sizeof(DataType) * MatrixType::Size);
+            if (m_sets.size() != setCount)
+            {
+                m_sets.resize(setCount);
+                for (auto &[a, b] : m_sets) { a.randomFill(); b.randomFill(); }
+                m_current = 0;
+            } else
+            {
+                m_current = (m_current + 1) % m_sets.size();
+            }
+            return;
+        }
+
+        m_sets.resize(1);
+        m_current = 0;
+        m_sets[0].first.randomFill();
+        m_sets[0].second.randomFill();
+        for (const MatrixType *matrix : { &a(), &b() })
+        {
+            if (mode == cache::Mode::Warm) cache::touch(cache::bytesOf(matrix->data()));
+            else cache::flush(cache::bytesOf(matrix->data()));
+        }
+    }
+
+    const MatrixType &a() const { return m_sets[m_current].first; }
+    const MatrixType &b() const { return m_sets[m_current].second; }
+    size_t setCount() const { return m_sets.size(); }
+
+    void injectOutputParams(boost::json::object &obj) const
+    {
+        if (m_sets.size() < 2) return;
+        obj["operand_sets"] = m_sets.size();
+        obj["operand_bytes"] = m_sets.size() * 2 * sizeof(DataType) * MatrixType::Size;
+        obj["llc_bytes"] = cache::lastLevelCacheBytes();
+    }
+private:
+    std::vector<std::pair<MatrixType, MatrixType>> m_sets;
+    size_t m_current = 0;
+};
+
+// Freivalds check of the last product against the operands it was computed from. The seed is drawn per check,
+// so a kernel cannot be tuned to the vectors, and is reported to reproduce a failure.
+template<typename DataType, uint32_t Rows, uint32_t Columns>
+verification::Result verifyProduct(const MatMultOperands<DataType, Rows, Columns> &operands,
+                                   const typename MatMultOperands<DataType, Rows, Columns>::MatrixType &c, const std::string &name,
+                                   const verification::Config &config)
+{
+    std::random_device device;
+    const uint64_t seed = (static_cast<uint64_t>(device()) << 32) | device();
+    const auto result = verification::freivalds(operands.a().data().data(), operands.b().data().data(), 
+                                                c.data().data(), Rows, Columns, Columns, config, seed);
+    if (not result.passed)
+    {
+        std::cerr << "Verification failed: " << name << " " << typeid(DataType).name() << " " << Rows << "x" << Columns 
+                  << ", row " << result.failedRow << " of C is wrong (seed " << seed << ")\n";
+    }
+    return result;
+}
+
+inline void injectVerification(boost::json::object &obj, const std::optional<verification::Result> &result)
+{
+    if (not result) return;
+    obj["verified"] = result->passed;
+    obj["verification"] = result->toJson();
+}
+
+constexpr const std::array<int, 8> MatMultOrders =
 {
     2,
+    64,
     128,
     256,
     512,
-    1024
+    1024,
+    2048,
+    4096
 };
 
 template<typename DataType, 
@@ -28,24 +188,93 @@ public:
 protected:
     void setUp() override 
     {
-        m_matA.randomFill();
-        m_matB.randomFill();
+        m_operands.prepare(this->m_config.cacheMode);
     }
 
     void compute() override
     {
-        m_matC = m_matA.template mult<MultType>(m_matB);
+        m_matC = m_operands.a().template mult<MultType>(m_operands.b());
+    }
+
+    double flopsPerIteration() const override { return 2.0 * Rows * Columns * Columns; }
+
+    void verify() override
+    {
+        m_verification = verifyProduct(m_operands, m_matC, this->m_name, this->m_config.verification);
     }
 
     virtual void injectOutputParams(boost::json::object &obj) const 
     {
         obj["data_type"] = typeid(DataType).name();
         obj["matrix_dims"] = std::format("{}x{}", Columns, Rows);
+        injectVerification(obj, m_verification);
+        m_operands.injectOutputParams(obj);
+
+        if constexpr (MultType == MatMultType::Auto)
+        {
+            obj["auto_choice"] = kernelSelector::choiceJson<DataType>(Rows);
+            injectRoofline<DataType, Rows, Columns>(obj, kernelSelector::select<DataType>(Rows).type, this->m_statistics.median);
+        } else if constexpr (MultType != MatMultType::TiledOcl)
+        {
+            injectRoofline<DataType, Rows, Columns>(obj, MultType, this->m_statistics.median);
+        }
+
+        if constexpr (MultType == MatMultType::HeterogeneousOcl)
+        {
+            using Impl = MatrixMultImpl<MultType, Matrix<DataType, Rows, Columns>, Matrix<DataType, Rows, Columns>>;
+            boost::json::array workers;
+            workers.emplace_back("host_simd");
+            for (const auto &program : oclUtil::matMultDevicePrograms<DataType>())
+            {
+                workers.emplace_back(oclUtil::getDeviceInfoString(program->getDevice(), CL_DEVICE_NAME));
+            }
+            boost::json::array ratios;
+            for (double ratio : Impl::balancer().ratios())
+            {
+                ratios.emplace_back(ratio);
+            }
+            obj["workers"] = workers;
+            obj["split_ratios"] = ratios;
+        }
+
+        if constexpr (MultType == MatMultType::TiledOcl)
+        {
+            const auto &tiled = oclTuner::tiledProgram<DataType>(Rows);
+            boost::json::object config;
+            config["tile_size"] = tiled.config.tileSize;
+            config["work_per_thread"] = tiled.config.workPerThread;
+            config["source"] = tiled.fromDatabase ? "tuning_database" : "default";
+            obj["ocl_config"] = config;
+            injectDevicePartition(obj);
+            injectRoofline<DataType, Rows, Columns>(obj, MultType, this->m_statistics.median, tiled.config.tileSize);
+        }
+
+        if constexpr (MultType == MatMultType::MultithreadSimd || parallelBackends::isOpenMp(MultType))
+        {
+            obj["threads"] = effectiveHostThreadCount();
+        }
+
+        if constexpr (parallelBackends::isOpenMp(MultType))
+        {
+            obj["omp_schedule"] = parallelBackends::ompScheduleName(MultType);
+        }
+
+        if constexpr (MultType == MatMultType::ParUnseq)
+        {
+            obj["execution_backend"] = parallelBackends::parUnseqBackend();
+        }
+
+        if constexpr (MultType == MatMultType::Simd || MultType == MatMultType::MultithreadSimd 
+                      || MultType == MatMultType::HeterogeneousOcl || parallelBackends::isOpenMp(MultType)
+                      || MultType == MatMultType::ParUnseq)
+        {
+            obj["simd_kernel"] = simdTuner::activeShapeJson<DataType>();
+        }
     }
 
-    Matrix<DataType, Rows, Columns> m_matA;
-    Matrix<DataType, Rows, Columns> m_matB;
+    MatMultOperands<DataType, Rows, Columns> m_operands;
     Matrix<DataType, Rows, Columns> m_matC;
+    std::optional<verification::Result> m_verification;
 };
 
 template<typename DataType, uint32_t Rows, uint32_t Columns, uint32_t TaskCount>
@@ -59,29 +288,45 @@ public:
 protected:
     void setUp() override 
     {
-        oclUtil::ProgramWithQueue program("mat_mult.cl");
-        program.initialize();
-        const std::string buildOptions = "-DT=" + oclUtil::getOpenCLTypeName<DataType>();
-        program.build(buildOptions.c_str());
-        program.saveBinary();
-        m_matA.randomFill();
-        m_matB.randomFill();
+        // Compiled once, before the first timed iteration; build() registers the binary, so the products load it
+        // instead of invoking the compiler.
+        if (not m_compiled)
+        {
+            oclUtil::ProgramWithQueue program("mat_mult.cl");
+            program.initialize();
+            const std::string buildOptions = "-DT=" + oclUtil::getOpenCLTypeName<DataType>();
+            program.build(buildOptions.c_str());
+            m_compiled = true;
+        }
+        m_operands.prepare(this->m_config.cacheMode);
     }
 
     void compute() override
     {
-        m_matC = m_matA.template mult<MatMultType::NaiveOcl>(m_matB);
+        m_matC = m_operands.a().template mult<MatMultType::NaiveOcl>(m_operands.b());
+    }
+
+    double flopsPerIteration() const override { return 2.0 * Rows * Columns * Columns; }
+
+    void verify() override
+    {
+        m_verification = verifyProduct(m_operands, m_matC, this->m_name, this->m_config.verification);
     }
 
     virtual void injectOutputParams(boost::json::object &obj) const 
     {
         obj["data_type"] = typeid(DataType).name();
         obj["matrix_dims"] = std::format("{}x{}", Columns, Rows);
+        injectVerification(obj, m_verification);
+        m_operands.injectOutputParams(obj);
+        injectRoofline<DataType, Rows, Columns>(obj, MatMultType::NaiveOcl, this->m_statistics.median);
+        injectDevicePartition(obj);
     }
 
-    Matrix<DataType, Rows, Columns> m_matA;
-    Matrix<DataType, Rows, Columns> m_matB;
+    MatMultOperands<DataType, Rows, Columns> m_operands;
     Matrix<DataType, Rows, Columns> m_matC;
+    std::optional<verification::Result> m_verification;
+    bool m_compiled = false;
 };
 
 template<typename T, 
@@ -133,18 +378,20 @@ int runAllMatrixMultTypesWithDataTypes()
     return 0;
 }
 
+template <typename DataType, MatMultType type, size_t... OrderIndices>
+int dispatchMatOrder(int order, std::index_sequence<OrderIndices...>)
+{
+    int result{-1};
+    const bool dispatched = ((order == MatMultOrders[OrderIndices] 
+                              && (result = runMatrixMultTypes<MatMultOrders[OrderIndices], DataType, type>(), true)) || ...);
+    if (not dispatched) throw std::runtime_error("Unsupported mat mult order\n");
+    return result;
+}
+
 template <typename DataType, MatMultType type>
 int dispatchMatOrder(int order)
 {
-    switch (order)
-    {
-        case 2: return runMatrixMultTypes<2, DataType, type>();
-        case 128: return runMatrixMultTypes<128, DataType, type>();
-        case 256: return runMatrixMultTypes<256, DataType, type>();
-        case 512: return runMatrixMultTypes<512, DataType, type>();
-        case 1024: return runMatrixMultTypes<1024, DataType, type>();
-        default: throw std::runtime_error("Unsupported mat mult order\n");
-    }
+    return dispatchMatOrder<DataType, type>(order, std::make_index_sequence<MatMultOrders.size()>{});
 }
 
 template <typename DataType>
@@ -158,11 +405,43 @@ int dispatchMultType(int order, MatMultType mt)
         case MatMultType::MultithreadRow: return dispatchMatOrder<DataType, MatMultType::MultithreadRow>(order);
         case MatMultType::MultithreadSimd: return dispatchMatOrder<DataType, MatMultType::MultithreadSimd>(order);
         case MatMultType::NaiveOcl: return dispatchMatOrder<DataType, MatMultType::NaiveOcl>(order);
+        case MatMultType::HeterogeneousOcl: return dispatchMatOrder<DataType, MatMultType::HeterogeneousOcl>(order);
+        case MatMultType::TiledOcl: return dispatchMatOrder<DataType, MatMultType::TiledOcl>(order);
+        case MatMultType::OmpStatic:
+        case MatMultType::OmpDynamic:
+        case MatMultType::OmpGuided:
+            if (not parallelBackends::openMpAvailable)
+            {
+                std::cerr << "Skipping " << util::toString(mt) << ": built without OpenMP\n";
+                return 0;
+            }
+            if (mt == MatMultType::OmpStatic) return dispatchMatOrder<DataType, MatMultType::OmpStatic>(order);
+            if (mt == MatMultType::OmpDynamic) return dispatchMatOrder<DataType, MatMultType::OmpDynamic>(order);
+            return dispatchMatOrder<DataType, MatMultType::OmpGuided>(order);
+        case MatMultType::ParUnseq:
+            if (not parallelBackends::parUnseqAvailable)
+            {
+                std::cerr << "Skipping ParUnseq: built without a parallel std::execution backend\n";
+                return 0;
+            }
+            return dispatchMatOrder<DataType, MatMultType::ParUnseq>(order);
+        case MatMultType::Auto: return dispatchMatOrder<DataType, MatMultType::Auto>(order);
+        case MatMultType::Ublas: return dispatchMatOrder<DataType, MatMultType::Ublas>(order);
+        case MatMultType::Blas:
+            if constexpr (baselines::blasSupports<DataType>)
+            {
+                return dispatchMatOrder<DataType, MatMultType::Blas>(order);
+            } else
+            {
+                std::cerr << "Skipping Blas for " << oclUtil::getOpenCLTypeName<DataType>()
+                          << ": needs a cblas build and a floating point data type\n";
+                return 0;
+            }
         default: throw std::runtime_error("Unsupported mat mult type\n");
     }
 }
 
-int dispatchMultDataType(int order, MatMultType multType, MatMultDataType dataType) 
+inline int dispatchMultDataType(int order, MatMultType multType, MatMultDataType dataType) 
 {
     switch (dataType)
     {
@@ -174,7 +453,7 @@ int dispatchMultDataType(int order, MatMultType multType, MatMultDataType dataTy
     }
 }
 
-int dispatchMatMultBenchmarks(
+inline int dispatchMatMultBenchmarks(
     const std::vector<int> &orderV, 
     const std::vector<MatMultType> &multTypeV, 
     const std::vector<MatMultDataType> &dataTypeV) 
@@ -196,4 +475,78 @@ int dispatchMatMultBenchmarks(
     return result;
 }
 
+// 1, 2, 4, ... up to and including maxCount.
+inline std::vector<uint32_t> scalingSteps(uint32_t maxCount)
+{
+    std::vector<uint32_t> steps;
+    for (uint32_t count = 1; count < maxCount; count *= 2)
+    {
+        steps.push_back(count);
+    }
+    if (maxCount > 0) steps.push_back(maxCount);
+    return steps;
+}
+
+// Strong scaling of the OpenCL kernels on sub-devices of the selected device with 1..N compute units, each step
+// followed by MultithreadSimd on the same number of threads. Needs a device that can be partitioned equally,
+// which in practice means a CPU device such as pocl.
+inline const std::vector<MatMultType> &computeUnitSweepTypes()
+{
+    static const std::vector<MatMultType> multTypeV = { MatMultType::NaiveOcl, MatMultType::TiledOcl, MatMultType::MultithreadSimd };
+    return multTypeV;
+}
+
+inline std::vector<uint32_t> computeUnitSweepSteps()
+{
+    const auto device = oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+    if (not oclUtil::supportsPartition(device.device, oclUtil::DevicePartition::equally(1)))
+    {
+        throw std::runtime_error("Compute unit sweep needs a device that supports equal partitioning, got " + 
+                                 device.description());
+    }
+    return scalingSteps(device.computeUnits);
+}
+
+// What runComputeUnitSweep measures, in the same order.
+inline std::vector<std::string> computeUnitSweepPlan(const std::vector<int> &orderV, const std::vector<MatMultDataType> &dataTypeV)
+{
+    std::vector<std::string> plan;
+    for (uint32_t computeUnits : computeUnitSweepSteps())
+    {
+        for (int order : orderV)
+        {
+            for (MatMultType multType : computeUnitSweepTypes())
+            {
+                for (MatMultDataType dataType : dataTypeV)
+                {
+                    const char *workers = multType == MatMultType::MultithreadSimd ? "threads" : "compute_units";
+                    plan.push_back(std::format("{:<20}{:<8}{}x{} {}={}", util::toString(multType), util::toString(dataType),
+                                               order, order, workers, computeUnits));
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+inline int runComputeUnitSweep(const std::vector<int> &orderV, const std::vector<MatMultDataType> &dataTypeV)
+{
+    const auto steps = computeUnitSweepSteps();
+    const auto savedPartition = oclUtil::defaultDevicePartition();
+    const auto savedThreadCount = hostThreadCount();
+    int result{0};
+
+    for (uint32_t computeUnits : steps)
+    {
+        oclUtil::defaultDevicePartition() = oclUtil::DevicePartition::equally(computeUnits);
+        hostThreadCount() = computeUnits;
+        result = dispatchMatMultBenchmarks(orderV, computeUnitSweepTypes(), dataTypeV);
+        if (result != 0) break;
+    }
+
+    oclUtil::defaultDevicePartition() = savedPartition;
+    hostThreadCount() = savedThreadCount;
+    return result;
+}
+
 } // namespace Benchmarks
\ No newline at end of file
@@ -0,0 +1,370 @@
+#pragma once
+
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Lazy matrix expressions: a * b * c, alpha * a * b and alpha * a * b + beta * d build an expression that is only
+// evaluated when it is assigned to a Matrix. Chains are multiplied in the FLOP-optimal order, intermediates live in
+// a per-thread arena and the scaling and addition run as the epilogue of the last product.
+// Expressions keep pointers to their operands, so they must not outlive them.
+namespace matrixExpr
+{
+
+template<typename M>
+concept MatrixLike = requires { typename M::DataT; }
+    && std::is_same_v<M, Matrix<typename M::DataT, M::Rows, M::Columns>>;
+
+// Bump allocator for the intermediates of one evaluation. The buffer only grows between evaluations and is kept
+// for the next one, so evaluating the same expression repeatedly does not allocate.
+class Arena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    static constexpr size_t alignUp(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    static Arena &threadLocal()
+    {
+        thread_local Arena arena;
+        return arena;
+    }
+
+    void reserve(size_t bytes)
+    {
+        if (m_used != 0) throw std::logic_error("Arena can only grow while it is empty");
+        if (bytes > capacity()) m_lines.resize(alignUp(bytes) / ALIGNMENT);
+    }
+
+    template<typename T>
+    T *allocate(size_t count)
+    {
+        const size_t bytes = alignUp(count * sizeof(T));
+        if (m_used + bytes > capacity()) throw std::runtime_error("Expression arena exhausted");
+        T *ptr = reinterpret_cast<T *>(reinterpret_cast<std::byte *>(m_lines.data()) + m_used);
+        m_used += bytes;
+        return ptr;
+    }
+
+    void reset() { m_used = 0; }
+
+    size_t capacity() const { return m_lines.size() * ALIGNMENT; }
+    size_t used() const { return m_used; }
+private:
+    struct alignas(ALIGNMENT) CacheLine
+    {
+        std::byte bytes[ALIGNMENT];
+    };
+
+    std::vector<CacheLine> m_lines;
+    size_t m_used = 0;
+};
+
+// Releases everything allocated during one evaluation, also when it throws.
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena &arena) : m_arena(arena) {}
+    ~ArenaScope() { m_arena.reset(); }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+private:
+    Arena &m_arena;
+};
+
+// Classic matrix-chain dynamic program over operand i being dims[i] x dims[i + 1]. cost counts multiply-adds and
+// split[i][j] is the last operand of the left factor of the product of operands i..j.
+template<size_t N>
+struct ChainPlan
+{
+    std::array<std::array<size_t, N>, N> split{};
+    std::array<std::array<uint64_t, N>, N> cost{};
+
+    double flops() const { return 2.0 * static_cast<double>(cost[0][N - 1]); }
+
+    std::string description(size_t i = 0, size_t j = N - 1) const
+    {
+        if (i == j) return "M" + std::to_string(i);
+        return "(" + description(i, split[i][j]) + " " + description(split[i][j] + 1, j) + ")";
+    }
+};
+
+template<size_t N>
+constexpr ChainPlan<N> planChain(const std::array<uint64_t, N + 1> &dims)
+{
+    ChainPlan<N> plan;
+    for (size_t length = 2; length <= N; ++length)
+    {
+        for (size_t i = 0; i + length <= N; ++i)
+        {
+            const size_t j = i + length - 1;
+            plan.cost[i][j] = std::numeric_limits<uint64_t>::max();
+            for (size_t s = i; s < j; ++s)
+            {
+                const uint64_t cost = plan.cost[i][s] + plan.cost[s + 1][j] + dims[i] * dims[s + 1] * dims[j + 1];
+                if (cost < plan.cost[i][j])
+                {
+                    plan.cost[i][j] = cost;
+                    plan.split[i][j] = s;
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// Flops of evaluating the chain in the order it is written, for comparison with the plan.
+template<size_t N>
+constexpr double leftToRightFlops(const std::array<uint64_t, N + 1> &dims)
+{
+    uint64_t cost = 0;
+    for (size_t i = 1; i < N; ++i) cost += dims[0] * dims[i] * dims[i + 1];
+    return 2.0 * static_cast<double>(cost);
+}
+
+// c = alpha * a * b + beta * addend for row major m x k and k x n operands with the active SIMD microkernel. The
+// addend may be c itself.
+template<typename T>
+void gemm(const T *a, const T *b, T *c, int m, int k, int n, T alpha, const T *addend, T beta)
+{
+    const size_t shapeIndex = simdTuner::activeShapeIndex<T>();
+    if (addend)
+    {
+        using Epi = epilogue::Ops<T, true, false, epilogue::Activation::None, true>;
+        simdRowKernels<T, Epi>[shapeIndex](a, b, c, n, k, 0, m, Epi{alpha, nullptr, addend, n, beta});
+    } else if (alpha != T(1))
+    {
+        using Epi = epilogue::Ops<T, true, false, epilogue::Activation::None, false>;
+        simdRowKernels<T, Epi>[shapeIndex](a, b, c, n, k, 0, m, Epi{alpha});
+    } else
+    {
+        simdRowKernels<T>[shapeIndex](a, b, c, n, k, 0, m, {});
+    }
+}
+
+template<typename T, size_t N>
+class ChainEvaluator
+{
+public:
+    ChainEvaluator(const ChainPlan<N> &plan, const std::array<uint64_t, N + 1> &dims,
+                   const std::array<const T *, N> &operands, Arena &arena)
+        : m_plan(plan), m_dims(dims), m_operands(operands), m_arena(arena) {}
+
+    // Arena bytes of every intermediate product below the product of operands i..j.
+    size_t intermediateBytes(size_t i, size_t j) const
+    {
+        if (i == j) return 0;
+        const size_t s = m_plan.split[i][j];
+        return intermediateBytes(i, s) + intermediateBytes(s + 1, j)
+            + (s > i ? Arena::alignUp(m_dims[i] * m_dims[s + 1] * sizeof(T)) : 0)
+            + (j > s + 1 ? Arena::alignUp(m_dims[s + 1] * m_dims[j + 1] * sizeof(T)) : 0);
+    }
+
+    const T *evaluate(size_t i, size_t j)
+    {
+        if (i == j) return m_operands[i];
+        T *out = m_arena.allocate<T>(m_dims[i] * m_dims[j + 1]);
+        evaluateInto(i, j, out, T(1), nullptr, T(0));
+        return out;
+    }
+
+    void evaluateInto(size_t i, size_t j, T *out, T alpha, const T *addend, T beta)
+    {
+        const size_t s = m_plan.split[i][j];
+        const T *left = evaluate(i, s);
+        const T *right = evaluate(s + 1, j);
+        gemm(left, right, out, static_cast<int>(m_dims[i]), static_cast<int>(m_dims[s + 1]),
+             static_cast<int>(m_dims[j + 1]), alpha, addend, beta);
+    }
+private:
+    const ChainPlan<N> &m_plan;
+    const std::array<uint64_t, N + 1> &m_dims;
+    const std::array<const T *, N> &m_operands;
+    Arena &m_arena;
+};
+
+template<MatrixLike... Ms>
+class Chain;
+
+template<MatrixLike First, MatrixLike... Rest>
+constexpr bool chainCompatible()
+{
+    constexpr std::array<int, sizeof...(Rest) + 1> columns = { First::Columns, Rest::Columns... };
+    constexpr std::array<int, sizeof...(Rest) + 1> rows = { First::Rows, Rest::Rows... };
+    for (size_t i = 0; i + 1 < columns.size(); ++i)
+    {
+        if (columns[i] != rows[i + 1]) return false;
+    }
+    return true;
+}
+
+template<typename E>
+inline constexpr bool isChain = false;
+
+template<typename... Ms>
+inline constexpr bool isChain<Chain<Ms...>> = true;
+
+template<MatrixLike First, MatrixLike... Rest>
+class Chain<First, Rest...>
+{
+public:
+    using DataT = typename First::DataT;
+    static constexpr size_t Length = 1 + sizeof...(Rest);
+    static constexpr std::array<uint64_t, Length + 1> dims = { First::Rows, First::Columns, Rest::Columns... };
+    static constexpr int Rows = First::Rows;
+    static constexpr int Columns = static_cast<int>(dims.back());
+    using ResultMatrix = Matrix<DataT, Rows, Columns>;
+
+    static_assert((std::is_same_v<DataT, typename Rest::DataT> && ...), "Chain operands must share a data type");
+    static_assert(chainCompatible<First, Rest...>(), "Chain operands have incompatible dimensions");
+
+    static constexpr ChainPlan<Length> plan = planChain<Length>(dims);
+
+    Chain(std::tuple<const First *, const Rest *...> operands, DataT alpha) : m_operands(operands), m_alpha(alpha) {}
+
+    const std::tuple<const First *, const Rest *...> &operands() const { return m_operands; }
+    DataT alpha() const { return m_alpha; }
+
+    std::array<const DataT *, Length> operandData() const
+    {
+        return std::apply([](const auto *...m) { return std::array<const DataT *, Length>{ m->data().data()... }; }, m_operands);
+    }
+
+    template<typename Dest>
+    void evaluateInto(Dest &dest) const { evaluateInto(dest, nullptr, DataT(0)); }
+
+    // dest = alpha * product + beta * addend. Operands that alias dest are detected and the product then goes to
+    // the arena first.
+    template<typename Dest>
+    void evaluateInto(Dest &dest, const DataT *addend, DataT beta) const
+    {
+        static_assert(std::is_same_v<Dest, ResultMatrix>, "Destination does not match the expression's shape");
+        const auto data = operandData();
+        DataT *out = dest.data().data();
+
+        if constexpr (Length == 1)
+        {
+            for (int e = 0; e < ResultMatrix::Size; ++e)
+            {
+                out[e] = m_alpha * data[0][e] + (addend ? beta * addend[e] : DataT(0));
+            }
+        } else
+        {
+            Arena &arena = Arena::threadLocal();
+            ArenaScope scope(arena);
+            ChainEvaluator<DataT, Length> evaluator(plan, dims, data, arena);
+
+            const bool aliased = std::ranges::find(data, out) != data.end();
+            arena.reserve(evaluator.intermediateBytes(0, Length - 1)
+                          + (aliased ? Arena::alignUp(ResultMatrix::Size * sizeof(DataT)) : 0));
+
+            DataT *target = aliased ? arena.allocate<DataT>(ResultMatrix::Size) : out;
+            evaluator.evaluateInto(0, Length - 1, target, m_alpha, addend, beta);
+            if (aliased) std::copy_n(target, ResultMatrix::Size, out);
+        }
+    }
+private:
+    std::tuple<const First *, const Rest *...> m_operands;
+    DataT m_alpha;
+};
+
+// alpha * chain + beta * addend, with alpha carried by the chain.
+template<typename ChainT, MatrixLike Addend>
+class Gemm
+{
+public:
+    using DataT = typename ChainT::DataT;
+    using ResultMatrix = typename ChainT::ResultMatrix;
+
+    static_assert(std::is_same_v<Addend, ResultMatrix>, "Addend does not match the product's shape");
+
+    Gemm(ChainT chain, const Addend &addend, DataT beta) : m_chain(chain), m_addend(&addend), m_beta(beta) {}
+
+    template<typename Dest>
+    void evaluateInto(Dest &dest) const { m_chain.evaluateInto(dest, m_addend->data().data(), m_beta); }
+private:
+    ChainT m_chain;
+    const Addend *m_addend;
+    DataT m_beta;
+};
+
+template<MatrixLike M>
+Chain<M> chainOf(const M &m, typename M::DataT alpha = 1)
+{
+    return Chain<M>(std::make_tuple(&m), alpha);
+}
+
+template<typename... As, typename... Bs>
+Chain<As..., Bs...> concat(const Chain<As...> &a, const Chain<Bs...> &b)
+{
+    return Chain<As..., Bs...>(std::tuple_cat(a.operands(), b.operands()), a.alpha() * b.alpha());
+}
+
+template<typename E>
+auto asChain(const E &e)
+{
+    if constexpr (isChain<E>) return e;
+    else return chainOf(e);
+}
+
+template<typename E>
+concept Factor = MatrixLike<E> || isChain<E>;
+
+} // namespace matrixExpr
+
+template<matrixExpr::Factor A, matrixExpr::Factor B>
+requires (matrixExpr::isChain<A> || matrixExpr::isChain<B> || CompatibleMatrices<A, B>)
+auto operator*(const A &a, const B &b)
+{
+    return matrixExpr::concat(matrixExpr::asChain(a), matrixExpr::asChain(b));
+}
+
+template<typename S, matrixExpr::Factor E>
+requires std::is_arithmetic_v<S>
+auto operator*(S scalar, const E &e)
+{
+    const auto chain = matrixExpr::asChain(e);
+    return std::decay_t<decltype(chain)>(chain.operands(), static_cast<typename E::DataT>(scalar) * chain.alpha());
+}
+
+template<typename S, matrixExpr::Factor E>
+requires std::is_arithmetic_v<S>
+auto operator*(const E &e, S scalar)
+{
+    return scalar * e;
+}
+
+// product + addend, where the addend is a matrix or a scaled matrix (a chain of one).
+template<typename... Ms, matrixExpr::Factor E>
+auto operator+(const matrixExpr::Chain<Ms...> &product, const E &addend)
+{
+    using ChainT = matrixExpr::Chain<Ms...>;
+    if constexpr (matrixExpr::isChain<E> && ChainT::Length == 1 && E::Length > 1)
+    {
+        return addend + product;
+    } else if constexpr (matrixExpr::isChain<E>)
+    {
+        static_assert(E::Length == 1, "Only a matrix or a scaled matrix can be added to a product");
+        return matrixExpr::Gemm<ChainT, std::remove_cvref_t<decltype(*std::get<0>(addend.operands()))>>(
+            product, *std::get<0>(addend.operands()), addend.alpha());
+    } else
+    {
+        return matrixExpr::Gemm<ChainT, E>(product, addend, typename E::DataT(1));
+    }
+}
+
+template<matrixExpr::MatrixLike M, typename... Ms>
+auto operator+(const M &addend, const matrixExpr::Chain<Ms...> &product)
+{
+    return product + addend;
+}
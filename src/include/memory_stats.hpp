@@ -0,0 +1,54 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <cstdint>
+
+namespace memory
+{
+
+struct AllocationStats
+{
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytesAllocated = 0;
+    // Highest amount of memory allocated inside the region and not yet freed, relative to its start.
+    uint64_t peakLiveBytes = 0;
+
+    AllocationStats &operator+=(const AllocationStats &other)
+    {
+        allocations += other.allocations;
+        deallocations += other.deallocations;
+        bytesAllocated += other.bytesAllocated;
+        peakLiveBytes = peakLiveBytes > other.peakLiveBytes ? peakLiveBytes : other.peakLiveBytes;
+        return *this;
+    }
+};
+
+// Global operator new/delete hooks are only built with -DTRACK_ALLOCATIONS=ON (glibc only). They count every
+// allocation of every thread while a region is open, which adds a few atomic operations to each allocation, so
+// timings of allocation heavy kernels are slightly inflated in such builds.
+bool allocationTrackingEnabled();
+
+// Regions do not nest; allocations of threads that outlive the region are attributed to whichever region is open.
+void beginRegion();
+AllocationStats endRegion();
+
+struct ProcessMemory
+{
+    // getrusage high water mark, VmHWM and VmRSS from /proc/self/status; 0 when unknown.
+    uint64_t maxRssBytes = 0;
+    uint64_t highWaterMarkBytes = 0;
+    uint64_t residentBytes = 0;
+};
+
+ProcessMemory processMemory();
+
+// Resets the VmHWM high water mark through /proc/self/clear_refs, returns false where that is not possible. The
+// getrusage maximum cannot be reset and always covers the whole process lifetime.
+bool resetPeakResidentSet();
+
+boost::json::object toJson(const AllocationStats &totals, uint32_t iterations, const ProcessMemory &process, 
+                           bool peakWasReset);
+
+} // namespace memory
@@ -0,0 +1,390 @@
+#pragma once
+
+#include "constants.hpp"
+#include "ocl_utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace oclTuner
+{
+
+struct TiledKernelConfig
+{
+    uint32_t tileSize = 16;
+    uint32_t workPerThread = 1;
+
+    std::string buildOptions() const { return std::format("-DTS={} -DWPT={}", tileSize, workPerThread); }
+    size_t workGroupSize() const { return static_cast<size_t>(tileSize) * tileSize / workPerThread; }
+
+    bool operator==(const TiledKernelConfig &) const = default;
+};
+
+enum class ShapeClass
+{
+    Small = 0,
+    Medium,
+    Large
+};
+
+inline ShapeClass shapeClassOf(int order)
+{
+    if (order < 256) return ShapeClass::Small;
+    if (order < 1024) return ShapeClass::Medium;
+    return ShapeClass::Large;
+}
+
+inline int representativeOrder(ShapeClass shapeClass)
+{
+    switch (shapeClass)
+    {
+        case ShapeClass::Small: return 128;
+        case ShapeClass::Medium: return 512;
+        default: return 1024;
+    }
+}
+
+std::string toString(ShapeClass shapeClass);
+
+struct TuningEntry
+{
+    TiledKernelConfig config;
+    double kernelSeconds = 0.0;
+};
+
+// Best tiled kernel configuration per (device, data type, shape class), persisted as JSON.
+class TuningDatabase
+{
+public:
+    explicit TuningDatabase(std::filesystem::path path) : m_path(std::move(path)) {}
+
+    // Process-wide database at constants::OCL_TUNING_DB_PATH, loaded on first use.
+    static TuningDatabase &instance();
+
+    static std::string makeKey(std::string_view device, std::string_view dataType, ShapeClass shapeClass);
+
+    std::optional<TuningEntry> lookup(std::string_view device, std::string_view dataType, ShapeClass shapeClass) const;
+
+    void store(std::string_view device, std::string_view dataType, ShapeClass shapeClass, const TuningEntry &entry);
+
+    void load();
+
+    void save() const;
+
+    const std::filesystem::path &path() const { return m_path; }
+private:
+    std::filesystem::path m_path;
+    std::map<std::string, TuningEntry> m_entries;
+    mutable std::mutex m_mutex;
+};
+
+inline bool fitsDevice(const TiledKernelConfig &config, cl_device_id device, size_t elementSize)
+{
+    const auto maxWorkGroupSize = oclUtil::getDeviceInfo<size_t>(device, CL_DEVICE_MAX_WORK_GROUP_SIZE);
+    const auto localMemSize = oclUtil::getDeviceInfo<cl_ulong>(device, CL_DEVICE_LOCAL_MEM_SIZE);
+
+    size_t maxWorkItemSizes[3] = {};
+    cl_int err = clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(maxWorkItemSizes), maxWorkItemSizes, nullptr);
+    CHECK_CL_ERROR(err, "clGetDeviceInfo");
+
+    return config.workPerThread <= config.tileSize
+        && config.tileSize % config.workPerThread == 0
+        && config.workGroupSize() <= maxWorkGroupSize
+        && config.tileSize <= maxWorkItemSizes[0]
+        && config.tileSize / config.workPerThread <= maxWorkItemSizes[1]
+        && 2 * static_cast<cl_ulong>(config.tileSize) * config.tileSize * elementSize <= localMemSize;
+}
+
+inline std::pair<std::array<size_t, 2>, std::array<size_t, 2>> workSizes(const TiledKernelConfig &config, size_t rows, size_t columns)
+{
+    const size_t tile = config.tileSize;
+    const std::array<size_t, 2> global = {
+        (columns + tile - 1) / tile * tile, 
+        (rows + tile - 1) / tile * tile / config.workPerThread
+    };
+    const std::array<size_t, 2> local = {tile, tile / config.workPerThread};
+    return {global, local};
+}
+
+struct TuningResult
+{
+    TiledKernelConfig config;
+    double kernelSeconds = std::numeric_limits<double>::infinity();
+    uint32_t variantsMeasured = 0;
+    uint32_t variantsPruned = 0;
+    uint32_t variantsFailed = 0;
+};
+
+// Searches tile size first at WPT = 1, keeps the best tile sizes and then grows WPT for them
+// until it stops paying off. Variants that don't fit the device limits are never built.
+template<typename T>
+class TiledKernelTuner
+{
+public:
+    inline static constexpr std::array<uint32_t, 4> TileSizes = {4, 8, 16, 32};
+    inline static constexpr std::array<uint32_t, 4> WorkPerThread = {1, 2, 4, 8};
+    inline static constexpr size_t KeptTileSizes = 2;
+    inline static constexpr double WorseThreshold = 1.1;
+
+    TiledKernelTuner(const oclUtil::DeviceInfo &device, int order, uint32_t repeats = 3) : 
+        m_device(device), m_order(order), m_repeats(repeats)
+    {
+        std::mt19937 gen(1u);
+        std::uniform_int_distribution<int> distrib(0, 10);
+        m_a.resize(static_cast<size_t>(order) * order);
+        m_b.resize(static_cast<size_t>(order) * order);
+        std::ranges::generate(m_a, [&]() { return static_cast<T>(distrib(gen)); });
+        std::ranges::generate(m_b, [&]() { return static_cast<T>(distrib(gen)); });
+    }
+
+    TuningResult run()
+    {
+        TuningResult result;
+        std::vector<std::pair<double, uint32_t>> tileTimes;
+
+        for (uint32_t tileSize : TileSizes)
+        {
+            const TiledKernelConfig config{tileSize, 1};
+            if (not isWorthTrying(config)) 
+            {
+                ++result.variantsPruned;
+                continue;
+            }
+            if (auto seconds = measure(config, result))
+            {
+                tileTimes.emplace_back(*seconds, tileSize);
+                consider(config, *seconds, result);
+            }
+        }
+
+        std::ranges::sort(tileTimes);
+        if (tileTimes.size() > KeptTileSizes)
+        {
+            result.variantsPruned += static_cast<uint32_t>((tileTimes.size() - KeptTileSizes) * (WorkPerThread.size() - 1));
+            tileTimes.resize(KeptTileSizes);
+        }
+
+        for (const auto &[baseSeconds, tileSize] : tileTimes)
+        {
+            double bestForTile = baseSeconds;
+            for (size_t w = 1; w < WorkPerThread.size(); ++w)
+            {
+                const TiledKernelConfig config{tileSize, WorkPerThread[w]};
+                if (not isWorthTrying(config))
+                {
+                    ++result.variantsPruned;
+                    continue;
+                }
+                auto seconds = measure(config, result);
+                if (not seconds) continue;
+
+                consider(config, *seconds, result);
+                if (*seconds > bestForTile * WorseThreshold)
+                {
+                    result.variantsPruned += static_cast<uint32_t>(WorkPerThread.size() - 1 - w);
+                    break;
+                }
+                bestForTile = std::min(bestForTile, *seconds);
+            }
+        }
+
+        if (result.variantsMeasured == 0)
+        {
+            throw std::runtime_error("No tiled kernel variant could be built for " + m_device.description());
+        }
+        return result;
+    }
+private:
+    bool isWorthTrying(const TiledKernelConfig &config) const
+    {
+        // Tiles larger than the matrix only add padding work.
+        return fitsDevice(config, m_device.device, sizeof(T))
+            && (config.tileSize <= static_cast<uint32_t>(m_order) || config.tileSize == TileSizes.front());
+    }
+
+    static void consider(const TiledKernelConfig &config, double seconds, TuningResult &result)
+    {
+        if (seconds < result.kernelSeconds)
+        {
+            result.kernelSeconds = seconds;
+            result.config = config;
+        }
+    }
+
+    std::optional<double> measure(const TiledKernelConfig &config, TuningResult &result)
+    {
+        try
+        {
+            const double seconds = measureOrThrow(config);
+            ++result.variantsMeasured;
+            return seconds;
+        } catch (const std::runtime_error &e)
+        {
+            ++result.variantsFailed;
+            std::cerr << std::format("Tiled variant TS={} WPT={} failed: {}\n", config.tileSize, config.workPerThread, e.what());
+            return std::nullopt;
+        }
+    }
+
+    double measureOrThrow(const TiledKernelConfig &config)
+    {
+        cl_int err;
+        const cl_uint order = static_cast<cl_uint>(m_order);
+        const size_t bytes = sizeof(T) * m_a.size();
+
+        oclUtil::ProgramWithQueue program("mat_mult.cl");
+        program.initialize(m_device);
+        const std::string buildOptions = "-DT=" + oclUtil::getOpenCLTypeName<T>() + " " + config.buildOptions();
+        program.build(buildOptions.c_str());
+        program.createQueueAndKernel("tiled_mat_mult", true);
+
+        oclUtil::memWrapper bufA = clCreateBuffer(program.getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, m_a.data(), &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+        oclUtil::memWrapper bufB = clCreateBuffer(program.getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, m_b.data(), &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+        oclUtil::memWrapper bufC = clCreateBuffer(program.getContext(), CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+        CHECK_CL_ERROR(err, "clCreateBuffer");
+
+        clSetKernelArg(program.getKernel(), 0, sizeof(cl_mem), &bufA);
+        clSetKernelArg(program.getKernel(), 1, sizeof(cl_mem), &bufB);
+        clSetKernelArg(program.getKernel(), 2, sizeof(cl_mem), &bufC);
+        clSetKernelArg(program.getKernel(), 3, sizeof(cl_uint), &order);
+        clSetKernelArg(program.getKernel(), 4, sizeof(cl_uint), &order);
+        clSetKernelArg(program.getKernel(), 5, sizeof(cl_uint), &order);
+
+        const auto [globalWorkSize, localWorkSize] = workSizes(config, order, order);
+
+        double best = std::numeric_limits<double>::infinity();
+        for (uint32_t i = 0; i <= m_repeats; ++i)
+        {
+            oclUtil::eventWrapper event;
+            err = clEnqueueNDRangeKernel(program.getCmdQueue(), program.getKernel(), 2, nullptr, 
+                                         globalWorkSize.data(), localWorkSize.data(), 0, nullptr, &event);
+            CHECK_CL_ERROR(err, "clEnqueueNDRangeKernel");
+            err = clWaitForEvents(1, &event);
+            CHECK_CL_ERROR(err, "clWaitForEvents");
+
+            // The first launch warms up the device and is not counted.
+            if (i > 0) best = std::min(best, oclUtil::getEventDurationSeconds(event));
+        }
+
+        std::vector<T> c(m_a.size());
+        err = clEnqueueReadBuffer(program.getCmdQueue(), bufC, CL_TRUE, 0, bytes, c.data(), 0, nullptr, nullptr);
+        CHECK_CL_ERROR(err, "clEnqueueReadBuffer");
+        verifySample(c);
+
+        return best;
+    }
+
+    void verifySample(const std::vector<T> &c) const
+    {
+        std::mt19937 gen(2u);
+        std::uniform_int_distribution<int> distrib(0, m_order - 1);
+        for (int sample = 0; sample < 64; ++sample)
+        {
+            const int i = distrib(gen);
+            const int j = distrib(gen);
+            T expected = 0;
+            for (int k = 0; k < m_order; ++k)
+            {
+                expected += m_a[i * m_order + k] * m_b[k * m_order + j];
+            }
+            if (c[i * m_order + j] != expected)
+            {
+                throw std::runtime_error("wrong result");
+            }
+        }
+    }
+
+    oclUtil::DeviceInfo m_device;
+    int m_order;
+    uint32_t m_repeats;
+    std::vector<T> m_a;
+    std::vector<T> m_b;
+};
+
+// The kernels are shared by every order of the shape class, so setting their arguments and enqueueing is done
+// under kernelMutex.
+struct TiledProgram
+{
+    std::unique_ptr<oclUtil::ProgramWithQueue> program;
+    TiledKernelConfig config;
+    bool fromDatabase = false;
+    std::mutex kernelMutex;
+    // Created on first use of an unfused epilogue, guarded by kernelMutex.
+    oclUtil::kernelWrapper epiloguePassKernel;
+};
+
+// Tuning database entry for the device and shape class, or the default configuration, halved until it fits the
+// device.
+template<typename T>
+std::pair<TiledKernelConfig, bool> resolveTiledConfig(const oclUtil::DeviceInfo &device, ShapeClass shapeClass)
+{
+    TiledKernelConfig config;
+    bool fromDatabase = false;
+    if (auto entry = TuningDatabase::instance().lookup(oclUtil::deviceKey(device.device), oclUtil::getOpenCLTypeName<T>(), shapeClass))
+    {
+        config = entry->config;
+        fromDatabase = true;
+    }
+    while (not fitsDevice(config, device.device, sizeof(T)) && config.tileSize > 1)
+    {
+        config = TiledKernelConfig{config.tileSize / 2, 1};
+    }
+    return {config, fromDatabase};
+}
+
+// Tiled program for the default device and partition, configured from the tuning database and built once per
+// (type, shape class, partition, extra options). extraOptions select e.g. a fused epilogue, see epilogue.hpp.
+template<typename T>
+TiledProgram &tiledProgram(int order, const std::string &extraOptions = "")
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<ShapeClass, std::string, std::string>, TiledProgram> programs;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const ShapeClass shapeClass = shapeClassOf(order);
+    const auto &partition = oclUtil::defaultDevicePartition();
+    const auto key = std::make_tuple(shapeClass, partition.description(), extraOptions);
+    auto it = programs.find(key);
+    if (it != programs.end()) return it->second;
+
+    const auto device = oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+    const auto [config, fromDatabase] = resolveTiledConfig<T>(device, shapeClass);
+
+    auto program = std::make_unique<oclUtil::ProgramWithQueue>("mat_mult.cl");
+    program->initialize(device, partition);
+    std::string buildOptions = "-DT=" + oclUtil::getOpenCLTypeName<T>() + " " + config.buildOptions();
+    if (not extraOptions.empty()) buildOptions += " " + extraOptions;
+    program->build(buildOptions.c_str());
+    program->createQueueAndKernel("tiled_mat_mult");
+
+    // Built in place, the mutex pins the entry.
+    auto &tiled = programs[key];
+    tiled.program = std::move(program);
+    tiled.config = config;
+    tiled.fromDatabase = fromDatabase;
+    return tiled;
+}
+
+// Tunes every data type and shape class on the device and stores the winners in the database.
+boost::json::array autotuneDevice(const oclUtil::DeviceInfo &device, TuningDatabase &database);
+
+} // namespace oclTuner
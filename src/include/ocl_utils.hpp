@@ -3,15 +3,22 @@
 #define CL_TARGET_OPENCL_VERSION 300
 
 #include "constants.hpp"
+#include "kernel_registry.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 #include <CL/cl.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <format>
+#include <iostream>
 #include <memory>
+#include <ranges>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #define CHECK_CL_ERROR(err, func) if (err != CL_SUCCESS) { throw std::runtime_error(std::string(func) + " FAILED: " + oclUtil::clErrorToString(err)); }
 
@@ -83,6 +90,7 @@ inline const char *clErrorToString(int errorCode) {
         case -70: return "CL_INVALID_DEVICE_QUEUE";
         case -71: return "CL_INVALID_SPEC_ID";
         case -72: return "CL_MAX_SIZE_RESTRICTION_EXCEEDED";
+        case -1001: return "CL_PLATFORM_NOT_FOUND_KHR";
         default: return "CL_UNKNOWN_ERROR";
     }
 }
@@ -138,49 +146,493 @@ using memWrapper = Wrapper<cl_mem, clReleaseMemObject>;
 
 using cmdQueueWrapper = Wrapper<cl_command_queue, clReleaseCommandQueue>;
 
-class Program
+using eventWrapper = Wrapper<cl_event, clReleaseEvent>;
+
+using deviceWrapper = Wrapper<cl_device_id, clReleaseDevice>;
+
+inline double getEventDurationSeconds(cl_event event)
+{
+    cl_ulong start{0};
+    cl_ulong end{0};
+
+    cl_int err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr);
+    CHECK_CL_ERROR(err, "clGetEventProfilingInfo");
+
+    err = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr);
+    CHECK_CL_ERROR(err, "clGetEventProfilingInfo");
+
+    return static_cast<double>(end - start) * 1e-9;
+}
+
+inline constexpr const cl_int PLATFORM_NOT_FOUND_KHR = -1001;
+
+inline std::string getPlatformInfoString(cl_platform_id platform, cl_platform_info param)
+{
+    size_t size{0};
+    cl_int err = clGetPlatformInfo(platform, param, 0, nullptr, &size);
+    CHECK_CL_ERROR(err, "clGetPlatformInfo");
+
+    std::string value(size, '\0');
+    err = clGetPlatformInfo(platform, param, size, value.data(), nullptr);
+    CHECK_CL_ERROR(err, "clGetPlatformInfo");
+
+    value.resize(value.find('\0') == std::string::npos ? value.size() : value.find('\0'));
+    return value;
+}
+
+inline std::string getDeviceInfoString(cl_device_id device, cl_device_info param)
+{
+    size_t size{0};
+    cl_int err = clGetDeviceInfo(device, param, 0, nullptr, &size);
+    CHECK_CL_ERROR(err, "clGetDeviceInfo");
+
+    std::string value(size, '\0');
+    err = clGetDeviceInfo(device, param, size, value.data(), nullptr);
+    CHECK_CL_ERROR(err, "clGetDeviceInfo");
+
+    value.resize(value.find('\0') == std::string::npos ? value.size() : value.find('\0'));
+    return value;
+}
+
+// Puts a kernel on its device's track in the trace, from the enqueue call to the completion the host observes.
+// Waits for the kernel only while tracing.
+class KernelTrace
 {
 public:
-    Program() = default;
+    explicit KernelTrace(const char *name) : m_name(name), m_enqueueNs(trace::timestamp()) {}
 
-    Program(std::filesystem::path kernelFilename) : m_kernelFilename(kernelFilename) {}
+    void complete(cl_event event, cl_device_id device) const
+    {
+        if (not m_enqueueNs || not event) return;
+        clWaitForEvents(1, &event);
+        trace::recordTrackEvent(getDeviceInfoString(device, CL_DEVICE_NAME), m_name, "opencl", m_enqueueNs, trace::nowNs());
+    }
+private:
+    const char *m_name;
+    uint64_t m_enqueueNs;
+};
+
+template<typename T>
+T getDeviceInfo(cl_device_id device, cl_device_info param)
+{
+    T value{};
+    cl_int err = clGetDeviceInfo(device, param, sizeof(T), &value, nullptr);
+    CHECK_CL_ERROR(err, "clGetDeviceInfo");
+    return value;
+}
+
+inline std::string deviceTypeToString(cl_device_type type)
+{
+    if (type & CL_DEVICE_TYPE_GPU) return "gpu";
+    if (type & CL_DEVICE_TYPE_CPU) return "cpu";
+    if (type & CL_DEVICE_TYPE_ACCELERATOR) return "accelerator";
+    if (type & CL_DEVICE_TYPE_CUSTOM) return "custom";
+    return "default";
+}
+
+inline cl_device_type deviceTypeFromString(std::string_view str)
+{
+    const std::string strLower = util::toLower(str);
+    if (strLower == "gpu") { return CL_DEVICE_TYPE_GPU; }
+    if (strLower == "cpu") { return CL_DEVICE_TYPE_CPU; }
+    if (strLower == "accelerator") { return CL_DEVICE_TYPE_ACCELERATOR; }
+    if (strLower == "custom") { return CL_DEVICE_TYPE_CUSTOM; }
+    if (strLower == "all") { return CL_DEVICE_TYPE_ALL; }
+    throw std::invalid_argument("Unknown OpenCL device type: " + std::string(str));
+}
 
-    Program(std::filesystem::path kernelFilename, const char *options)
+struct DeviceInfo
+{
+    cl_platform_id platform = nullptr;
+    cl_device_id device = nullptr;
+    std::string platformName;
+    std::string deviceName;
+    cl_device_type type = CL_DEVICE_TYPE_DEFAULT;
+    cl_uint computeUnits = 0;
+
+    std::string description() const
     {
-        m_kernelFilename = kernelFilename;
-        cl_int err;
+        return std::format("{} / {} ({}, {} CUs)", platformName, deviceName, deviceTypeToString(type), computeUnits);
+    }
+};
 
-        std::unique_ptr<char[]> kernelSource = util::loadDataFromFile(constants::KERNELS_DIR / kernelFilename);
-        const char *source[] = {kernelSource.get()};
-        
-        err = clGetPlatformIDs(1, &m_platform, nullptr);
-        CHECK_CL_ERROR(err, "clGetPlatformIDs");
-        
-        err = clGetDeviceIDs(m_platform, CL_DEVICE_TYPE_ALL, 1, &m_device, nullptr);
+inline std::string deviceKey(cl_device_id device)
+{
+    const auto platform = getDeviceInfo<cl_platform_id>(device, CL_DEVICE_PLATFORM);
+    return getPlatformInfoString(platform, CL_PLATFORM_NAME) + " / " + getDeviceInfoString(device, CL_DEVICE_NAME);
+}
+
+inline bool supportsSpirv(cl_device_id device)
+{
+    size_t size{0};
+    if (clGetDeviceInfo(device, CL_DEVICE_IL_VERSION, 0, nullptr, &size) != CL_SUCCESS || size == 0) return false;
+    return getDeviceInfoString(device, CL_DEVICE_IL_VERSION).find("SPIR-V") != std::string::npos;
+}
+
+inline std::vector<DeviceInfo> enumerateDevices()
+{
+    cl_uint platformCount{0};
+    cl_int err = clGetPlatformIDs(0, nullptr, &platformCount);
+    if (err == PLATFORM_NOT_FOUND_KHR) return {};
+    CHECK_CL_ERROR(err, "clGetPlatformIDs");
+
+    std::vector<cl_platform_id> platforms(platformCount);
+    err = clGetPlatformIDs(platformCount, platforms.data(), nullptr);
+    CHECK_CL_ERROR(err, "clGetPlatformIDs");
+
+    std::vector<DeviceInfo> devices;
+    for (cl_platform_id platform : platforms)
+    {
+        cl_uint deviceCount{0};
+        err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &deviceCount);
+        if (err == CL_DEVICE_NOT_FOUND) continue;
         CHECK_CL_ERROR(err, "clGetDeviceIDs");
 
-        m_context = clCreateContext(nullptr, 1, &m_device, nullptr, nullptr, &err);
-        CHECK_CL_ERROR(err, "clCreateContext");
+        std::vector<cl_device_id> ids(deviceCount);
+        err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, deviceCount, ids.data(), nullptr);
+        CHECK_CL_ERROR(err, "clGetDeviceIDs");
 
-        m_program = clCreateProgramWithSource(m_context, 1, source, nullptr, &err);
-        CHECK_CL_ERROR(err, "clCreateProgramWithSource");
+        const std::string platformName = getPlatformInfoString(platform, CL_PLATFORM_NAME);
+        for (cl_device_id id : ids)
+        {
+            devices.push_back(DeviceInfo{
+                platform,
+                id,
+                platformName,
+                getDeviceInfoString(id, CL_DEVICE_NAME),
+                getDeviceInfo<cl_device_type>(id, CL_DEVICE_TYPE),
+                getDeviceInfo<cl_uint>(id, CL_DEVICE_MAX_COMPUTE_UNITS)
+            });
+        }
+    }
+    return devices;
+}
 
-        err = clBuildProgram(m_program, 1, &m_device, options, nullptr, nullptr);
-        CHECK_CL_ERROR(err, "clBuildProgram");
+// Spec format: comma separated key=value pairs, e.g. "platform=pocl,type=cpu,name=ryzen,index=0".
+// Name matching is a case-insensitive substring search.
+struct DeviceSelector
+{
+    std::string platformName;
+    std::string deviceName;
+    cl_device_type type = CL_DEVICE_TYPE_ALL;
+    uint32_t index = 0;
+
+    bool matches(const DeviceInfo &info) const
+    {
+        auto contains = [](std::string_view haystack, std::string_view needle)
+        {
+            return needle.empty() || util::toLower(haystack).find(util::toLower(needle)) != std::string::npos;
+        };
+        return (info.type & type) && contains(info.platformName, platformName) && contains(info.deviceName, deviceName);
+    }
+
+    static DeviceSelector parse(std::string_view spec)
+    {
+        DeviceSelector selector;
+        for (auto part : std::views::split(spec, ','))
+        {
+            std::string_view token(part.begin(), part.end());
+            if (token.empty()) continue;
+
+            const auto eq = token.find('=');
+            if (eq == std::string_view::npos)
+            {
+                throw std::invalid_argument("Invalid device selector token: " + std::string(token));
+            }
+            const std::string key = util::toLower(token.substr(0, eq));
+            const std::string_view value = token.substr(eq + 1);
+
+            if (key == "platform") { selector.platformName = value; }
+            else if (key == "name") { selector.deviceName = value; }
+            else if (key == "type") { selector.type = deviceTypeFromString(value); }
+            else if (key == "index") { selector.index = static_cast<uint32_t>(std::stoul(std::string(value))); }
+            else { throw std::invalid_argument("Unknown device selector key: " + key); }
+        }
+        return selector;
+    }
+};
+
+inline std::vector<DeviceInfo> selectDevices(const DeviceSelector &selector)
+{
+    std::vector<DeviceInfo> selected;
+    std::ranges::copy_if(enumerateDevices(), std::back_inserter(selected),
+                         [&selector](const DeviceInfo &info) { return selector.matches(info); });
+    return selected;
+}
+
+inline DeviceInfo selectDevice(const DeviceSelector &selector)
+{
+    const auto selected = selectDevices(selector);
+    if (selector.index >= selected.size())
+    {
+        throw std::runtime_error(std::format("No OpenCL device matches selector (found {}, requested index {})", 
+                                             selected.size(), selector.index));
+    }
+    return selected[selector.index];
+}
+
+inline DeviceSelector &defaultDeviceSelector()
+{
+    static DeviceSelector selector;
+    return selector;
+}
+
+inline std::string affinityDomainToString(cl_device_affinity_domain domain)
+{
+    switch (domain)
+    {
+        case CL_DEVICE_AFFINITY_DOMAIN_NUMA: return "numa";
+        case CL_DEVICE_AFFINITY_DOMAIN_L4_CACHE: return "l4";
+        case CL_DEVICE_AFFINITY_DOMAIN_L3_CACHE: return "l3";
+        case CL_DEVICE_AFFINITY_DOMAIN_L2_CACHE: return "l2";
+        case CL_DEVICE_AFFINITY_DOMAIN_L1_CACHE: return "l1";
+        default: return "next";
+    }
+}
+
+inline cl_device_affinity_domain affinityDomainFromString(std::string_view str)
+{
+    const std::string strLower = util::toLower(str);
+    if (strLower == "numa") { return CL_DEVICE_AFFINITY_DOMAIN_NUMA; }
+    if (strLower == "l4") { return CL_DEVICE_AFFINITY_DOMAIN_L4_CACHE; }
+    if (strLower == "l3") { return CL_DEVICE_AFFINITY_DOMAIN_L3_CACHE; }
+    if (strLower == "l2") { return CL_DEVICE_AFFINITY_DOMAIN_L2_CACHE; }
+    if (strLower == "l1") { return CL_DEVICE_AFFINITY_DOMAIN_L1_CACHE; }
+    if (strLower == "next") { return CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE; }
+    throw std::invalid_argument("Unknown OpenCL affinity domain: " + std::string(str));
+}
+
+// Spec format: "equally=<compute units>" or "affinity=<numa|l4|l3|l2|l1|next>", optionally with ",index=<n>"
+// to pick a sub-device other than the first one.
+struct DevicePartition
+{
+    enum class Kind
+    {
+        None = 0,
+        Equally,
+        ByAffinityDomain
+    };
+
+    Kind kind = Kind::None;
+    cl_uint computeUnits = 0;
+    cl_device_affinity_domain affinityDomain = CL_DEVICE_AFFINITY_DOMAIN_NEXT_PARTITIONABLE;
+    uint32_t index = 0;
+
+    static DevicePartition equally(cl_uint computeUnits) { return {Kind::Equally, computeUnits}; }
+
+    static DevicePartition byAffinityDomain(cl_device_affinity_domain domain) 
+    { 
+        return {Kind::ByAffinityDomain, 0, domain}; 
+    }
+
+    std::vector<cl_device_partition_property> properties() const
+    {
+        switch (kind)
+        {
+            case Kind::Equally: 
+                return {CL_DEVICE_PARTITION_EQUALLY, static_cast<cl_device_partition_property>(computeUnits), 0};
+            case Kind::ByAffinityDomain: 
+                return {CL_DEVICE_PARTITION_BY_AFFINITY_DOMAIN, static_cast<cl_device_partition_property>(affinityDomain), 0};
+            default: 
+                return {};
+        }
+    }
+
+    std::string description() const
+    {
+        switch (kind)
+        {
+            case Kind::Equally: return std::format("equally={},index={}", computeUnits, index);
+            case Kind::ByAffinityDomain: return std::format("affinity={},index={}", affinityDomainToString(affinityDomain), index);
+            default: return "none";
+        }
+    }
+
+    bool operator==(const DevicePartition &) const = default;
+
+    static DevicePartition parse(std::string_view spec)
+    {
+        DevicePartition partition;
+        for (auto part : std::views::split(spec, ','))
+        {
+            std::string_view token(part.begin(), part.end());
+            if (token.empty()) continue;
+
+            const auto eq = token.find('=');
+            if (eq == std::string_view::npos)
+            {
+                throw std::invalid_argument("Invalid device partition token: " + std::string(token));
+            }
+            const std::string key = util::toLower(token.substr(0, eq));
+            const std::string_view value = token.substr(eq + 1);
+
+            if (key == "equally") 
+            { 
+                partition.kind = Kind::Equally;
+                partition.computeUnits = static_cast<cl_uint>(std::stoul(std::string(value)));
+                if (partition.computeUnits == 0) throw std::invalid_argument("Device partition needs at least 1 compute unit");
+            }
+            else if (key == "affinity") 
+            { 
+                partition.kind = Kind::ByAffinityDomain;
+                partition.affinityDomain = affinityDomainFromString(value);
+            }
+            else if (key == "index") { partition.index = static_cast<uint32_t>(std::stoul(std::string(value))); }
+            else { throw std::invalid_argument("Unknown device partition key: " + key); }
+        }
+        return partition;
+    }
+};
+
+inline bool supportsPartition(cl_device_id device, const DevicePartition &partition)
+{
+    if (partition.kind == DevicePartition::Kind::None) return true;
+
+    size_t size{0};
+    if (clGetDeviceInfo(device, CL_DEVICE_PARTITION_PROPERTIES, 0, nullptr, &size) != CL_SUCCESS || size == 0) return false;
+
+    std::vector<cl_device_partition_property> supported(size / sizeof(cl_device_partition_property));
+    cl_int err = clGetDeviceInfo(device, CL_DEVICE_PARTITION_PROPERTIES, size, supported.data(), nullptr);
+    CHECK_CL_ERROR(err, "clGetDeviceInfo");
+
+    const cl_device_partition_property requested = partition.properties().front();
+    if (std::ranges::find(supported, requested) == supported.end()) return false;
+
+    if (partition.kind == DevicePartition::Kind::Equally)
+    {
+        return partition.computeUnits <= getDeviceInfo<cl_uint>(device, CL_DEVICE_MAX_COMPUTE_UNITS);
+    }
+    return getDeviceInfo<cl_device_affinity_domain>(device, CL_DEVICE_PARTITION_AFFINITY_DOMAIN) & partition.affinityDomain;
+}
+
+// The caller owns the returned sub-devices and has to release them with clReleaseDevice.
+inline std::vector<cl_device_id> createSubDevices(cl_device_id device, const DevicePartition &partition)
+{
+    if (not supportsPartition(device, partition))
+    {
+        throw std::runtime_error("OpenCL device " + getDeviceInfoString(device, CL_DEVICE_NAME) + 
+                                 " does not support partition " + partition.description());
+    }
+
+    const auto properties = partition.properties();
+    cl_uint count{0};
+    cl_int err = clCreateSubDevices(device, properties.data(), 0, nullptr, &count);
+    CHECK_CL_ERROR(err, "clCreateSubDevices");
+
+    std::vector<cl_device_id> subDevices(count);
+    err = clCreateSubDevices(device, properties.data(), count, subDevices.data(), nullptr);
+    CHECK_CL_ERROR(err, "clCreateSubDevices");
+
+    return subDevices;
+}
+
+// Applied by Program::initialize() on top of the device picked by defaultDeviceSelector().
+inline DevicePartition &defaultDevicePartition()
+{
+    static DevicePartition partition;
+    return partition;
+}
+
+class Program
+{
+public:
+    Program() = default;
+
+    Program(std::filesystem::path kernelFilename) : m_kernelFilename(kernelFilename) {}
+
+    Program(std::filesystem::path kernelFilename, const char *options) : m_kernelFilename(kernelFilename)
+    {
+        initialize();
+        build(options);
     }
 
     Program(const char *kernelSource, const char *options)
+    {
+        initialize();
+        buildFromSource(kernelSource, options);
+    }
+
+    void initialize() { initialize(selectDevice(defaultDeviceSelector()), defaultDevicePartition()); }
+
+    // Runs on one sub-device of deviceInfo, so CPU devices can be limited to a subset of their compute units.
+    void initialize(const DeviceInfo &deviceInfo, const DevicePartition &partition)
+    {
+        if (partition.kind == DevicePartition::Kind::None)
+        {
+            initialize(deviceInfo);
+            return;
+        }
+
+        std::vector<cl_device_id> subDevices = createSubDevices(deviceInfo.device, partition);
+        if (partition.index >= subDevices.size())
+        {
+            for (cl_device_id subDevice : subDevices) clReleaseDevice(subDevice);
+            throw std::runtime_error(std::format("Device partition {} produced only {} sub-devices", 
+                                                 partition.description(), subDevices.size()));
+        }
+
+        for (size_t i = 0; i < subDevices.size(); ++i)
+        {
+            if (i != partition.index) clReleaseDevice(subDevices[i]);
+        }
+        m_subDevice.reset(subDevices[partition.index]);
+
+        DeviceInfo subDeviceInfo = deviceInfo;
+        subDeviceInfo.device = m_subDevice.get();
+        subDeviceInfo.computeUnits = getDeviceInfo<cl_uint>(subDeviceInfo.device, CL_DEVICE_MAX_COMPUTE_UNITS);
+        initialize(subDeviceInfo);
+    }
+
+    void initialize(const DeviceInfo &deviceInfo)
     {
         cl_int err;
-        
-        err = clGetPlatformIDs(1, &m_platform, nullptr);
-        CHECK_CL_ERROR(err, "clGetPlatformIDs");
-        
-        err = clGetDeviceIDs(m_platform, CL_DEVICE_TYPE_ALL, 1, &m_device, nullptr);
-        CHECK_CL_ERROR(err, "clGetDeviceIDs");
+
+        m_platform = deviceInfo.platform;
+        m_device = deviceInfo.device;
 
         m_context = clCreateContext(nullptr, 1, &m_device, nullptr, nullptr, &err);
         CHECK_CL_ERROR(err, "clCreateContext");
+    }
+
+    // Prefers, in order: a precompiled or previously built binary for this device and options, an embedded SPIR-V
+    // module, the embedded source and finally the source file in constants::KERNELS_DIR.
+    void build(const char *options)
+    {
+        m_buildOptions = options ? options : "";
+        const auto &registry = KernelRegistry::instance();
+        const std::string kernelName = m_kernelFilename.filename().string();
+
+        if (auto binary = registry.binary(kernelName, deviceKey(m_device), m_buildOptions))
+        {
+            try
+            {
+                buildFromBinary(*binary);
+                return;
+            } catch (const std::runtime_error &e)
+            {
+                std::cerr << "Rebuilding " << kernelName << " from source, precompiled binary rejected: " << e.what() << '\n';
+            }
+        }
+
+        if (auto il = registry.il(kernelName, m_buildOptions); il && supportsSpirv(m_device))
+        {
+            buildFromIl(*il);
+        } else if (auto source = registry.source(kernelName))
+        {
+            const std::string kernelSource(*source);
+            buildFromSource(kernelSource.c_str(), options);
+        } else
+        {
+            std::unique_ptr<char[]> kernelSource = util::loadDataFromFile(constants::KERNELS_DIR / m_kernelFilename);
+            buildFromSource(kernelSource.get(), options);
+        }
+        // Later programs with the same options skip the compiler.
+        saveBinary();
+    }
+
+    void buildFromSource(const char *kernelSource, const char *options)
+    {
+        cl_int err;
 
         m_program = clCreateProgramWithSource(m_context, 1, &kernelSource, nullptr, &err);
         CHECK_CL_ERROR(err, "clCreateProgramWithSource");
@@ -189,35 +641,33 @@ public:
         CHECK_CL_ERROR(err, "clBuildProgram");
     }
 
-    void initialize()
+    void buildFromBinary(const KernelBinary &binary)
     {
+        cl_int binaryStatus;
         cl_int err;
-        
-        err = clGetPlatformIDs(1, &m_platform, nullptr);
-        CHECK_CL_ERROR(err, "clGetPlatformIDs");
-        
-        err = clGetDeviceIDs(m_platform, CL_DEVICE_TYPE_ALL, 1, &m_device, nullptr);
-        CHECK_CL_ERROR(err, "clGetDeviceIDs");
+        const size_t binarySize = binary.size();
+        const unsigned char *binaries[] = {binary.data()};
 
-        m_context = clCreateContext(nullptr, 1, &m_device, nullptr, nullptr, &err);
-        CHECK_CL_ERROR(err, "clCreateContext");
+        m_program = clCreateProgramWithBinary(m_context, 1, &m_device, &binarySize, binaries, &binaryStatus, &err);
+        CHECK_CL_ERROR(err, "clCreateProgramWithBinary");
+        CHECK_CL_ERROR(binaryStatus, "Created binary");
+
+        err = clBuildProgram(m_program, 1, &m_device, nullptr, nullptr, nullptr);
+        CHECK_CL_ERROR(err, "clBuildProgram");
     }
 
-    void build(const char *options)
+    void buildFromIl(const KernelBinary &il)
     {
         cl_int err;
 
-        std::unique_ptr<char[]> kernelSource = util::loadDataFromFile(constants::KERNELS_DIR / m_kernelFilename);
-        const char *source[] = {kernelSource.get()};
-
-        m_program = clCreateProgramWithSource(m_context, 1, source, nullptr, &err);
-        CHECK_CL_ERROR(err, "clCreateProgramWithSource");
+        m_program = clCreateProgramWithIL(m_context, il.data(), il.size(), &err);
+        CHECK_CL_ERROR(err, "clCreateProgramWithIL");
 
-        err = clBuildProgram(m_program, 1, &m_device, options, nullptr, nullptr);
+        err = clBuildProgram(m_program, 1, &m_device, nullptr, nullptr, nullptr);
         CHECK_CL_ERROR(err, "clBuildProgram");
     }
 
-    virtual void saveBinary() 
+    KernelBinary binary() const
     {
         cl_int err;
 
@@ -225,33 +675,33 @@ public:
         err = clGetProgramInfo(m_program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, nullptr);
         CHECK_CL_ERROR(err, "clGetProgramInfo");
 
-        std::vector<unsigned char> binary(binarySize);
+        KernelBinary binary(binarySize);
         unsigned char* binaryPtr = binary.data();
 
         err = clGetProgramInfo(m_program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binaryPtr, nullptr);
         CHECK_CL_ERROR(err, "clGetProgramInfo");
 
-        std::filesystem::path binaryName = m_kernelFilename.filename().replace_extension(".bin");
+        return binary;
+    }
+
+    virtual void saveBinary() 
+    {
+        const KernelBinary programBinary = binary();
+        KernelRegistry::instance().registerBinary(m_kernelFilename.filename().string(), deviceKey(m_device), m_buildOptions,
+                                                  programBinary.data(), programBinary.size());
+    }
 
-        util::writeDataToFile(constants::KERNELS_BIN_DIR / binaryName, binary.data(), binary.size());
+    virtual void saveBinary(std::filesystem::path binaryFilename) 
+    {
+        const KernelBinary programBinary = binary();
+        util::writeDataToFile(binaryFilename, programBinary.data(), programBinary.size());
     }
 
     virtual void loadFromBinary(std::filesystem::path binaryFilename) 
     {        
-        cl_int binaryStatus;
-        cl_int err;
         size_t binarySize{0};
-
         auto binaryPtr = util::loadDataFromBinaryFile(binaryFilename, &binarySize);
-
-        const unsigned char *binaries[] = {binaryPtr.get()};
-
-        m_program = clCreateProgramWithBinary(m_context, 1, &m_device, &binarySize, binaries, &binaryStatus, &err);
-        CHECK_CL_ERROR(err, "clCreateProgramWithBinary");
-        CHECK_CL_ERROR(binaryStatus, "Created binary");
-
-        err = clBuildProgram(m_program, 1, &m_device, nullptr, nullptr, nullptr);
-        CHECK_CL_ERROR(err, "clBuildProgram");
+        buildFromBinary(KernelBinary(binaryPtr.get(), binaryPtr.get() + binarySize));
     }
 
     virtual void loadFromBinary() 
@@ -264,18 +714,22 @@ public:
     {
         m_program.reset();
         m_context.reset();
+        m_subDevice.reset();
         m_device = nullptr;
         m_platform = nullptr;
     }
 
     virtual cl_program getProgram() { return m_program.get(); }
     virtual cl_context getContext() { return m_context.get(); }
+    cl_device_id getDevice() const { return m_device; }
 protected:
+    deviceWrapper m_subDevice;
     programWrapper m_program;
     contextWrapper m_context;
     cl_device_id m_device = nullptr;
     cl_platform_id m_platform = nullptr;
     std::filesystem::path m_kernelFilename;
+    std::string m_buildOptions;
 };
 
 
@@ -290,12 +744,14 @@ public:
 
     ProgramWithQueue(const char *kernelSource, const char *options) : Program(kernelSource, options) {}
 
-    void createQueueAndKernel(const char *kernelName) 
+    void createQueueAndKernel(const char *kernelName, bool profiling = false) 
     {
         m_kernelName = kernelName;
         cl_int err;
+
+        const cl_queue_properties properties[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};
         
-        m_queue = clCreateCommandQueueWithProperties(m_context, m_device, 0, &err);
+        m_queue = clCreateCommandQueueWithProperties(m_context, m_device, profiling ? properties : nullptr, &err);
         CHECK_CL_ERROR(err, "clCreateCommandQueueWithProperties");
 
         m_kernel = clCreateKernel(m_program, kernelName, &err);
@@ -343,4 +799,32 @@ inline std::string getOpenCLTypeName<int>() { return "int"; }
 template<>
 inline std::string getOpenCLTypeName<unsigned short>() { return "ushort"; }
 
+// One ready-to-run naive_mat_mult program per device matched by defaultDeviceSelector(), built once per data type.
+// Devices that fail to build the kernel (e.g. no fp64 support) are skipped.
+template<typename T>
+std::vector<std::unique_ptr<ProgramWithQueue>> &matMultDevicePrograms()
+{
+    static std::vector<std::unique_ptr<ProgramWithQueue>> programs = []()
+    {
+        std::vector<std::unique_ptr<ProgramWithQueue>> result;
+        const std::string buildOptions = "-DT=" + getOpenCLTypeName<T>();
+        for (const auto &device : selectDevices(defaultDeviceSelector()))
+        {
+            try
+            {
+                auto program = std::make_unique<ProgramWithQueue>("mat_mult.cl");
+                program->initialize(device);
+                program->build(buildOptions.c_str());
+                program->createQueueAndKernel("naive_mat_mult");
+                result.push_back(std::move(program));
+            } catch (const std::runtime_error &e)
+            {
+                std::cerr << "Skipping " << device.description() << ": " << e.what() << '\n';
+            }
+        }
+        return result;
+    }();
+    return programs;
+}
+
 } // namespace oclUtil
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "matrix.hpp"
+#include "perf_counters.hpp"
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
+#ifdef HAVE_PAR_UNSEQ
+#include <execution>
+#endif
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace parallelBackends
+{
+
+inline constexpr bool openMpAvailable =
+#ifdef HAVE_OPENMP
+    true;
+#else
+    false;
+#endif
+
+inline constexpr bool parUnseqAvailable =
+#ifdef HAVE_PAR_UNSEQ
+    true;
+#else
+    false;
+#endif
+
+constexpr bool isOpenMp(MatMultType type)
+{
+    return type == MatMultType::OmpStatic || type == MatMultType::OmpDynamic || type == MatMultType::OmpGuided;
+}
+
+constexpr std::string_view ompScheduleName(MatMultType type)
+{
+    switch (type)
+    {
+        case MatMultType::OmpStatic: return "static";
+        case MatMultType::OmpDynamic: return "dynamic";
+        case MatMultType::OmpGuided: return "guided";
+        default: return "none";
+    }
+}
+
+// Library behind std::execution, libstdc++ only runs the parallel policies in parallel on top of TBB.
+constexpr std::string_view parUnseqBackend()
+{
+#if defined(HAVE_PAR_UNSEQ) && defined(HAVE_TBB)
+    return "tbb";
+#elif defined(HAVE_PAR_UNSEQ)
+    return "native";
+#else
+    return "none";
+#endif
+}
+
+} // namespace parallelBackends
+
+// C is split into microkernel tiles of the active shape and the (row block, column block) space is handed to the
+// OpenMP runtime with the schedule the type names. Edge tiles are the masked ones, so uneven tiles stay vectorized.
+template <typename MatrixA, typename MatrixB, MatMultType Type>
+struct OmpMultImpl
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b)
+    {
+        return multiply(a, b, static_cast<int>(effectiveHostThreadCount()));
+    }
+
+    static auto multiply(const MatrixA& a, const MatrixB& b, int threadCount)
+    {
+        using DataT = typename MatrixA::DataT;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
+#ifdef HAVE_OPENMP
+        constexpr int M = MatrixA::Rows;
+        constexpr int N = MatrixB::Columns;
+        constexpr int K = MatrixA::Columns;
+        const size_t shapeIndex = simdTuner::activeShapeIndex<DataT>();
+        const auto &shape = simdTuner::MicroKernelShapes[shapeIndex];
+        const SimdTileKernel<DataT> tile = simdTileKernels<DataT>[shapeIndex];
+        const int blockRows = shape.regsA;
+        const int blockCols = shape.regsB * SimdTraits<DataT>::width;
+        const int rowBlocks = (M + blockRows - 1) / blockRows;
+        const int colBlocks = (N + blockCols - 1) / blockCols;
+        const DataT *pa = a.data().data();
+        const DataT *pb = b.data().data();
+        DataT *pc = result.data().data();
+
+        if constexpr (Type == MatMultType::OmpStatic) omp_set_schedule(omp_sched_static, 0);
+        else if constexpr (Type == MatMultType::OmpDynamic) omp_set_schedule(omp_sched_dynamic, 0);
+        else omp_set_schedule(omp_sched_guided, 0);
+
+        #pragma omp parallel num_threads(threadCount)
+        {
+            if (omp_get_thread_num() != 0) perf::registerPooledThread();
+            TRACE_SCOPE("tiles", "kernel");
+            #pragma omp for collapse(2) schedule(runtime)
+            for (int rb = 0; rb < rowBlocks; ++rb)
+            {
+                for (int cb = 0; cb < colBlocks; ++cb)
+                {
+                    const int i = rb * blockRows;
+                    const int j = cb * blockCols;
+                    tile(K, &pa[i * K], K, &pb[j], N, &pc[i * N + j], N,
+                         std::min(blockRows, M - i), std::min(blockCols, N - j), {});
+                }
+            }
+        }
+#else
+        (void)a;
+        (void)b;
+        (void)threadCount;
+        throw std::runtime_error("Built without OpenMP, reconfigure with USE_OPENMP and a compiler that supports it");
+#endif
+        return result;
+    }
+};
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::OmpStatic, MatrixA, MatrixB> : OmpMultImpl<MatrixA, MatrixB, MatMultType::OmpStatic> {};
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::OmpDynamic, MatrixA, MatrixB> : OmpMultImpl<MatrixA, MatrixB, MatMultType::OmpDynamic> {};
+
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::OmpGuided, MatrixA, MatrixB> : OmpMultImpl<MatrixA, MatrixB, MatMultType::OmpGuided> {};
+
+// Every row block of the active shape is one element of a std::execution::par_unseq for_each; how the blocks are
+// spread over threads is left to the standard library. The row kernels neither lock nor allocate, which the
+// unsequenced policy requires.
+template <typename MatrixA, typename MatrixB>
+struct MatrixMultImpl<MatMultType::ParUnseq, MatrixA, MatrixB>
+{
+    static auto multiply(const MatrixA& a, const MatrixB& b)
+    {
+        using DataT = typename MatrixA::DataT;
+        using ResultMatrix = Matrix<DataT, MatrixA::Rows, MatrixB::Columns>;
+        ResultMatrix result;
+#ifdef HAVE_PAR_UNSEQ
+        constexpr int M = MatrixA::Rows;
+        constexpr int N = MatrixB::Columns;
+        constexpr int K = MatrixA::Columns;
+        const size_t shapeIndex = simdTuner::activeShapeIndex<DataT>();
+        const SimdRowKernel<DataT> rows = simdRowKernels<DataT>[shapeIndex];
+        const int blockRows = simdTuner::MicroKernelShapes[shapeIndex].regsA;
+        const DataT *pa = a.data().data();
+        const DataT *pb = b.data().data();
+        DataT *pc = result.data().data();
+
+        std::vector<int> rowBlocks((M + blockRows - 1) / blockRows);
+        std::iota(rowBlocks.begin(), rowBlocks.end(), 0);
+        // Registering the library's workers would lock inside the unsequenced region.
+        perf::noteUnattachedPoolWork();
+        std::for_each(std::execution::par_unseq, rowBlocks.begin(), rowBlocks.end(), [=](int rb)
+        {
+            const int rowBegin = rb * blockRows;
+            rows(pa, pb, pc, N, K, rowBegin, std::min(rowBegin + blockRows, M), {});
+        });
+#else
+        (void)a;
+        (void)b;
+        throw std::runtime_error("Built without std::execution support, reconfigure with USE_PAR_UNSEQ and TBB available");
+#endif
+        return result;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace perf
+{
+
+enum class Counter
+{
+    Cycles = 0,
+    Instructions,
+    L1dMisses,
+    LlcMisses,
+    DtlbMisses,
+    BranchMisses,
+    Last
+};
+
+inline constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Last);
+
+const char *counterName(Counter counter);
+
+struct CounterValues
+{
+    std::array<uint64_t, COUNTER_COUNT> values{};
+    std::array<bool, COUNTER_COUNT> valid{};
+    // Set when a pooled thread could not be attached, its work is missing from the values.
+    bool partial = false;
+
+    uint64_t operator[](Counter counter) const { return values[static_cast<size_t>(counter)]; }
+    bool has(Counter counter) const { return valid[static_cast<size_t>(counter)]; }
+
+    CounterValues &operator+=(const CounterValues &other)
+    {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            values[i] += other.values[i];
+            valid[i] = valid[i] || other.valid[i];
+        }
+        partial = partial || other.partial;
+        return *this;
+    }
+};
+
+// Persistent workers (ThreadTeam, ThreadPool, the OpenMP and TBB pools) usually exist before the group of the
+// benchmark that uses them and are not inherited by it. They register once, every group opened afterwards
+// attaches counters to them directly. Cheap to call repeatedly, the registration ends when the thread exits.
+void registerPooledThread();
+
+// Called before handing work to pooled threads that cannot register, groups counting at the time report partial
+// values.
+void noteUnattachedPoolWork();
+
+// User space hardware counters of the calling thread, the threads it spawns while enabled and the pooled threads
+// registered when the group is opened, through perf_event_open. Counters the kernel or the container refuses are
+// left out; when none can be opened for the calling thread the group is unavailable and start()/stop() do
+// nothing. Values are scaled up when the kernel had to multiplex them.
+class PerfCounterGroup
+{
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup &) = delete;
+    PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+    bool available() const { return m_available; }
+    const std::string &unavailableReason() const { return m_reason; }
+
+    void start();
+    CounterValues stop();
+private:
+    using ThreadFds = std::array<int, COUNTER_COUNT>;
+
+    // Calling thread first, then one entry per attached pooled thread.
+    std::vector<ThreadFds> m_fds;
+    bool m_partial = false;
+    uint64_t m_unattachedAtStart = 0;
+    bool m_available = false;
+    std::string m_reason;
+};
+
+// Totals and per-iteration derived metrics (IPC, misses per kFLOP when flopsPerIteration is known).
+boost::json::object toJson(const CounterValues &totals, uint32_t iterations, double flopsPerIteration);
+
+} // namespace perf
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <boost/json.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Benchmarks
+{
+
+std::string fnv1aHex(std::string_view data);
+
+struct HostInfo
+{
+    std::string hostname;
+    std::string cpuModel;
+    std::string os;
+    uint32_t hardwareThreads = 0;
+    std::vector<std::string> isa;
+
+    // Stable across runs on the same machine, names the per-host results file.
+    std::string fingerprint() const;
+    boost::json::object toJson() const;
+};
+
+const HostInfo &hostInfo();
+
+// Compiler, flags and git revision baked in at configure time, and a hash of the running executable.
+boost::json::object buildInfo();
+const std::string &binaryHash();
+
+struct RegressionCheck
+{
+    std::string name;
+    std::string baselineRunId;
+    double baselineMean = 0.0;
+    double currentMean = 0.0;
+    // Relative change of the mean execution time, positive is slower.
+    double change = 0.0;
+    double pValue = 1.0;
+    bool regression = false;
+};
+
+// Welch t-test on the per-iteration execution times summarized in two records; a regression is a slowdown of
+// more than threshold that is significant at level alpha.
+RegressionCheck compareRecords(const boost::json::object &baseline, const boost::json::object &current,
+                               double threshold, double alpha);
+
+// Append-only NDJSON history of benchmark records, one file per host fingerprint inside the results directory.
+// Every record carries the run id, host, build, the configuration it was measured with and a hash of that
+// configuration so later runs can find a baseline or skip work that cannot have changed.
+class ResultsStore
+{
+public:
+    explicit ResultsStore(std::filesystem::path directory);
+
+    const std::filesystem::path &path() const { return m_path; }
+    const std::string &runId() const { return m_runId; }
+
+    void load();
+    void append(boost::json::object record, const boost::json::object &config, const std::string &configHash);
+
+    // Latest record of an earlier run measured with this configuration by the same executable. Neither this nor
+    // baseline() returns records that failed verification.
+    std::optional<boost::json::object> unchanged(const std::string &configHash) const;
+
+    // Latest record of an earlier run with this configuration, restricted to runs whose id or git revision
+    // starts with selector unless selector is empty or "latest". Records of excludeRunId are never a baseline,
+    // which keeps a reused unchanged record from being compared with itself.
+    std::optional<boost::json::object> baseline(const std::string &configHash, std::string_view selector,
+                                                std::string_view excludeRunId = {}) const;
+
+    const std::vector<boost::json::object> &records() const { return m_records; }
+private:
+    std::filesystem::path m_path;
+    std::string m_runId;
+    std::vector<boost::json::object> m_records;
+};
+
+} // namespace Benchmarks
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "matrix.hpp"
+#include "simd_traits.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace roofline
+{
+
+struct WorkEstimate
+{
+    double flops = 0.0;
+    double bytes = 0.0;
+
+    double intensity() const { return bytes > 0.0 ? flops / bytes : 0.0; }
+};
+
+// Memory traffic follows the reuse each kernel actually gets, assuming one row of A and the C block fit in cache:
+// element-wise kernels stream B once per row of C, the register-blocked SIMD kernels once per block of
+// simdBlockRows rows and the tiled OpenCL kernel once per tile row. Other types are charged the compulsory traffic only.
+inline WorkEstimate matMultWork(MatMultType type, size_t elemSize, uint64_t rows, uint64_t inner, uint64_t columns,
+                                uint32_t tileSize = 16, uint64_t simdBlockRows = 3)
+{
+    const double flops = 2.0 * static_cast<double>(rows * inner * columns);
+    const double sizeA = static_cast<double>(rows * inner);
+    const double sizeB = static_cast<double>(inner * columns);
+    const double sizeC = static_cast<double>(rows * columns);
+
+    double elements = sizeA + sizeB + sizeC;
+    switch (type)
+    {
+        case MatMultType::Naive:
+        case MatMultType::MultithreadRow:
+        case MatMultType::MultithreadElement:
+        case MatMultType::NaiveOcl:
+            elements = sizeA + static_cast<double>(rows) * sizeB + sizeC;
+            break;
+        case MatMultType::Simd:
+        case MatMultType::MultithreadSimd:
+        case MatMultType::HeterogeneousOcl:
+        case MatMultType::OmpStatic:
+        case MatMultType::OmpDynamic:
+        case MatMultType::OmpGuided:
+        case MatMultType::ParUnseq:
+            elements = sizeA + static_cast<double>((rows + simdBlockRows - 1) / simdBlockRows) * sizeB + sizeC;
+            break;
+        case MatMultType::TiledOcl:
+            elements = 2.0 * static_cast<double>(rows * inner * columns) / std::max(tileSize, 1u) + sizeC;
+            break;
+        default:
+            break;
+    }
+
+    return {flops, elements * static_cast<double>(elemSize)};
+}
+
+// Only Naive, Simd and uBLAS are bound by a single core, everything else is compared against the whole host.
+inline bool usesAllCores(MatMultType type)
+{
+    return type != MatMultType::Naive && type != MatMultType::Simd && type != MatMultType::Ublas;
+}
+
+struct Ceiling
+{
+    double peakGflops = 0.0;
+    double bandwidthGBs = 0.0;
+
+    double boundGflops(double intensity) const { return std::min(peakGflops, intensity * bandwidthGBs); }
+};
+
+struct ComputePeaks
+{
+    double singleCoreGflops = 0.0;
+    double allCoresGflops = 0.0;
+};
+
+struct BandwidthPeaks
+{
+    double singleCoreGBs = 0.0;
+    double allCoresGBs = 0.0;
+};
+
+// Keeps microbenchmark results observable so their loops are not optimized out.
+inline volatile double resultSink = 0.0;
+
+// Returns the number of arithmetic operations performed. Independent accumulators hide the FMA latency,
+// the multiplier and addend go through volatiles so the compiler cannot fold them away.
+template<typename T>
+double fmaKernel(uint64_t iterations)
+{
+    using Simd = SimdTraits<T>;
+    constexpr int accumulators = 10;
+
+    volatile T multiplier = static_cast<T>(1);
+    volatile T addend = static_cast<T>(0);
+    const auto b = Simd::broadcast(multiplier);
+    const auto c = Simd::broadcast(addend);
+
+    typename Simd::vec acc[accumulators];
+    for (int i = 0; i < accumulators; ++i)
+    {
+        acc[i] = Simd::broadcast(static_cast<T>(i + 1));
+    }
+
+    // Unrolled through a fold so the accumulators live in registers instead of on the stack.
+    [&]<size_t... I>(std::index_sequence<I...>)
+    {
+        for (uint64_t it = 0; it < iterations; ++it)
+        {
+            ((acc[I] = Simd::fma(acc[I], b, c)), ...);
+        }
+    }(std::make_index_sequence<accumulators>{});
+
+    alignas(32) T lanes[Simd::width];
+    T sum{};
+    for (int i = 0; i < accumulators; ++i)
+    {
+        Simd::store(lanes, acc[i]);
+        sum += lanes[0];
+    }
+    resultSink = static_cast<double>(sum);
+
+    return 2.0 * accumulators * Simd::width * static_cast<double>(iterations);
+}
+
+// Best of a few repetitions of fn(threadIndex) on threadCount threads, in units of fn's return value per second.
+template<typename Fn>
+double bestRate(uint32_t threadCount, int repetitions, Fn fn)
+{
+    double best = 0.0;
+    for (int rep = 0; rep < repetitions; ++rep)
+    {
+        std::vector<double> work(threadCount);
+        const auto start{std::chrono::steady_clock::now()};
+        if (threadCount == 1)
+        {
+            work[0] = fn(0u);
+        } else
+        {
+            std::vector<std::thread> threads;
+            for (uint32_t tid = 0; tid < threadCount; ++tid)
+            {
+                threads.emplace_back([&work, &fn, tid]() { work[tid] = fn(tid); });
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+        const double seconds = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+        double total = 0.0;
+        for (double w : work) total += w;
+        best = std::max(best, total / seconds);
+    }
+    return best;
+}
+
+inline uint32_t hostCoreCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+template<typename T>
+ComputePeaks measureComputePeaks()
+{
+    constexpr uint64_t iterations = 4'000'000;
+    auto kernel = [](uint32_t) { return fmaKernel<T>(iterations); };
+    return {bestRate(1, 3, kernel) * 1e-9, bestRate(hostCoreCount(), 3, kernel) * 1e-9};
+}
+
+// STREAM triad a = b + s * c over arrays well beyond typical last level cache sizes, counting 3 words per element.
+BandwidthPeaks measureBandwidthPeaks();
+
+template<typename T>
+const ComputePeaks &computePeaks()
+{
+    static const ComputePeaks peaks = measureComputePeaks<T>();
+    return peaks;
+}
+
+const BandwidthPeaks &bandwidthPeaks();
+
+template<typename T>
+Ceiling ceiling(bool allCores)
+{
+    const auto &compute = computePeaks<T>();
+    const auto &bandwidth = bandwidthPeaks();
+    return allCores ? Ceiling{compute.allCoresGflops, bandwidth.allCoresGBs}
+                    : Ceiling{compute.singleCoreGflops, bandwidth.singleCoreGBs};
+}
+
+template<typename T>
+boost::json::object report(MatMultType type, const WorkEstimate &work, double seconds)
+{
+    const bool allCores = usesAllCores(type);
+    const Ceiling bound = ceiling<T>(allCores);
+    const double gflops = seconds > 0.0 ? work.flops / seconds * 1e-9 : 0.0;
+    const double boundGflops = bound.boundGflops(work.intensity());
+
+    boost::json::object obj;
+    obj["flops"] = work.flops;
+    obj["bytes_moved"] = work.bytes;
+    obj["gflops"] = gflops;
+    obj["bandwidth_gbs"] = seconds > 0.0 ? work.bytes / seconds * 1e-9 : 0.0;
+    obj["arithmetic_intensity"] = work.intensity();
+    obj["peak_gflops"] = bound.peakGflops;
+    obj["peak_bandwidth_gbs"] = bound.bandwidthGBs;
+    obj["roofline_gflops"] = boundGflops;
+    obj["roofline_percent"] = boundGflops > 0.0 ? 100.0 * gflops / boundGflops : 0.0;
+    obj["roofline_scope"] = allCores ? "host_all_cores" : "host_single_core";
+    return obj;
+}
+
+// Runs every peak microbenchmark once so that later benchmarks do not pay for them.
+boost::json::object measureMachinePeaks();
+
+} // namespace roofline
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "matrix_benchmarks.hpp"
+#include "sweep.hpp"
+#include "utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+// Strong scaling keeps the matrix order fixed while workers are added, weak scaling grows the work with them.
+enum class ScalingKind
+{
+    Strong = 0,
+    Weak
+};
+
+inline std::string toString(ScalingKind kind)
+{
+    return kind == ScalingKind::Strong ? "strong" : "weak";
+}
+
+inline bool isScalable(MatMultType multType)
+{
+    return usesHostThreads(multType) || usesComputeUnits(multType);
+}
+
+struct ScalingSample
+{
+    uint32_t workers = 1;
+    int order = 0;
+    double seconds = 0.0;
+    double flops = 0.0;
+};
+
+struct ScalingPoint
+{
+    ScalingSample sample;
+    double gflops = 0.0;
+    // Throughput relative to the smallest worker count, which for strong scaling is the usual t1 / tp and for
+    // weak scaling the scaled speedup.
+    double speedup = 0.0;
+    double efficiency = 0.0;
+};
+
+struct ScalingAnalysis
+{
+    std::vector<ScalingPoint> points;
+    // Least squares fits of speedup(p) = 1 / (s + (1 - s) / p) and of the scaled speedup p - s (p - 1).
+    double amdahlSerialFraction = 0.0;
+    double gustafsonSerialFraction = 0.0;
+};
+
+// Fits through the origin in the linearized forms 1/S - 1/p = s (1 - 1/p) and p - S = s (p - 1), clamped to [0, 1].
+inline double fitAmdahlSerialFraction(const std::vector<ScalingPoint> &points)
+{
+    double xy = 0.0;
+    double xx = 0.0;
+    for (const auto &point : points)
+    {
+        if (point.speedup <= 0.0) continue;
+        const double p = point.sample.workers;
+        const double x = 1.0 - 1.0 / p;
+        xy += x * (1.0 / point.speedup - 1.0 / p);
+        xx += x * x;
+    }
+    return xx > 0.0 ? std::clamp(xy / xx, 0.0, 1.0) : 0.0;
+}
+
+inline double fitGustafsonSerialFraction(const std::vector<ScalingPoint> &points)
+{
+    double xy = 0.0;
+    double xx = 0.0;
+    for (const auto &point : points)
+    {
+        const double x = point.sample.workers - 1.0;
+        xy += x * (point.sample.workers - point.speedup);
+        xx += x * x;
+    }
+    return xx > 0.0 ? std::clamp(xy / xx, 0.0, 1.0) : 0.0;
+}
+
+// Speedups are taken relative to the sample with the fewest workers and normalized to one worker by assuming
+// linear scaling below it, so a study starting at 2 workers still yields comparable numbers.
+inline ScalingAnalysis analyzeScaling(std::vector<ScalingSample> samples)
+{
+    ScalingAnalysis analysis;
+    std::ranges::sort(samples, {}, &ScalingSample::workers);
+    if (samples.empty() || samples.front().seconds <= 0.0) return analysis;
+
+    const ScalingSample &reference = samples.front();
+    const double referenceRate = reference.flops / reference.seconds / reference.workers;
+    for (const auto &sample : samples)
+    {
+        ScalingPoint point;
+        point.sample = sample;
+        if (sample.seconds > 0.0)
+        {
+            const double rate = sample.flops / sample.seconds;
+            point.gflops = rate * 1e-9;
+            point.speedup = rate / referenceRate;
+            point.efficiency = point.speedup / sample.workers;
+        }
+        analysis.points.push_back(point);
+    }
+    analysis.amdahlSerialFraction = fitAmdahlSerialFraction(analysis.points);
+    analysis.gustafsonSerialFraction = fitGustafsonSerialFraction(analysis.points);
+    return analysis;
+}
+
+// Matrix multiplication work grows with the cube of the order; orders are limited to the compiled MatMultOrders,
+// so this picks the one closest to baseOrder * cbrt(workers) on a log scale. Efficiency is computed from the
+// achieved flop rate and stays exact when the available order only approximates the target.
+inline int weakScalingOrder(int baseOrder, uint32_t workers)
+{
+    const double target = std::log(static_cast<double>(baseOrder)) + std::log(static_cast<double>(workers)) / 3.0;
+    int best = baseOrder;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    for (int order : MatMultOrders)
+    {
+        if (order < baseOrder) continue;
+        const double distance = std::abs(std::log(static_cast<double>(order)) - target);
+        if (distance < bestDistance)
+        {
+            best = order;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+struct ScalingCurve
+{
+    ScalingKind kind = ScalingKind::Strong;
+    MatMultType multType = MatMultType::MultithreadSimd;
+    MatMultDataType dataType = MatMultDataType::Float;
+    int baseOrder = constants::DEFAULT_MATRIX_ORDER;
+    ScalingAnalysis analysis;
+
+    boost::json::object toJson() const
+    {
+        boost::json::object obj;
+        obj["name"] = "Scaling_" + util::toString(multType);
+        obj["scaling"] = toString(kind);
+        obj["data_type"] = util::toString(dataType);
+        obj["base_order"] = baseOrder;
+        obj["workers_kind"] = usesComputeUnits(multType) ? "compute_units" : "threads";
+
+        boost::json::array points;
+        for (const auto &point : analysis.points)
+        {
+            boost::json::object item;
+            item["workers"] = point.sample.workers;
+            item["order"] = point.sample.order;
+            item["median_execution_time_seconds"] = point.sample.seconds;
+            item["gflops"] = point.gflops;
+            item["speedup"] = point.speedup;
+            item["efficiency"] = point.efficiency;
+            points.push_back(item);
+        }
+        obj["points"] = points;
+        obj["amdahl_serial_fraction"] = analysis.amdahlSerialFraction;
+        if (analysis.amdahlSerialFraction > 0.0) obj["amdahl_max_speedup"] = 1.0 / analysis.amdahlSerialFraction;
+        obj["gustafson_serial_fraction"] = analysis.gustafsonSerialFraction;
+        return obj;
+    }
+
+    void printTable(std::ostream &os) const
+    {
+        os << std::format("\n{} scaling of {} {} from order {}\n", toString(kind), util::toString(multType),
+                          util::toString(dataType), baseOrder);
+        os << std::format("{:>8}{:>8}{:>14}{:>10}{:>10}{:>12}\n", "workers", "order", "median [s]", "GFLOPS",
+                          "speedup", "efficiency");
+        for (const auto &point : analysis.points)
+        {
+            os << std::format("{:>8}{:>8}{:>14.6f}{:>10.2f}{:>10.2f}{:>11.1f}%\n", point.sample.workers,
+                              point.sample.order, point.sample.seconds, point.gflops, point.speedup,
+                              point.efficiency * 100.0);
+        }
+        os << std::format("serial fraction: Amdahl {:.4f}, Gustafson {:.4f}\n", analysis.amdahlSerialFraction,
+                          analysis.gustafsonSerialFraction);
+    }
+};
+
+// Compute units of the selected device, which has to support equal partitioning for the OpenCL kernels to scale.
+inline uint32_t partitionableComputeUnits()
+{
+    const auto device = oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+    if (not oclUtil::supportsPartition(device.device, oclUtil::DevicePartition::equally(1)))
+    {
+        throw std::runtime_error("Device " + device.description() + " cannot be partitioned into compute units");
+    }
+    return device.computeUnits;
+}
+
+// 1, 2, 4, ... N where N is the hardware thread count for host kernels and the compute unit count of the selected
+// device for OpenCL kernels. Requested counts are checked against the device for OpenCL kernels.
+inline std::vector<uint32_t> workerCountsFor(MatMultType multType, const std::vector<uint32_t> &requested)
+{
+    if (usesComputeUnits(multType))
+    {
+        const uint32_t computeUnits = partitionableComputeUnits();
+        if (requested.empty()) return scalingSteps(computeUnits);
+
+        std::vector<uint32_t> counts;
+        std::ranges::copy_if(requested, std::back_inserter(counts), [computeUnits](uint32_t count) { return count <= computeUnits; });
+        return counts;
+    }
+    return requested.empty() ? scalingSteps(std::max(1u, std::thread::hardware_concurrency())) : requested;
+}
+
+inline std::vector<SweepPoint> scalingCurvePlan(ScalingKind kind, MatMultType multType, MatMultDataType dataType,
+                                                int baseOrder, const std::vector<uint32_t> &workerCounts)
+{
+    std::vector<SweepPoint> plan;
+    for (uint32_t workers : workerCounts)
+    {
+        const int order = kind == ScalingKind::Strong ? baseOrder : weakScalingOrder(baseOrder, workers);
+        plan.push_back({order, multType, dataType, workers});
+    }
+    return plan;
+}
+
+// A regression against the baseline (REGRESSION_EXIT_CODE) still yields a curve and sets regressed, other sweep
+// failures throw.
+inline ScalingCurve runScalingCurve(ScalingKind kind, MatMultType multType, MatMultDataType dataType, int baseOrder,
+                                    const std::vector<uint32_t> &workerCounts, const StoreOptions &storeOptions,
+                                    bool &regressed)
+{
+    const auto plan = scalingCurvePlan(kind, multType, dataType, baseOrder, workerCounts);
+    std::vector<ScalingSample> samples;
+    const int result = runSweep(plan, storeOptions, [&samples](const SweepPoint &point, const boost::json::object &record)
+    {
+        const auto *median = record.if_contains("median_execution_time_seconds");
+        const auto *count = record.if_contains("times_executed");
+        if (not median || not count || count->to_number<uint64_t>() == 0 || verification::failed(record)) return;
+
+        const double order = point.order;
+        samples.push_back({point.threads, point.order, median->to_number<double>(), 2.0 * order * order * order});
+    });
+    if (result == REGRESSION_EXIT_CODE) regressed = true;
+    else if (result != 0) throw std::runtime_error("Scaling run failed for " + util::toString(multType));
+
+    return {kind, multType, dataType, baseOrder, analyzeScaling(std::move(samples))};
+}
+
+// Worker counts per scalable kernel, in the order runScalingStudy visits them. Kernels that cannot be scaled are
+// skipped with a message.
+inline std::vector<std::pair<MatMultType, std::vector<uint32_t>>> scalableWorkerCounts(
+    const std::vector<MatMultType> &multTypes, const std::vector<uint32_t> &workerCounts)
+{
+    std::vector<std::pair<MatMultType, std::vector<uint32_t>>> scalable;
+    for (MatMultType multType : multTypes)
+    {
+        if (not isScalable(multType))
+        {
+            std::cerr << "Skipping " << util::toString(multType) << ": its worker count cannot be varied\n";
+            continue;
+        }
+
+        try
+        {
+            scalable.emplace_back(multType, workerCountsFor(multType, workerCounts));
+        } catch (const std::exception &e)
+        {
+            std::cerr << "Skipping " << util::toString(multType) << ": " << e.what() << '\n';
+        }
+    }
+    return scalable;
+}
+
+// What runScalingStudy measures, one line per point, in the same order.
+inline std::vector<std::string> scalingPlan(const std::vector<ScalingKind> &kinds, const std::vector<int> &baseOrders,
+                                            const std::vector<MatMultType> &multTypes,
+                                            const std::vector<MatMultDataType> &dataTypes,
+                                            const std::vector<uint32_t> &workerCounts)
+{
+    std::vector<std::string> plan;
+    for (const auto &[multType, workers] : scalableWorkerCounts(multTypes, workerCounts))
+    {
+        for (ScalingKind kind : kinds)
+        {
+            for (int baseOrder : baseOrders)
+            {
+                for (MatMultDataType dataType : dataTypes)
+                {
+                    for (const auto &point : scalingCurvePlan(kind, multType, dataType, baseOrder, workers))
+                    {
+                        plan.push_back(std::format("{:<8}{}", toString(kind), point.description()));
+                    }
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// Runs every scalable kernel over the worker counts at each base order. Kernels whose device cannot be
+// partitioned are skipped with a message; the tables go to stderr and the curves to the result sink. Returns
+// REGRESSION_EXIT_CODE when any point regressed against the baseline.
+inline int runScalingStudy(const std::vector<ScalingKind> &kinds, const std::vector<int> &baseOrders,
+                           const std::vector<MatMultType> &multTypes, const std::vector<MatMultDataType> &dataTypes,
+                           const std::vector<uint32_t> &workerCounts, const StoreOptions &storeOptions = {})
+{
+    bool regressed = false;
+    for (const auto &[multType, workers] : scalableWorkerCounts(multTypes, workerCounts))
+    {
+        for (ScalingKind kind : kinds)
+        {
+            for (int baseOrder : baseOrders)
+            {
+                for (MatMultDataType dataType : dataTypes)
+                {
+                    const auto curve = runScalingCurve(kind, multType, dataType, baseOrder, workers, storeOptions, regressed);
+                    curve.printTable(std::cerr);
+                    defaultResultSink().write(curve.toJson());
+                }
+            }
+        }
+    }
+    return regressed ? REGRESSION_EXIT_CODE : 0;
+}
+
+inline std::vector<ScalingKind> scalingKindsFromString(std::string_view str)
+{
+    const std::string strLower = util::toLower(str);
+    if (strLower == "strong") return { ScalingKind::Strong };
+    if (strLower == "weak") return { ScalingKind::Weak };
+    if (strLower == "both") return { ScalingKind::Strong, ScalingKind::Weak };
+    throw std::invalid_argument("Unknown scaling mode (use strong, weak or both): " + std::string(str));
+}
+
+} // namespace Benchmarks
@@ -6,6 +6,17 @@
 template <typename T>
 struct SimdTraits;
 
+// All-ones in the first lanes of a 32 or 64 bit lane mask, for the masked loads and stores of partial vectors.
+inline __m256i firstLanesMask32(int lanes)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+inline __m256i firstLanesMask64(int lanes)
+{
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(lanes), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
 template <>
 struct SimdTraits<float> 
 {
@@ -15,7 +26,13 @@ struct SimdTraits<float>
     static vec broadcast(float val) { return _mm256_set1_ps(val); }
     static vec add(vec a, vec b) { return _mm256_add_ps(a, b); }
     static vec mul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm256_fmadd_ps(a, b, c); }
+    static vec max(vec a, vec b) { return _mm256_max_ps(a, b); }
+    static vec zero() { return _mm256_setzero_ps(); }
     static void store(float* ptr, vec v) { _mm256_storeu_ps(ptr, v); }
+    static __m256i mask(int lanes) { return firstLanesMask32(lanes); }
+    static vec maskLoad(const float *ptr, __m256i m) { return _mm256_maskload_ps(ptr, m); }
+    static void maskStore(float *ptr, __m256i m, vec v) { _mm256_maskstore_ps(ptr, m, v); }
 };
 
 template <>
@@ -27,7 +44,13 @@ struct SimdTraits<double>
     static vec broadcast(double val) { return _mm256_set1_pd(val); }
     static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
     static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm256_fmadd_pd(a, b, c); }
+    static vec max(vec a, vec b) { return _mm256_max_pd(a, b); }
+    static vec zero() { return _mm256_setzero_pd(); }
     static void store(double* ptr, vec v) { _mm256_storeu_pd(ptr, v); }
+    static __m256i mask(int lanes) { return firstLanesMask64(lanes); }
+    static vec maskLoad(const double *ptr, __m256i m) { return _mm256_maskload_pd(ptr, m); }
+    static void maskStore(double *ptr, __m256i m, vec v) { _mm256_maskstore_pd(ptr, m, v); }
 };
 
 template <>
@@ -39,7 +62,13 @@ struct SimdTraits<int32_t>
     static vec broadcast(int32_t val) { return _mm256_set1_epi32(val); }
     static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
     static vec mul(vec a, vec b) { return _mm256_mullo_epi32(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+    static vec max(vec a, vec b) { return _mm256_max_epi32(a, b); }
+    static vec zero() { return _mm256_setzero_si256(); }
     static void store(int32_t *ptr, vec v) { _mm256_storeu_si256((__m256i*)ptr, v); }
+    static __m256i mask(int lanes) { return firstLanesMask32(lanes); }
+    static vec maskLoad(const int32_t *ptr, __m256i m) { return _mm256_maskload_epi32(ptr, m); }
+    static void maskStore(int32_t *ptr, __m256i m, vec v) { _mm256_maskstore_epi32(ptr, m, v); }
 };
 
 template <>
@@ -51,5 +80,11 @@ struct SimdTraits<uint32_t>
     static vec broadcast(uint32_t val) { return _mm256_set1_epi32(static_cast<int32_t>(val)); }
     static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
     static vec mul(vec a, vec b) { return _mm256_mullo_epi32(a, b); }
+    static vec fma(vec a, vec b, vec c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+    static vec max(vec a, vec b) { return _mm256_max_epu32(a, b); }
+    static vec zero() { return _mm256_setzero_si256(); }
     static void store(uint32_t *ptr, vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), v); }
+    static __m256i mask(int lanes) { return firstLanesMask32(lanes); }
+    static vec maskLoad(const uint32_t *ptr, __m256i m) { return _mm256_maskload_epi32(reinterpret_cast<const int*>(ptr), m); }
+    static void maskStore(uint32_t *ptr, __m256i m, vec v) { _mm256_maskstore_epi32(reinterpret_cast<int*>(ptr), m, v); }
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "constants.hpp"
+#include "ocl_utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace simdTuner
+{
+
+// Register block of the SIMD microkernel: regsA rows of A times regsB vectors of B held in accumulators, with the
+// k loop unrolled kUnroll times.
+struct MicroKernelShape
+{
+    int regsA = 3;
+    int regsB = 4;
+    int kUnroll = 1;
+
+    std::string description() const { return std::format("{}x{} k{}", regsA, regsB, kUnroll); }
+
+    bool operator==(const MicroKernelShape &) const = default;
+};
+
+// Every shape the SIMD kernels are instantiated for. AVX2 has 16 vector registers, so the accumulators plus the
+// B vector, the broadcast A value and the product must fit into 16; AVX-512VL doubles that for 256 bit vectors.
+inline constexpr std::array MicroKernelShapes = {
+    MicroKernelShape{3, 4, 1},
+    MicroKernelShape{3, 4, 2},
+    MicroKernelShape{3, 4, 4},
+    MicroKernelShape{4, 3, 1},
+    MicroKernelShape{4, 3, 2},
+    MicroKernelShape{2, 4, 1},
+    MicroKernelShape{4, 2, 1},
+    MicroKernelShape{5, 2, 1},
+    MicroKernelShape{6, 2, 1},
+    MicroKernelShape{6, 2, 2},
+    MicroKernelShape{2, 6, 1},
+    MicroKernelShape{8, 1, 1},
+#ifdef __AVX512VL__
+    MicroKernelShape{4, 6, 1},
+    MicroKernelShape{6, 4, 1},
+    MicroKernelShape{6, 4, 2},
+    MicroKernelShape{8, 3, 1},
+#endif
+};
+
+inline constexpr size_t DEFAULT_SHAPE_INDEX = 0;
+
+constexpr std::optional<size_t> shapeIndexOf(const MicroKernelShape &shape)
+{
+    for (size_t i = 0; i < MicroKernelShapes.size(); ++i)
+    {
+        if (MicroKernelShapes[i] == shape) return i;
+    }
+    return std::nullopt;
+}
+
+// Instruction set the microkernels were compiled for, part of the tuning key.
+constexpr std::string_view compiledIsa()
+{
+#if defined(__AVX512VL__)
+    return "avx2+avx512vl";
+#elif defined(__FMA__)
+    return "avx2+fma";
+#else
+    return "avx2";
+#endif
+}
+
+struct TuningEntry
+{
+    MicroKernelShape shape;
+    double gflops = 0.0;
+};
+
+// Fastest microkernel shape per (ISA, data type) on this host, persisted as JSON.
+class TuningDatabase
+{
+public:
+    explicit TuningDatabase(std::filesystem::path path) : m_path(std::move(path)) {}
+
+    // Process-wide database at constants::SIMD_TUNING_DB_PATH, loaded on first use.
+    static TuningDatabase &instance();
+
+    static std::string makeKey(std::string_view isa, std::string_view dataType);
+
+    std::optional<TuningEntry> lookup(std::string_view isa, std::string_view dataType) const;
+
+    void store(std::string_view isa, std::string_view dataType, const TuningEntry &entry);
+
+    void load();
+
+    void save() const;
+
+    const std::filesystem::path &path() const { return m_path; }
+private:
+    std::filesystem::path m_path;
+    std::map<std::string, TuningEntry> m_entries;
+    mutable std::mutex m_mutex;
+};
+
+template<typename T>
+std::atomic<int> &activeShapeSlot()
+{
+    static std::atomic<int> slot{-1};
+    return slot;
+}
+
+// Index into MicroKernelShapes used by the SIMD kernels for T, resolved from the tuning database on first use.
+// Entries naming a shape this build does not instantiate fall back to the default.
+template<typename T>
+size_t activeShapeIndex()
+{
+    int index = activeShapeSlot<T>().load(std::memory_order_relaxed);
+    if (index >= 0) return static_cast<size_t>(index);
+
+    index = static_cast<int>(DEFAULT_SHAPE_INDEX);
+    if (auto entry = TuningDatabase::instance().lookup(compiledIsa(), oclUtil::getOpenCLTypeName<T>()))
+    {
+        index = static_cast<int>(shapeIndexOf(entry->shape).value_or(DEFAULT_SHAPE_INDEX));
+    }
+    activeShapeSlot<T>().store(index, std::memory_order_relaxed);
+    return static_cast<size_t>(index);
+}
+
+template<typename T>
+const MicroKernelShape &activeShape()
+{
+    return MicroKernelShapes[activeShapeIndex<T>()];
+}
+
+template<typename T>
+void setActiveShape(size_t index)
+{
+    activeShapeSlot<T>().store(static_cast<int>(index), std::memory_order_relaxed);
+}
+
+template<typename T>
+boost::json::object activeShapeJson()
+{
+    const MicroKernelShape &shape = activeShape<T>();
+    boost::json::object obj;
+    obj["regs_a"] = shape.regsA;
+    obj["regs_b"] = shape.regsB;
+    obj["k_unroll"] = shape.kUnroll;
+    obj["isa"] = compiledIsa();
+    const auto entry = TuningDatabase::instance().lookup(compiledIsa(), oclUtil::getOpenCLTypeName<T>());
+    obj["source"] = entry && entry->shape == shape ? "tuning_database" : "default";
+    return obj;
+}
+
+// Benchmarks every shape single threaded on order x order matrices for each data type, verifies the results and
+// stores the fastest shape per data type in the database, which also becomes the active shape.
+boost::json::array autotuneHost(TuningDatabase &database, int order = 384, uint32_t repeats = 5);
+
+} // namespace simdTuner
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "matrix_benchmarks.hpp"
+#include "structured_mult.hpp"
+#include "utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <cstdint>
+#include <format>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+enum class StructuredOp
+{
+    // Lower triangle of A * A^T only.
+    Syrk = 0,
+    // Lower triangle of A * A^T mirrored into the upper one.
+    SyrkMirrored,
+    // Lower triangular T times B.
+    Trmm
+};
+
+inline std::string toString(StructuredOp op)
+{
+    switch (op)
+    {
+        case StructuredOp::Syrk: return "Syrk";
+        case StructuredOp::SyrkMirrored: return "SyrkMirrored";
+        default: return "Trmm";
+    }
+}
+
+// Median of the general path per (data type, order, op), the structured run of the same point is reported against it.
+inline std::map<std::tuple<std::string, int, StructuredOp>, double> &generalMedians()
+{
+    static std::map<std::tuple<std::string, int, StructuredOp>, double> medians;
+    return medians;
+}
+
+// The structured kernel against MultithreadSimd on the same operands, with A^T prepared outside the timed region
+// for the general path and T stored with explicit zeros. Both run on hostThreadCount() threads.
+template<typename DataType, uint32_t Order, StructuredOp Op, bool General>
+class StructuredBenchmark : public Benchmark<StructuredBenchmark<DataType, Order, Op, General>>
+{
+    using MatrixType = Matrix<DataType, Order, Order>;
+    using GeneralImpl = MatrixMultImpl<MatMultType::MultithreadSimd, MatrixType, MatrixType>;
+public:
+    static constexpr uint32_t taskCount = DEFAULT_TASK_COUNT;
+
+    StructuredBenchmark()
+        : Benchmark<StructuredBenchmark>(std::format("{}_{}", toString(Op), General ? "General" : "Structured")) {}
+protected:
+    void setUp() override
+    {
+        m_operands.prepare(this->m_config.cacheMode);
+        if constexpr (Op == StructuredOp::Trmm)
+        {
+            m_triangular = m_operands.a();
+            for (uint32_t i = 0; i < Order; ++i)
+            {
+                for (uint32_t j = i + 1; j < Order; ++j) m_triangular(i, j) = DataType(0);
+            }
+        } else if constexpr (General)
+        {
+            structured::packTransposed(m_operands.a().data().data(), Order, Order, Order, m_transposed.data().data(), Order);
+        }
+    }
+
+    void compute() override
+    {
+        const int threadCount = static_cast<int>(effectiveHostThreadCount());
+        if constexpr (Op == StructuredOp::Trmm)
+        {
+            if constexpr (General) m_matC = GeneralImpl::multiply(m_triangular, m_operands.b(), threadCount);
+            else m_matC = structured::trmm<structured::Triangle::Lower>(m_triangular, m_operands.b(), threadCount);
+        } else
+        {
+            if constexpr (General) m_matC = GeneralImpl::multiply(m_operands.a(), m_transposed, threadCount);
+            else m_matC = structured::syrk<structured::Triangle::Lower>(m_operands.a(), Op == StructuredOp::SyrkMirrored, threadCount);
+        }
+    }
+
+    // Useful flops of the structured product, the general path is charged the full dense count.
+    double flopsPerIteration() const override
+    {
+        const double n = Order;
+        if constexpr (General) return 2.0 * n * n * n;
+        else return n * (n + 1) * n;
+    }
+
+    virtual void injectOutputParams(boost::json::object &obj) const
+    {
+        obj["data_type"] = typeid(DataType).name();
+        obj["matrix_dims"] = std::format("{}x{}", Order, Order);
+        obj["operation"] = toString(Op);
+        obj["triangle"] = structured::toString(structured::Triangle::Lower);
+        obj["path"] = General ? "general" : "structured";
+        obj["threads"] = effectiveHostThreadCount();
+        obj["simd_kernel"] = simdTuner::activeShapeJson<DataType>();
+        m_operands.injectOutputParams(obj);
+
+        const auto key = std::make_tuple(std::string(typeid(DataType).name()), static_cast<int>(Order), Op);
+        const double median = this->m_statistics.median;
+        if constexpr (General)
+        {
+            generalMedians()[key] = median;
+        } else
+        {
+            auto it = generalMedians().find(key);
+            if (it != generalMedians().end() && median > 0.0)
+            {
+                obj["general_median_seconds"] = it->second;
+                obj["speedup_vs_general"] = it->second / median;
+            }
+        }
+    }
+private:
+    MatMultOperands<DataType, Order, Order> m_operands;
+    MatrixType m_triangular;
+    MatrixType m_transposed;
+    MatrixType m_matC;
+};
+
+template<typename DataType, uint32_t Order>
+int runStructuredOps()
+{
+    StructuredBenchmark<DataType, Order, StructuredOp::Syrk, true>().measure();
+    StructuredBenchmark<DataType, Order, StructuredOp::Syrk, false>().measure();
+    StructuredBenchmark<DataType, Order, StructuredOp::SyrkMirrored, true>().measure();
+    StructuredBenchmark<DataType, Order, StructuredOp::SyrkMirrored, false>().measure();
+    StructuredBenchmark<DataType, Order, StructuredOp::Trmm, true>().measure();
+    StructuredBenchmark<DataType, Order, StructuredOp::Trmm, false>().measure();
+    return 0;
+}
+
+template <typename DataType, size_t... OrderIndices>
+int dispatchStructuredOrder(int order, std::index_sequence<OrderIndices...>)
+{
+    int result{-1};
+    const bool dispatched = ((order == MatMultOrders[OrderIndices]
+                              && (result = runStructuredOps<DataType, MatMultOrders[OrderIndices]>(), true)) || ...);
+    if (not dispatched) throw std::runtime_error("Unsupported mat mult order\n");
+    return result;
+}
+
+// What runStructuredComparison measures, in the same order.
+inline std::vector<std::string> structuredPlan(const std::vector<int> &orders, const std::vector<MatMultDataType> &dataTypes)
+{
+    std::vector<std::string> plan;
+    for (int order : orders)
+    {
+        for (MatMultDataType dataType : dataTypes)
+        {
+            for (StructuredOp op : { StructuredOp::Syrk, StructuredOp::SyrkMirrored, StructuredOp::Trmm })
+            {
+                for (const char *path : { "general", "structured" })
+                {
+                    plan.push_back(std::format("{:<20}{:<8}{}x{} {}", toString(op), util::toString(dataType),
+                                               order, order, path));
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// SYRK, mirrored SYRK and TRMM against the general path at every order and data type.
+inline int runStructuredComparison(const std::vector<int> &orders, const std::vector<MatMultDataType> &dataTypes)
+{
+    constexpr auto orderIndices = std::make_index_sequence<MatMultOrders.size()>{};
+    for (int order : orders)
+    {
+        for (MatMultDataType dataType : dataTypes)
+        {
+            switch (dataType)
+            {
+                case MatMultDataType::Int32: dispatchStructuredOrder<int32_t>(order, orderIndices); break;
+                case MatMultDataType::Uint32: dispatchStructuredOrder<uint32_t>(order, orderIndices); break;
+                case MatMultDataType::Float: dispatchStructuredOrder<float>(order, orderIndices); break;
+                default: dispatchStructuredOrder<double>(order, orderIndices); break;
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace Benchmarks
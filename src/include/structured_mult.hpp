@@ -0,0 +1,251 @@
+#pragma once
+
+#include "epilogue.hpp"
+#include "matrix.hpp"
+#include "simd_tuner.hpp"
+#include "thread_team.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Products whose result or operand is triangular: SYRK (C = A * A^T or A^T * A) computes only one triangle of
+// the symmetric result, TRMM (C = T * B) skips the zero half of T. Both run the tile kernels of the active SIMD
+// microkernel shape over the triangular part of the iteration space only.
+namespace structured
+{
+
+enum class Triangle
+{
+    Lower = 0,
+    Upper
+};
+
+enum class Transpose
+{
+    No = 0,
+    Yes
+};
+
+inline std::string toString(Triangle triangle)
+{
+    return triangle == Triangle::Lower ? "lower" : "upper";
+}
+
+// Boundaries of parts contiguous ranges of items with about equal total work, parts + 1 entries. Triangular
+// loops have row blocks of linearly growing or shrinking cost, an even split of the blocks would leave the
+// first or last worker with most of the work.
+inline std::vector<int> balancedSplit(const std::vector<int64_t> &work, int parts)
+{
+    std::vector<int> bounds(parts + 1, static_cast<int>(work.size()));
+    bounds[0] = 0;
+    const int64_t total = std::accumulate(work.begin(), work.end(), int64_t{0});
+    int64_t done = 0;
+    int part = 1;
+    for (int i = 0; i < static_cast<int>(work.size()) && part < parts; ++i)
+    {
+        done += work[i];
+        while (part < parts && done * parts >= total * part) bounds[part++] = i + 1;
+    }
+    return bounds;
+}
+
+// Runs body(begin, end) over the balanced ranges of work, one worker per non empty range. Jobs of up to
+// THREAD_TEAM_MAX_FLOPS run on the shared thread team.
+template <typename Body>
+void parallelBalanced(const std::vector<int64_t> &work, int threadCount, double flops, Body body)
+{
+    const std::vector<int> bounds = balancedSplit(work, std::max(1, threadCount));
+    if (threadCount <= 1)
+    {
+        body(0, static_cast<int>(work.size()));
+        return;
+    }
+
+    auto range = [&body, &bounds](int tid, int)
+    {
+        if (bounds[tid] == bounds[tid + 1]) return;
+        TRACE_SCOPE("triangle blocks", "kernel");
+        body(bounds[tid], bounds[tid + 1]);
+    };
+    if (flops <= THREAD_TEAM_MAX_FLOPS && sharedThreadTeam(threadCount)->tryRun(threadCount, range)) return;
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < threadCount; ++tid)
+    {
+        if (bounds[tid] == bounds[tid + 1]) continue;
+        threads.emplace_back([&body, begin = bounds[tid], end = bounds[tid + 1]]()
+        {
+            TRACE_SCOPE("triangle blocks", "kernel");
+            body(begin, end);
+        });
+    }
+    for (auto &thread : threads) thread.join();
+}
+
+// rows x cols of src with leading dimension lds into dst with leading dimension ldd, transposed.
+template <typename T>
+void packTransposed(const T *src, int lds, int rows, int cols, T *dst, int ldd)
+{
+    constexpr int block = 16;
+    for (int i0 = 0; i0 < rows; i0 += block)
+    {
+        for (int j0 = 0; j0 < cols; j0 += block)
+        {
+            for (int i = i0; i < std::min(i0 + block, rows); ++i)
+            {
+                for (int j = j0; j < std::min(j0 + block, cols); ++j) dst[j * ldd + i] = src[i * lds + j];
+            }
+        }
+    }
+}
+
+template <typename T>
+void mirror(T *c, int n, Triangle computed, int threadCount)
+{
+    std::vector<int64_t> work(n);
+    for (int i = 0; i < n; ++i) work[i] = computed == Triangle::Lower ? n - i : i + 1;
+    parallelBalanced(work, threadCount, 0.0, [c, n, computed](int begin, int end)
+    {
+        // Row i of the missing triangle is column i of the computed one.
+        for (int i = begin; i < end; ++i)
+        {
+            if (computed == Triangle::Lower) for (int j = i + 1; j < n; ++j) c[i * n + j] = c[j * n + i];
+            else for (int j = 0; j < i; ++j) c[i * n + j] = c[j * n + i];
+        }
+    });
+}
+
+// C = A * A^T, or A^T * A with Transpose::Yes. Only the tiles that intersect the Uplo triangle are computed,
+// tiles on the diagonal are computed whole, so the other triangle holds zeros and a band of correct values
+// unless mirror fills it.
+template <Triangle Uplo, Transpose Trans = Transpose::No, typename T, int Rows, int Columns>
+auto syrk(const Matrix<T, Rows, Columns> &a, bool mirrorResult = true,
+          int threadCount = static_cast<int>(effectiveHostThreadCount()))
+{
+    constexpr int N = Trans == Transpose::No ? Rows : Columns;
+    constexpr int K = Trans == Transpose::No ? Columns : Rows;
+    Matrix<T, N, N> result;
+
+    // The tile kernels read row major A (N x K) and B (K x N), the transposed operand is packed once.
+    std::vector<T> packed(static_cast<size_t>(N) * K);
+    packTransposed(a.data().data(), Columns, Rows, Columns, packed.data(), Rows);
+    const T *pa = Trans == Transpose::No ? a.data().data() : packed.data();
+    const T *pb = Trans == Transpose::No ? packed.data() : a.data().data();
+
+    const size_t shapeIndex = simdTuner::activeShapeIndex<T>();
+    const auto &shape = simdTuner::MicroKernelShapes[shapeIndex];
+    const SimdTileKernel<T> tile = simdTileKernels<T>[shapeIndex];
+    const int blockRows = shape.regsA;
+    const int blockCols = shape.regsB * SimdTraits<T>::width;
+    const int rowBlocks = (N + blockRows - 1) / blockRows;
+
+    auto columnRange = [=](int rb)
+    {
+        const int i0 = rb * blockRows;
+        const int rowEnd = std::min(i0 + blockRows, N);
+        if constexpr (Uplo == Triangle::Lower) return std::pair{0, rowEnd};
+        else return std::pair{(i0 / blockCols) * blockCols, N};
+    };
+
+    std::vector<int64_t> work(rowBlocks);
+    for (int rb = 0; rb < rowBlocks; ++rb)
+    {
+        const auto [begin, end] = columnRange(rb);
+        work[rb] = (end - begin + blockCols - 1) / blockCols;
+    }
+
+    T *pc = result.data().data();
+    parallelBalanced(work, threadCount, static_cast<double>(N) * (N + 1) * K, [&](int rbBegin, int rbEnd)
+    {
+        for (int rb = rbBegin; rb < rbEnd; ++rb)
+        {
+            const int i = rb * blockRows;
+            const auto [begin, end] = columnRange(rb);
+            for (int j = begin; j < end; j += blockCols)
+            {
+                tile(K, &pa[i * K], K, &pb[j], N, &pc[i * N + j], N,
+                     std::min(blockRows, N - i), std::min(blockCols, N - j), {});
+            }
+        }
+    });
+
+    if (mirrorResult) mirror(pc, N, Uplo, threadCount);
+    return result;
+}
+
+// C = T * B for a triangular T. The other triangle of T is never read: every row block runs the rectangular part
+// of its row up to the diagonal block straight from T, and the diagonal block from a copy with the other
+// triangle zeroed, accumulated into C through the residual epilogue.
+template <Triangle Uplo, typename T, int M, int N>
+auto trmm(const Matrix<T, M, M> &t, const Matrix<T, M, N> &b,
+          int threadCount = static_cast<int>(effectiveHostThreadCount()))
+{
+    using Accumulate = epilogue::Ops<T, false, false, epilogue::Activation::None, true>;
+    Matrix<T, M, N> result;
+
+    const size_t shapeIndex = simdTuner::activeShapeIndex<T>();
+    const auto &shape = simdTuner::MicroKernelShapes[shapeIndex];
+    const SimdTileKernel<T> tile = simdTileKernels<T>[shapeIndex];
+    const SimdTileKernel<T, Accumulate> accumulateTile = simdTileKernels<T, Accumulate>[shapeIndex];
+    const int blockRows = shape.regsA;
+    const int blockCols = shape.regsB * SimdTraits<T>::width;
+    const int rowBlocks = (M + blockRows - 1) / blockRows;
+
+    std::vector<int64_t> work(rowBlocks);
+    for (int rb = 0; rb < rowBlocks; ++rb)
+    {
+        const int i0 = rb * blockRows;
+        work[rb] = Uplo == Triangle::Lower ? std::min(i0 + blockRows, M) : M - i0;
+    }
+
+    const T *pt = t.data().data();
+    const T *pb = b.data().data();
+    T *pc = result.data().data();
+    parallelBalanced(work, threadCount, static_cast<double>(M) * (M + 1) * N, [&](int rbBegin, int rbEnd)
+    {
+        constexpr int maxBlockRows = std::ranges::max_element(simdTuner::MicroKernelShapes, {},
+                                                              &simdTuner::MicroKernelShape::regsA)->regsA;
+        std::array<T, maxBlockRows * maxBlockRows> diagonal;
+        for (int rb = rbBegin; rb < rbEnd; ++rb)
+        {
+            const int i0 = rb * blockRows;
+            const int rows = std::min(blockRows, M - i0);
+            for (int i = 0; i < rows; ++i)
+            {
+                for (int k = 0; k < rows; ++k)
+                {
+                    const bool inTriangle = Uplo == Triangle::Lower ? k <= i : k >= i;
+                    diagonal[i * rows + k] = inTriangle ? pt[(i0 + i) * M + i0 + k] : T(0);
+                }
+            }
+
+            // Lower: columns [0, i0) then the diagonal block, upper: the diagonal block then [i0 + rows, M).
+            const int rectBegin = Uplo == Triangle::Lower ? 0 : i0 + rows;
+            const int rectK = Uplo == Triangle::Lower ? i0 : M - i0 - rows;
+            for (int j = 0; j < N; j += blockCols)
+            {
+                const int cols = std::min(blockCols, N - j);
+                T *c = &pc[i0 * N + j];
+                if (rectK > 0)
+                {
+                    tile(rectK, &pt[i0 * M + rectBegin], M, &pb[rectBegin * N + j], N, c, N, rows, cols, {});
+                    accumulateTile(rows, diagonal.data(), rows, &pb[i0 * N + j], N, c, N, rows, cols,
+                                   Accumulate{T(1), nullptr, c, N, T(1)});
+                } else
+                {
+                    tile(rows, diagonal.data(), rows, &pb[i0 * N + j], N, c, N, rows, cols, {});
+                }
+            }
+        }
+    });
+    return result;
+}
+
+} // namespace structured
@@ -0,0 +1,345 @@
+#pragma once
+
+#include "matrix_benchmarks.hpp"
+#include "results_store.hpp"
+#include "utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+// Types whose worker count follows hostThreadCount(); everything else runs once per shape regardless of --threads.
+inline bool usesHostThreads(MatMultType multType)
+{
+    return multType == MatMultType::MultithreadSimd || parallelBackends::isOpenMp(multType);
+}
+
+// OpenCL kernels that run on the default device partition; a worker count selects an equal sub-device of that
+// many compute units.
+inline bool usesComputeUnits(MatMultType multType)
+{
+    return multType == MatMultType::NaiveOcl || multType == MatMultType::TiledOcl;
+}
+
+inline bool usesOpenCl(MatMultType multType)
+{
+    return multType == MatMultType::NaiveOcl || multType == MatMultType::HeterogeneousOcl 
+        || multType == MatMultType::TiledOcl;
+}
+
+inline bool usesSimdKernel(MatMultType multType)
+{
+    return multType == MatMultType::Simd || multType == MatMultType::MultithreadSimd 
+        || multType == MatMultType::HeterogeneousOcl || parallelBackends::isOpenMp(multType)
+        || multType == MatMultType::ParUnseq;
+}
+
+inline std::string activeSimdShape(MatMultDataType dataType)
+{
+    switch (dataType)
+    {
+        case MatMultDataType::Int32: return simdTuner::activeShape<int32_t>().description();
+        case MatMultDataType::Uint32: return simdTuner::activeShape<uint32_t>().description();
+        case MatMultDataType::Float: return simdTuner::activeShape<float>().description();
+        default: return simdTuner::activeShape<double>().description();
+    }
+}
+
+inline std::string autoChoice(int order, MatMultDataType dataType)
+{
+    switch (dataType)
+    {
+        case MatMultDataType::Int32: return kernelSelector::select<int32_t>(order).description();
+        case MatMultDataType::Uint32: return kernelSelector::select<uint32_t>(order).description();
+        case MatMultDataType::Float: return kernelSelector::select<float>(order).description();
+        default: return kernelSelector::select<double>(order).description();
+    }
+}
+
+// Tile configuration TiledOcl runs with at this order, resolved the same way as oclTuner::tiledProgram.
+inline boost::json::object resolvedTiledConfig(int order, MatMultDataType dataType)
+{
+    const auto device = oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+    const auto shapeClass = oclTuner::shapeClassOf(order);
+    const auto [config, fromDatabase] = [&]()
+    {
+        switch (dataType)
+        {
+            case MatMultDataType::Int32: return oclTuner::resolveTiledConfig<int32_t>(device, shapeClass);
+            case MatMultDataType::Uint32: return oclTuner::resolveTiledConfig<uint32_t>(device, shapeClass);
+            case MatMultDataType::Float: return oclTuner::resolveTiledConfig<float>(device, shapeClass);
+            default: return oclTuner::resolveTiledConfig<double>(device, shapeClass);
+        }
+    }();
+
+    boost::json::object obj;
+    obj["tile_size"] = config.tileSize;
+    obj["work_per_thread"] = config.workPerThread;
+    obj["source"] = fromDatabase ? "tuning_database" : "default";
+    return obj;
+}
+
+struct SweepPoint
+{
+    int order = constants::DEFAULT_MATRIX_ORDER;
+    MatMultType multType = MatMultType::Naive;
+    MatMultDataType dataType = MatMultDataType::Float;
+    // Host threads, or compute units for usesComputeUnits() kernels. 0 keeps the default.
+    uint32_t threads = 0;
+
+    std::string description() const
+    {
+        std::string str = std::format("{:<20}{:<8}{}x{}", util::toString(multType), util::toString(dataType), order, order);
+        if (threads) str += std::format(" {}={}", usesComputeUnits(multType) ? "compute_units" : "threads", threads);
+        return str;
+    }
+};
+
+struct SweepSpec
+{
+    std::vector<int> orders;
+    std::vector<MatMultType> multTypes;
+    std::vector<MatMultDataType> dataTypes;
+    std::vector<uint32_t> threadCounts;
+};
+
+// MultithreadElement starts a thread per output element and MultithreadRow one per row, so above these orders a
+// single product starts more threads than the measurement can say anything about.
+inline int maxSweepOrder(MatMultType multType)
+{
+    switch (multType)
+    {
+        case MatMultType::MultithreadElement: return 64;
+        case MatMultType::MultithreadRow: return 1024;
+        default: return std::numeric_limits<int>::max();
+    }
+}
+
+// Nested in the same order as dispatchMatMultBenchmarks: shape, kernel, data type, then thread count. Baselines
+// run first at every shape so the other kernels can be reported relative to them. Kernels are left out above
+// their maxSweepOrder with a warning.
+inline std::vector<SweepPoint> expandSweep(const SweepSpec &spec)
+{
+    std::vector<MatMultType> multTypes = spec.multTypes;
+    std::ranges::stable_partition(multTypes, isBaseline);
+
+    std::vector<SweepPoint> plan;
+    for (int order : spec.orders)
+    {
+        for (MatMultType multType : multTypes)
+        {
+            if (order > maxSweepOrder(multType))
+            {
+                std::cerr << "Skipping " << util::toString(multType) << " at order " << order 
+                          << ": it starts a thread per " << (multType == MatMultType::MultithreadRow ? "row" : "element") 
+                          << ", use orders up to " << maxSweepOrder(multType) << '\n';
+                continue;
+            }
+            for (MatMultDataType dataType : spec.dataTypes)
+            {
+                if (not usesHostThreads(multType) || spec.threadCounts.empty())
+                {
+                    plan.push_back({order, multType, dataType, 0});
+                    continue;
+                }
+                for (uint32_t threads : spec.threadCounts)
+                {
+                    plan.push_back({order, multType, dataType, threads});
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// Everything that decides what a sweep point measures. Two points with equal configurations run by the same
+// executable on the same host are expected to produce the same numbers.
+inline boost::json::object sweepPointConfig(const SweepPoint &point)
+{
+    boost::json::object config;
+    config["order"] = point.order;
+    config["kernel"] = util::toString(point.multType);
+    config["dtype"] = util::toString(point.dataType);
+    if (usesHostThreads(point.multType))
+    {
+        config["threads"] = point.threads ? point.threads : effectiveHostThreadCount();
+    }
+
+    const RunnerConfig &runner = defaultRunnerConfig();
+    config["warmup_iterations"] = runner.warmupIterations;
+    config["min_iterations"] = runner.minIterations;
+    config["max_iterations"] = runner.maxIterations;
+    config["target_relative_ci"] = runner.targetRelativeCi;
+    config["time_budget_seconds"] = runner.timeBudgetSeconds;
+    config["outlier_threshold"] = runner.outlierThreshold;
+    config["cache_mode"] = cache::toString(runner.cacheMode);
+    config["hardware_counters"] = runner.hardwareCounters;
+    config["energy"] = runner.energy;
+    boost::json::object verification;
+    verification["rounds"] = runner.verification.rounds;
+    verification["float_tolerance"] = runner.verification.floatTolerance;
+    verification["double_tolerance"] = runner.verification.doubleTolerance;
+    config["verification"] = verification;
+    if (usesSimdKernel(point.multType))
+    {
+        config["simd_kernel"] = activeSimdShape(point.dataType);
+    }
+    if (point.multType == MatMultType::Auto)
+    {
+        config["auto_choice"] = autoChoice(point.order, point.dataType);
+    }
+
+    if (usesOpenCl(point.multType))
+    {
+        const oclUtil::DeviceSelector &selector = oclUtil::defaultDeviceSelector();
+        config["device"] = std::format("platform={},name={},type={},index={}", selector.platformName, 
+                                       selector.deviceName, oclUtil::deviceTypeToString(selector.type), selector.index);
+        config["sub_device"] = oclUtil::defaultDevicePartition().description();
+    }
+    if (point.multType == MatMultType::TiledOcl)
+    {
+        // Left out when no device can be selected, the point fails when it runs.
+        try
+        {
+            config["ocl_config"] = resolvedTiledConfig(point.order, point.dataType);
+        } catch (const std::exception &)
+        {
+        }
+    }
+    return config;
+}
+
+struct StoreOptions
+{
+    ResultsStore *store = nullptr;
+    // Reuse the stored record instead of measuring when this executable already ran the same configuration.
+    bool skipUnchanged = false;
+    // Compare every point against a stored baseline run, see ResultsStore::baseline.
+    bool compare = false;
+    std::string baselineSelector = "latest";
+    double regressionThreshold = 0.05;
+    double significance = 0.05;
+};
+
+inline constexpr int REGRESSION_EXIT_CODE = 2;
+
+using RecordCallback = std::function<void(const SweepPoint &, const boost::json::object &)>;
+
+// Applies a point's worker count for the duration of its run and restores the defaults afterwards, also when the
+// benchmark throws.
+class SweepPointScope
+{
+public:
+    SweepPointScope() : m_threadCount(hostThreadCount()), m_partition(oclUtil::defaultDevicePartition()) {}
+    ~SweepPointScope()
+    {
+        defaultResultSink().setObserver(nullptr);
+        hostThreadCount() = m_threadCount;
+        oclUtil::defaultDevicePartition() = m_partition;
+    }
+
+    SweepPointScope(const SweepPointScope &) = delete;
+    SweepPointScope &operator=(const SweepPointScope &) = delete;
+
+    void apply(const SweepPoint &point)
+    {
+        hostThreadCount() = usesHostThreads(point.multType) && point.threads ? point.threads : m_threadCount;
+        oclUtil::defaultDevicePartition() = usesComputeUnits(point.multType) && point.threads 
+            ? oclUtil::DevicePartition::equally(point.threads) 
+            : m_partition;
+    }
+private:
+    uint32_t m_threadCount;
+    oclUtil::DevicePartition m_partition;
+};
+
+// onRecord sees every record the sweep produces, including ones reused from the store.
+inline int runSweep(const std::vector<SweepPoint> &plan, const StoreOptions &options = {}, 
+                    const RecordCallback &onRecord = {})
+{
+    ResultsStore *store = options.store;
+    std::vector<std::pair<SweepPoint, boost::json::object>> measured;
+    int result{0};
+    {
+        SweepPointScope scope;
+        for (const auto &point : plan)
+        {
+            scope.apply(point);
+
+            boost::json::object config;
+            std::string configHash;
+            if (store)
+            {
+                config = sweepPointConfig(point);
+                configHash = fnv1aHex(boost::json::serialize(config));
+            }
+
+            if (store && options.skipUnchanged)
+            {
+                if (auto previous = store->unchanged(configHash))
+                {
+                    std::cerr << "Unchanged, reusing run " << (*previous)["run_id"].as_string().c_str() << ": " 
+                              << point.description() << "\n";
+                    if (onRecord) onRecord(point, *previous);
+                    measured.emplace_back(point, std::move(*previous));
+                    continue;
+                }
+            }
+
+            if (store || onRecord)
+            {
+                defaultResultSink().setObserver([&](const boost::json::object &record)
+                {
+                    if (store)
+                    {
+                        store->append(record, config, configHash);
+                        measured.emplace_back(point, store->records().back());
+                    }
+                    if (onRecord) onRecord(point, record);
+                });
+            }
+            result = dispatchMultDataType(point.order, point.multType, point.dataType);
+            defaultResultSink().setObserver(nullptr);
+            if (result != 0) break;
+        }
+    }
+    if (result != 0 || not store || not options.compare) return result;
+
+    bool regressed = false;
+    std::cerr << std::format("\n{:<48}{:>14}{:>14}{:>10}{:>10}\n", "benchmark", "baseline [s]", "current [s]", "change", "p");
+    for (const auto &[point, record] : measured)
+    {
+        if (verification::failed(record))
+        {
+            std::cerr << std::format("{:<48}{:>14}\n", point.description(), "not verified");
+            continue;
+        }
+        const std::string configHash(record.at("config_hash").as_string().c_str());
+        const auto baseline = store->baseline(configHash, options.baselineSelector, record.at("run_id").as_string().c_str());
+        if (not baseline)
+        {
+            std::cerr << std::format("{:<48}{:>14}\n", point.description(), "no baseline");
+            continue;
+        }
+
+        const RegressionCheck check = compareRecords(*baseline, record, options.regressionThreshold, options.significance);
+        std::cerr << std::format("{:<48}{:>14.6f}{:>14.6f}{:>9.1f}%{:>10.4f}{}\n", point.description(), check.baselineMean, 
+                                 check.currentMean, check.change * 100.0, check.pValue, check.regression ? "  REGRESSION" : "");
+        regressed = regressed || check.regression;
+    }
+    return regressed ? REGRESSION_EXIT_CODE : 0;
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Padding that keeps independently written fields off each other's cache lines. GCC builds pin the value with
+// --param=destructive-interference-size so every translation unit agrees on the layout.
+#ifdef __cpp_lib_hardware_interference_size
+inline constexpr size_t CACHE_LINE_SIZE = std::hardware_destructive_interference_size;
+#else
+inline constexpr size_t CACHE_LINE_SIZE = 64;
+#endif
+
+// Generation counting barrier. A phase may have fewer participants than count(), as long as all of them pass the
+// same number. Waiters spin for a while and then sleep on the generation word (a futex on Linux), so back to back
+// phases never enter the kernel and idle ones do not burn a core.
+class SpinBarrier
+{
+public:
+    explicit SpinBarrier(uint32_t count) : m_count(count) {}
+
+    void arriveAndWait() { arriveAndWait(m_count); }
+    // Returns once that many threads, the caller included, have arrived in the current phase.
+    void arriveAndWait(uint32_t participants);
+
+    uint32_t count() const { return m_count; }
+private:
+    alignas(CACHE_LINE_SIZE) const uint32_t m_count;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_arrived{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_generation{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_sleepers{0};
+};
+
+// Spins on value until it differs from old, then sleeps on it with sleepers counting the sleeping threads so
+// that the notifying side can skip the wake up call when everybody is still spinning.
+uint32_t spinThenWait(const std::atomic<uint32_t> &value, uint32_t old, std::atomic<uint32_t> &sleepers);
+
+// Persistent fork-join team for jobs too short to amortize creating threads or waking a condition variable per
+// task. The caller of run() is member 0; the other members are parked threads, each woken through its own epoch
+// counter only when a job uses it, that leave through a SpinBarrier sized to the job. Jobs must not throw.
+class ThreadTeam
+{
+public:
+    // size members including the calling thread.
+    explicit ThreadTeam(size_t size);
+    ~ThreadTeam();
+
+    ThreadTeam(const ThreadTeam &) = delete;
+    ThreadTeam &operator=(const ThreadTeam &) = delete;
+
+    size_t size() const { return m_members.size(); }
+
+    // Runs body(member, count) on members [0, count) and returns once all of them finished. Returns false without
+    // running anything when another thread is running a job on the team or count exceeds its size.
+    template<typename Body>
+    bool tryRun(int count, const Body &body)
+    {
+        std::unique_lock<std::mutex> lock(m_dispatchMutex, std::try_to_lock);
+        if (not lock.owns_lock() || count < 1 || static_cast<size_t>(count) > size()) return false;
+
+        dispatch(count, &body, [](const void *context, int member, int memberCount)
+        {
+            (*static_cast<const Body *>(context))(member, memberCount);
+        });
+        return true;
+    }
+
+    // Jobs dispatched since construction, for tests and diagnostics.
+    uint64_t jobsRun() const { return m_members[0].jobs; }
+private:
+    using Invoke = void (*)(const void *, int, int);
+
+    // Padded so that members never share a cache line. epoch is bumped by the dispatching thread for every job the
+    // member takes part in, jobs is written by the member itself.
+    struct alignas(CACHE_LINE_SIZE) Member
+    {
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> sleepers{0};
+        uint64_t jobs = 0;
+    };
+
+    static void wake(Member &member);
+    void dispatch(int count, const void *context, Invoke invoke);
+    void workerLoop(int member);
+
+    std::vector<Member> m_members;
+    std::vector<std::thread> m_threads;
+    SpinBarrier m_barrier;
+    std::mutex m_dispatchMutex;
+
+    // Job description, published by the release increment of each member's epoch.
+    const void *m_context = nullptr;
+    Invoke m_invoke = nullptr;
+    int m_count = 0;
+    bool m_stop = false;
+};
+
+// Process wide team with at least size members. A single team is kept, replaced by a bigger one when a job needs
+// more members; callers hold the returned pointer for the duration of tryRun so a replaced team outlives its
+// last job. Members beyond the job's count stay parked.
+std::shared_ptr<ThreadTeam> sharedThreadTeam(size_t size);
+
+// Jobs up to this many flops run on the shared team instead of freshly created threads. Above it the start up
+// cost of threads is negligible and spinning at the join would only waste the caller's core.
+inline constexpr double THREAD_TEAM_MAX_FLOPS = 2.0 * 512 * 512 * 512;
@@ -0,0 +1,394 @@
+#pragma once
+
+#include "matrix_benchmarks.hpp"
+#include "sweep.hpp"
+#include "utils.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <latch>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+
+// How the host threads are divided between concurrent jobs of the multithreaded kernels.
+enum class PoolMode
+{
+    // Every job runs on all host threads, so the jobs oversubscribe the cores.
+    Shared = 0,
+    // Every job runs on an equal slice of the host threads.
+    Partitioned
+};
+
+inline std::string toString(PoolMode mode)
+{
+    return mode == PoolMode::Shared ? "shared" : "partitioned";
+}
+
+inline std::vector<PoolMode> poolModesFromString(std::string_view str)
+{
+    const std::string strLower = util::toLower(str);
+    if (strLower == "shared") return { PoolMode::Shared };
+    if (strLower == "partitioned") return { PoolMode::Partitioned };
+    if (strLower == "both") return { PoolMode::Shared, PoolMode::Partitioned };
+    throw std::invalid_argument("Unknown pool mode (use shared, partitioned or both): " + std::string(str));
+}
+
+inline uint32_t threadsPerJob(PoolMode mode, uint32_t jobs, uint32_t hostThreads)
+{
+    return mode == PoolMode::Shared ? hostThreads : std::max(1u, hostThreads / std::max(1u, jobs));
+}
+
+// Products of one run of concurrent jobs, latencies of all jobs pooled.
+struct ThroughputSample
+{
+    uint32_t jobs = 1;
+    uint32_t threadsPerJob = 1;
+    std::vector<double> latencies;
+    double wallSeconds = 0.0;
+    // First failing check, or the one with the largest error when all jobs passed.
+    std::optional<verification::Result> verification;
+
+    double gflops(double flopsPerProduct) const
+    {
+        return wallSeconds > 0.0 ? flopsPerProduct * static_cast<double>(latencies.size()) / wallSeconds * 1e-9 : 0.0;
+    }
+};
+
+// One tenant: its own operands and result, multiplied with MultType on threadCount host threads where the kernel
+// takes a thread count. OpenCL kernels share the queue of the process wide program of the selected device.
+template<typename DataType, uint32_t Order, MatMultType MultType>
+class ThroughputJob
+{
+public:
+    using MatrixType = typename MatMultOperands<DataType, Order, Order>::MatrixType;
+
+    explicit ThroughputJob(int threadCount) : m_threadCount(threadCount)
+    {
+        m_operands.prepare(cache::Mode::Warm);
+    }
+
+    void multiply()
+    {
+        if constexpr (MultType == MatMultType::MultithreadSimd || parallelBackends::isOpenMp(MultType))
+        {
+            m_matC = MatrixMultImpl<MultType, MatrixType, MatrixType>::multiply(m_operands.a(), m_operands.b(), m_threadCount);
+        } else
+        {
+            m_matC = m_operands.a().template mult<MultType>(m_operands.b());
+        }
+    }
+
+    verification::Result verify(const verification::Config &config) const
+    {
+        return verifyProduct(m_operands, m_matC, "Throughput_" + util::toString(MultType), config);
+    }
+private:
+    int m_threadCount;
+    MatMultOperands<DataType, Order, Order> m_operands;
+    MatrixType m_matC;
+};
+
+// Starts jobCount jobs together after their warmup and lets each multiply until it has run minIterations and the
+// time budget is spent, or maxIterations. The wall time ends with the last job, so a straggler lowers the
+// aggregate rate like it would in production.
+template<typename DataType, uint32_t Order, MatMultType MultType>
+ThroughputSample runConcurrentJobs(uint32_t jobCount, uint32_t threadCount, const RunnerConfig &config)
+{
+    using Job = ThroughputJob<DataType, Order, MultType>;
+    std::vector<std::unique_ptr<Job>> jobs;
+    for (uint32_t i = 0; i < jobCount; ++i) jobs.push_back(std::make_unique<Job>(static_cast<int>(threadCount)));
+
+    const uint32_t minIterations = std::max(config.minIterations, 1u);
+    const uint32_t maxIterations = std::max(minIterations, config.maxIterations);
+    const std::chrono::duration<double> budget{config.timeBudgetSeconds};
+
+    std::vector<std::vector<double>> latencies(jobCount);
+    std::vector<std::exception_ptr> errors(jobCount);
+    std::latch started(jobCount + 1);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < jobCount; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            try
+            {
+                for (uint32_t w = 0; w < config.warmupIterations; ++w) jobs[i]->multiply();
+            } catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+            started.arrive_and_wait();
+            if (errors[i]) return;
+
+            try
+            {
+                const auto begin{std::chrono::steady_clock::now()};
+                while (true)
+                {
+                    TRACE_SCOPE("throughput job", "throughput");
+                    const auto start{std::chrono::steady_clock::now()};
+                    jobs[i]->multiply();
+                    const auto finish{std::chrono::steady_clock::now()};
+                    latencies[i].push_back(std::chrono::duration<double>{finish - start}.count());
+
+                    const size_t done = latencies[i].size();
+                    if (done >= maxIterations || (done >= minIterations && finish - begin >= budget)) break;
+                }
+            } catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    started.arrive_and_wait();
+    const auto start{std::chrono::steady_clock::now()};
+    for (auto &thread : threads) thread.join();
+    const auto finish{std::chrono::steady_clock::now()};
+
+    for (const auto &error : errors)
+    {
+        if (error) std::rethrow_exception(error);
+    }
+
+    ThroughputSample sample;
+    sample.jobs = jobCount;
+    sample.threadsPerJob = threadCount;
+    sample.wallSeconds = std::chrono::duration<double>{finish - start}.count();
+    for (const auto &jobLatencies : latencies)
+    {
+        sample.latencies.insert(sample.latencies.end(), jobLatencies.begin(), jobLatencies.end());
+    }
+
+    if (config.verification.rounds > 0)
+    {
+        for (const auto &job : jobs)
+        {
+            const auto result = job->verify(config.verification);
+            if (not sample.verification || (sample.verification->passed
+                && (not result.passed || result.maxRelativeError > sample.verification->maxRelativeError)))
+            {
+                sample.verification = result;
+            }
+        }
+    }
+    return sample;
+}
+
+// Slowdown is the median latency of a job among others over the median of the same job, on as many threads,
+// running alone; throughput_vs_isolated is the aggregate rate over the rate of that single job.
+inline boost::json::object throughputJson(MatMultType multType, const std::optional<PoolMode> &pool,
+                                          const ThroughputSample &sample, const ThroughputSample &isolated,
+                                          double flopsPerProduct)
+{
+    boost::json::object obj;
+    obj["name"] = "Throughput_" + util::toString(multType);
+    if (pool) obj["pool"] = toString(*pool);
+    obj["jobs"] = sample.jobs;
+    if (pool) obj["threads_per_job"] = sample.threadsPerJob;
+    obj["products"] = sample.latencies.size();
+    obj["wall_seconds"] = sample.wallSeconds;
+    obj["aggregate_gflops"] = sample.gflops(flopsPerProduct);
+
+    const auto latency = computeStatistics(sample.latencies);
+    obj["median_latency_seconds"] = latency.median;
+    obj["p90_latency_seconds"] = latency.p90;
+    obj["p99_latency_seconds"] = latency.p99;
+    obj["max_latency_seconds"] = latency.max;
+
+    const auto isolatedLatency = computeStatistics(isolated.latencies);
+    obj["isolated_median_latency_seconds"] = isolatedLatency.median;
+    obj["isolated_gflops"] = isolated.gflops(flopsPerProduct);
+    if (isolatedLatency.median > 0.0) obj["slowdown_vs_isolated"] = latency.median / isolatedLatency.median;
+    if (isolated.gflops(flopsPerProduct) > 0.0)
+    {
+        obj["throughput_vs_isolated"] = sample.gflops(flopsPerProduct) / isolated.gflops(flopsPerProduct);
+    }
+    injectVerification(obj, sample.verification);
+    return obj;
+}
+
+// Every job count in every pool mode, each against one job alone on the same threads. Pool modes only apply to
+// kernels with a host thread count, the others run once per job count.
+template<typename DataType, uint32_t Order, MatMultType MultType>
+int runThroughputPoint(const std::vector<uint32_t> &jobCounts, const std::vector<PoolMode> &poolModes)
+{
+    const RunnerConfig &config = defaultRunnerConfig();
+    const double flops = 2.0 * Order * Order * Order;
+    const bool hostThreads = usesHostThreads(MultType);
+    const uint32_t threads = effectiveHostThreadCount();
+
+    std::map<uint32_t, ThroughputSample> isolated;
+    for (PoolMode mode : poolModes)
+    {
+        if (not hostThreads && mode != poolModes.front()) break;
+        for (uint32_t jobs : jobCounts)
+        {
+            const uint32_t jobThreads = hostThreads ? threadsPerJob(mode, jobs, threads) : 1;
+            auto it = isolated.find(jobThreads);
+            if (it == isolated.end())
+            {
+                it = isolated.emplace(jobThreads, runConcurrentJobs<DataType, Order, MultType>(1, jobThreads, config)).first;
+            }
+            const auto sample = jobs == 1 ? it->second : runConcurrentJobs<DataType, Order, MultType>(jobs, jobThreads, config);
+
+            auto obj = throughputJson(MultType, hostThreads ? std::optional<PoolMode>(mode) : std::nullopt, sample,
+                                      it->second, flops);
+            obj["data_type"] = typeid(DataType).name();
+            obj["matrix_dims"] = std::format("{}x{}", Order, Order);
+            defaultResultSink().write(obj);
+        }
+    }
+    return 0;
+}
+
+template <typename DataType, MatMultType MultType, size_t... OrderIndices>
+int dispatchThroughputOrder(int order, const std::vector<uint32_t> &jobCounts, const std::vector<PoolMode> &poolModes,
+                            std::index_sequence<OrderIndices...>)
+{
+    int result{-1};
+    const bool dispatched = ((order == MatMultOrders[OrderIndices]
+                              && (result = runThroughputPoint<DataType, MatMultOrders[OrderIndices], MultType>(jobCounts, poolModes), true)) || ...);
+    if (not dispatched) throw std::runtime_error("Unsupported mat mult order\n");
+    return result;
+}
+
+template <typename DataType>
+int dispatchThroughput(int order, MatMultType multType, const std::vector<uint32_t> &jobCounts,
+                       const std::vector<PoolMode> &poolModes)
+{
+    constexpr auto orders = std::make_index_sequence<MatMultOrders.size()>{};
+    switch (multType)
+    {
+        case MatMultType::Naive: return dispatchThroughputOrder<DataType, MatMultType::Naive>(order, jobCounts, poolModes, orders);
+        case MatMultType::Simd: return dispatchThroughputOrder<DataType, MatMultType::Simd>(order, jobCounts, poolModes, orders);
+        case MatMultType::MultithreadElement: return dispatchThroughputOrder<DataType, MatMultType::MultithreadElement>(order, jobCounts, poolModes, orders);
+        case MatMultType::MultithreadRow: return dispatchThroughputOrder<DataType, MatMultType::MultithreadRow>(order, jobCounts, poolModes, orders);
+        case MatMultType::MultithreadSimd: return dispatchThroughputOrder<DataType, MatMultType::MultithreadSimd>(order, jobCounts, poolModes, orders);
+        case MatMultType::NaiveOcl: return dispatchThroughputOrder<DataType, MatMultType::NaiveOcl>(order, jobCounts, poolModes, orders);
+        case MatMultType::HeterogeneousOcl: return dispatchThroughputOrder<DataType, MatMultType::HeterogeneousOcl>(order, jobCounts, poolModes, orders);
+        case MatMultType::TiledOcl: return dispatchThroughputOrder<DataType, MatMultType::TiledOcl>(order, jobCounts, poolModes, orders);
+        case MatMultType::OmpStatic:
+        case MatMultType::OmpDynamic:
+        case MatMultType::OmpGuided:
+            if (not parallelBackends::openMpAvailable)
+            {
+                std::cerr << "Skipping " << util::toString(multType) << ": built without OpenMP\n";
+                return 0;
+            }
+            if (multType == MatMultType::OmpStatic) return dispatchThroughputOrder<DataType, MatMultType::OmpStatic>(order, jobCounts, poolModes, orders);
+            if (multType == MatMultType::OmpDynamic) return dispatchThroughputOrder<DataType, MatMultType::OmpDynamic>(order, jobCounts, poolModes, orders);
+            return dispatchThroughputOrder<DataType, MatMultType::OmpGuided>(order, jobCounts, poolModes, orders);
+        case MatMultType::ParUnseq:
+            if (not parallelBackends::parUnseqAvailable)
+            {
+                std::cerr << "Skipping ParUnseq: built without a parallel std::execution backend\n";
+                return 0;
+            }
+            return dispatchThroughputOrder<DataType, MatMultType::ParUnseq>(order, jobCounts, poolModes, orders);
+        case MatMultType::Auto: return dispatchThroughputOrder<DataType, MatMultType::Auto>(order, jobCounts, poolModes, orders);
+        case MatMultType::Ublas: return dispatchThroughputOrder<DataType, MatMultType::Ublas>(order, jobCounts, poolModes, orders);
+        case MatMultType::Blas:
+            if constexpr (baselines::blasSupports<DataType>)
+            {
+                return dispatchThroughputOrder<DataType, MatMultType::Blas>(order, jobCounts, poolModes, orders);
+            } else
+            {
+                std::cerr << "Skipping Blas for " << oclUtil::getOpenCLTypeName<DataType>()
+                          << ": needs a cblas build and a floating point data type\n";
+                return 0;
+            }
+        default: throw std::runtime_error("Unsupported mat mult type\n");
+    }
+}
+
+inline std::vector<uint32_t> throughputJobCounts(std::vector<uint32_t> jobCounts)
+{
+    if (jobCounts.empty()) jobCounts = scalingSteps(std::max(2u, std::thread::hardware_concurrency()));
+    return jobCounts;
+}
+
+// What runThroughputStudy measures, in the same order. Kernels that do not use host threads run under the first
+// pool mode only.
+inline std::vector<std::string> throughputPlan(const std::vector<int> &orders, const std::vector<MatMultType> &multTypes,
+                                               const std::vector<MatMultDataType> &dataTypes,
+                                               const std::vector<uint32_t> &jobCounts,
+                                               const std::vector<PoolMode> &poolModes)
+{
+    const auto jobs = throughputJobCounts(jobCounts);
+    std::vector<std::string> plan;
+    for (MatMultType multType : multTypes)
+    {
+        for (int order : orders)
+        {
+            for (MatMultDataType dataType : dataTypes)
+            {
+                for (PoolMode mode : poolModes)
+                {
+                    const bool hostThreads = usesHostThreads(multType);
+                    if (not hostThreads && mode != poolModes.front()) break;
+                    for (uint32_t count : jobs)
+                    {
+                        std::string str = std::format("{:<20}{:<8}{}x{} jobs={}", util::toString(multType),
+                                                      util::toString(dataType), order, order, count);
+                        if (hostThreads) str += " pool=" + toString(mode);
+                        plan.push_back(std::move(str));
+                    }
+                }
+            }
+        }
+    }
+    return plan;
+}
+
+// Concurrent independent multiplications per kernel, order and data type. Job counts default to 1, 2, 4, ... N
+// hardware threads; OpenCL kernels without a usable device are skipped with a message.
+inline int runThroughputStudy(const std::vector<int> &orders, const std::vector<MatMultType> &multTypes,
+                              const std::vector<MatMultDataType> &dataTypes, const std::vector<uint32_t> &requestedJobCounts,
+                              const std::vector<PoolMode> &poolModes)
+{
+    const auto jobCounts = throughputJobCounts(requestedJobCounts);
+    for (MatMultType multType : multTypes)
+    {
+        for (int order : orders)
+        {
+            for (MatMultDataType dataType : dataTypes)
+            {
+                try
+                {
+                    switch (dataType)
+                    {
+                        case MatMultDataType::Int32: dispatchThroughput<int32_t>(order, multType, jobCounts, poolModes); break;
+                        case MatMultDataType::Uint32: dispatchThroughput<uint32_t>(order, multType, jobCounts, poolModes); break;
+                        case MatMultDataType::Float: dispatchThroughput<float>(order, multType, jobCounts, poolModes); break;
+                        default: dispatchThroughput<double>(order, multType, jobCounts, poolModes); break;
+                    }
+                } catch (const std::exception &e)
+                {
+                    if (not usesOpenCl(multType)) throw;
+                    std::cerr << "Skipping " << util::toString(multType) << ": " << e.what() << '\n';
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace Benchmarks
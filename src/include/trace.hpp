@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace trace
+{
+
+// Set by --trace. Trace points compiled in with ENABLE_TRACING cost one relaxed load while this is off.
+inline std::atomic<bool> tracingEnabled{false};
+
+inline bool enabled() { return tracingEnabled.load(std::memory_order_relaxed); }
+void setEnabled(bool enable);
+
+inline uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// nowNs() while tracing, 0 otherwise; for begin timestamps that are only recorded when tracing.
+inline uint64_t timestamp() { return enabled() ? nowNs() : 0; }
+
+// Names and categories are stored as pointers and must outlive the trace; use intern() for dynamic strings.
+const char *intern(std::string_view str);
+
+// Appends a complete event to the calling thread's ring buffer. Each thread owns its buffer, so recording takes
+// no lock; the first event of a thread takes a buffer from the pool allocated by setEnabled(true). Buffers keep
+// the newest events when full. Buffers of exited threads are reused by new threads once the pool runs dry, and
+// threads that find no buffer at all drop their events, see droppedEventCount().
+void recordComplete(const char *name, const char *category, uint64_t startNs, uint64_t endNs);
+
+// Appends a complete event to a named track that is not an OS thread, e.g. an OpenCL device queue.
+void recordTrackEvent(std::string_view track, const char *name, const char *category, uint64_t startNs, uint64_t endNs);
+
+void setThreadName(std::string_view name);
+
+// Chrome trace-event JSON, loadable in Perfetto and chrome://tracing. Call once the traced threads are idle.
+void writeChromeTrace(const std::filesystem::path &path);
+
+// Drops all recorded events, buffers of exited threads become free for new threads.
+void clear();
+
+size_t eventCount();
+
+// Events lost to a full pool since the last clear(), including those of reused buffers of exited threads.
+size_t droppedEventCount();
+
+class Scope
+{
+public:
+    explicit Scope(const char *name, const char *category = "cpu") 
+        : m_name(name), m_category(category), m_start(timestamp()) {}
+
+    ~Scope()
+    {
+        if (m_start) recordComplete(m_name, m_category, m_start, nowNs());
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+private:
+    const char *m_name;
+    const char *m_category;
+    uint64_t m_start;
+};
+
+} // namespace trace
+
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(...) ::trace::Scope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#else
+#define TRACE_SCOPE(...) ((void)0)
+#endif
@@ -3,6 +3,8 @@
 #include <boost/json.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <format>
 #include <fstream>
@@ -225,17 +227,25 @@ inline std::string toLower(std::string_view sv)
 
 std::string toString(MatMultType type);
 
+std::string toString(MatMultDataType type);
+
 template <typename Enum>
 Enum fromString(std::string_view s) 
 {
     static_assert(sizeof(Enum) == 0, "fromString not implemented");
 }
 
+template<>
+MatMultType fromString(std::string_view s);
+
+template<>
+MatMultDataType fromString(std::string_view s);
+
 template<typename T>
 constexpr auto enumAll() 
 requires requires { T::Last; }
 {
-    constexpr std::size_t N = static_cast<std::size_t>(T::Last) + 1;
+    constexpr std::size_t N = static_cast<std::size_t>(T::Last);
     std::array<T, N> values{};
     for (std::size_t i = 0; i < N; ++i) {
         values[i] = static_cast<T>(i);
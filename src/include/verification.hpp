@@ -0,0 +1,162 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Freivalds' check of C = A * B: for a random vector r, C r has to equal A (B r), which costs three matrix
+// vector products instead of a multiplication. It runs after the timed iterations of a benchmark, so a kernel
+// cannot become fast by being wrong.
+namespace verification
+{
+
+struct Config
+{
+    // Rounds with independent vectors, 0 disables verification. A wrong integer result survives a round with
+    // probability at most 1/2, a wrong floating point result practically never.
+    uint32_t rounds = 3;
+    // Largest accepted |C r - A (B r)| relative to |A| (|B| |r|) per row. Integer results have to match exactly.
+    double floatTolerance = 1e-5;
+    double doubleTolerance = 1e-12;
+
+    template<typename T>
+    double tolerance() const
+    {
+        if constexpr (std::is_same_v<T, float>) return floatTolerance;
+        else if constexpr (std::is_same_v<T, double>) return doubleTolerance;
+        else return 0.0;
+    }
+};
+
+struct Result
+{
+    bool passed = true;
+    uint32_t rounds = 0;
+    double tolerance = 0.0;
+    // Largest per-row error relative to its bound, over all rounds.
+    double maxRelativeError = 0.0;
+    // First row of C a round found wrong, -1 when passed. Integer mismatches have an infinite error.
+    int failedRow = -1;
+    uint64_t seed = 0;
+    double seconds = 0.0;
+
+    boost::json::object toJson() const
+    {
+        boost::json::object obj;
+        obj["method"] = "freivalds";
+        obj["passed"] = passed;
+        obj["rounds"] = rounds;
+        obj["tolerance"] = tolerance;
+        if (std::isfinite(maxRelativeError)) obj["max_relative_error"] = maxRelativeError;
+        if (not passed) obj["failed_row"] = failedRow;
+        obj["seed"] = seed;
+        obj["seconds"] = seconds;
+        return obj;
+    }
+};
+
+// Records of benchmarks whose result was checked and found wrong. Records without a check count as valid.
+inline bool failed(const boost::json::object &record)
+{
+    const auto *verified = record.if_contains("verified");
+    return verified && verified->is_bool() && not verified->as_bool();
+}
+
+// Checks the m x n result c of a (m x k) times b (k x n), all row major. Integer products are compared modulo
+// 2^32, which is what the kernels compute when a sum overflows; floating point ones accumulate in a wider type.
+template<typename T>
+Result freivalds(const T *a, const T *b, const T *c, int m, int k, int n, const Config &config, uint64_t seed)
+{
+    const auto start{std::chrono::steady_clock::now()};
+    Result result;
+    result.seed = seed;
+    result.tolerance = config.tolerance<T>();
+
+    std::mt19937_64 gen(seed);
+    if constexpr (std::is_integral_v<T>)
+    {
+        using U = std::make_unsigned_t<T>;
+        std::uniform_int_distribution<int> bit(0, 1);
+        std::vector<U> r(n), br(k);
+        for (uint32_t round = 0; round < config.rounds && result.passed; ++round, ++result.rounds)
+        {
+            std::ranges::generate(r, [&]() { return static_cast<U>(bit(gen)); });
+            for (int p = 0; p < k; ++p)
+            {
+                U sum = 0;
+                for (int j = 0; j < n; ++j) sum += static_cast<U>(b[p * n + j]) * r[j];
+                br[p] = sum;
+            }
+            for (int i = 0; i < m && result.passed; ++i)
+            {
+                U abr = 0;
+                U cr = 0;
+                for (int p = 0; p < k; ++p) abr += static_cast<U>(a[i * k + p]) * br[p];
+                for (int j = 0; j < n; ++j) cr += static_cast<U>(c[i * n + j]) * r[j];
+                if (abr != cr)
+                {
+                    result.passed = false;
+                    result.failedRow = i;
+                    result.maxRelativeError = std::numeric_limits<double>::infinity();
+                }
+            }
+        }
+    } else
+    {
+        using Acc = std::conditional_t<std::is_same_v<T, double>, long double, double>;
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector<Acc> r(n), br(k), bound(k);
+        for (uint32_t round = 0; round < config.rounds && result.passed; ++round, ++result.rounds)
+        {
+            std::ranges::generate(r, [&]() { return static_cast<Acc>(uniform(gen)); });
+            for (int p = 0; p < k; ++p)
+            {
+                Acc sum = 0;
+                Acc abs = 0;
+                for (int j = 0; j < n; ++j)
+                {
+                    sum += b[p * n + j] * r[j];
+                    abs += std::abs(b[p * n + j] * r[j]);
+                }
+                br[p] = sum;
+                bound[p] = abs;
+            }
+            for (int i = 0; i < m; ++i)
+            {
+                Acc abr = 0;
+                Acc rowBound = 0;
+                Acc cr = 0;
+                for (int p = 0; p < k; ++p)
+                {
+                    abr += a[i * k + p] * br[p];
+                    rowBound += std::abs(a[i * k + p]) * bound[p];
+                }
+                for (int j = 0; j < n; ++j) cr += c[i * n + j] * r[j];
+
+                const double error = static_cast<double>(std::abs(cr - abr)
+                                                         / std::max(rowBound, std::numeric_limits<Acc>::min()));
+                // Negated so that NaN fails as well.
+                if (not (error <= result.tolerance))
+                {
+                    result.passed = false;
+                    result.failedRow = i;
+                    result.maxRelativeError = std::isnan(error) ? std::numeric_limits<double>::infinity() : error;
+                    break;
+                }
+                result.maxRelativeError = std::max(result.maxRelativeError, error);
+            }
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+    return result;
+}
+
+} // namespace verification
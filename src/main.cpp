@@ -1,95 +1,195 @@
+#include "dispatch_benchmarks.hpp"
+#include "epilogue_benchmarks.hpp"
+#include "kernel_selector.hpp"
 #include "matrix_benchmarks.hpp"
 #include "matrix_benchmark_prog_opts.hpp"
 #include "ocl_utils.hpp"
+#include "results_store.hpp"
+#include "scaling.hpp"
+#include "simd_tuner.hpp"
+#include "structured_benchmarks.hpp"
+#include "sweep.hpp"
+#include "throughput_benchmarks.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
-#include <CL/cl.h>
-
+#include <filesystem>
 #include <iostream>
-#include <cstring>
-#include <cassert>
-
-#define CHECK_ERROR(err, msg) if (err != CL_SUCCESS) { std::cerr << msg << ": " << err << std::endl; exit(1); }
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace boost_po = boost::program_options;
 
-int main(int argc, char *argv[]) 
+namespace
+{
+
+template<typename OptType>
+std::vector<typename OptType::value_type> optionOr(const boost_po::variables_map &vm,
+                                                   std::vector<typename OptType::value_type> fallback)
+{
+    return vm.count(OptType::name) ? vm[OptType::name].template as<OptType>().opts : fallback;
+}
+
+// Values and ranges of a count option such as --threads, empty when it was not given.
+std::vector<uint32_t> countsOption(const boost_po::variables_map &vm, const std::string &name)
+{
+    std::vector<uint32_t> counts;
+    if (not vm.count(name)) return counts;
+
+    for (const auto &spec : vm[name].as<std::vector<std::string>>()) {
+        for (int count : MatBenchmarkProgOpts::expandRangeSpec(spec)) {
+            counts.push_back(static_cast<uint32_t>(count));
+        }
+    }
+    return counts;
+}
+
+// --list: one line per benchmark a mode would run, in run order.
+int printPlan(const std::vector<std::string> &plan)
+{
+    for (const auto &line : plan) {
+        std::cout << line << "\n";
+    }
+    std::cout << plan.size() << " benchmarks\n";
+    return 0;
+}
+
+// Writes the trace when main leaves, whichever mode ran.
+class TraceWriter
+{
+public:
+    explicit TraceWriter(std::filesystem::path path) : m_path(std::move(path))
+    {
+        trace::setEnabled(true);
+    }
+
+    ~TraceWriter()
+    {
+        trace::setEnabled(false);
+        try {
+            trace::writeChromeTrace(m_path);
+            std::cerr << "Trace with " << trace::eventCount() << " events written to " << m_path;
+            if (trace::droppedEventCount()) std::cerr << ", " << trace::droppedEventCount() << " dropped";
+            std::cerr << "\n";
+        }
+        catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+        }
+    }
+private:
+    std::filesystem::path m_path;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
 {
-    std::cout << "Stack size: " << constants::getStackSize() << " bytes\n";
-    const int N = 1024;
-    std::vector<float> A(N, 1.0f), B(N, 2.0f), C(N);
-
-//     const char *kernelSource = R"(__kernel void vector_add(__global const float* A,
-//     __global const float* B,
-//     __global float* C) {
-// int id = get_global_id(0);
-// C[id] = A[id] + B[id];
-// })";
-
-    oclUtil::ProgramWithQueue program("test.cl");
-    program.initialize();
-    program.build(nullptr);
-    program.saveBinary();
-    program.reset();
-    program.initialize();
-    program.loadFromBinary();
-    program.createQueueAndKernel("vector_add");
-
-    cl_int err;
-
-    oclUtil::memWrapper bufA = clCreateBuffer(program.getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N, A.data(), &err);
-    oclUtil::memWrapper bufB = clCreateBuffer(program.getContext(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * N, B.data(), &err);
-    oclUtil::memWrapper bufC = clCreateBuffer(program.getContext(), CL_MEM_WRITE_ONLY, sizeof(float) * N, nullptr, &err);
-
-    clSetKernelArg(program.getKernel(), 0, sizeof(cl_mem), &bufA);
-    clSetKernelArg(program.getKernel(), 1, sizeof(cl_mem), &bufB);
-    clSetKernelArg(program.getKernel(), 2, sizeof(cl_mem), &bufC);
-
-    size_t globalSize = N;
-    err = clEnqueueNDRangeKernel(program.getCmdQueue(), program.getKernel(), 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
-    CHECK_ERROR(err, "Failed to enqueue kernel");
-
-    clEnqueueReadBuffer(program.getCmdQueue(), bufC, CL_TRUE, 0, sizeof(float) * N, C.data(), 0, nullptr, nullptr);
-
-    for (int i = 0; i < 10; ++i)
-        std::cout << "C[" << i << "] = " << C[i] << std::endl;
-
-    // std::cin.get();
-
-    // Benchmarks::runAllMatrixMultTypesWithDataTypes<uint32_t>();
-    // std::cout << "RES 1: " << '\n';
-    // std::cout << Res4 << '\n';
-    // std::cout << "RES 2: " << '\n';
-    // std::cout << Res5 << '\n';
-
-    // assert(allEqual(Res1, Res2, Res3, Res4, Res5));
-
-    // Matrix<uint32_t, 128, 128> mat1{};
-    // mat1.randomFill();
-    // Matrix<uint32_t, 128, 128> mat2{};
-    // mat2.randomFill();
-    // auto res1 = mat1.mult<MatMultType::Naive>(mat2);
-    // // std::cout << "Res1: " << '\n' << res1;
-    // auto res2 = mat1.mult<MatMultType::Simd>(mat2);
-    // // std::cout << "\nRes2: " << '\n' << res2;
-    // //auto res3 = mat1.mult<MatMultType::MultithreadElement>(mat2);
-    // // std::cout << "\nRes3: " << '\n' << res3;
-    // //auto res4 = mat1.mult<MatMultType::MultithreadRow>(mat2);
-    // // std::cout << "\nRes4: " << '\n' << res4;
-    // auto res5 = mat1.mult<MatMultType::MultithreadSimd>(mat2);
-    // // std::cout << "\nRes5: " << '\n' << res5;
-    // auto res6 = mat1.mult<MatMultType::NaiveOcl>(mat2);
-    // std::cout << "\nRes6: " << '\n' << res6;
+    std::cerr << "Stack size: " << constants::getStackSize() << " bytes\n";
+
     try {
+        using namespace MatBenchmarkProgOpts;
+
+        boost_po::options_description sweepDesc("Sweep");
+        sweepDesc.add_options()
+            (MatMultTypeOpt::name, boost_po::value<MatMultTypeOpt>()->multitoken(),
+             ("kernels to run, 'all' or any of: " + MatMultTypeOpt::allowedStr()).c_str())
+            (MatMultDataTypeOpt::name, boost_po::value<MatMultDataTypeOpt>()->multitoken(),
+             ("data types to run, 'all' or any of: " + MatMultDataTypeOpt::allowedStr()).c_str())
+            (MatrixDimsOpt::name, boost_po::value<MatrixDimsOpt>()->multitoken(),
+             ("square matrix orders, single values or ranges like 128:4096:x2 (xF geometric, +S arithmetic steps). "
+              "Range values outside the compiled orders are skipped with a warning; compiled: "
+              + MatrixDimsOpt::allowedStr()).c_str())
+            ("threads", boost_po::value<std::vector<std::string>>()->multitoken(),
+             "host thread counts for the multithreaded kernels, values or ranges like 1:16:x2")
+            ("list", "print the plan of the selected mode without running it")
+            ("scaling", boost_po::value<std::string>(),
+             "run a scaling study instead of the sweep: strong, weak or both. Covers the kernels whose worker count "
+             "can be varied (default MultithreadSimd, NaiveOcl, TiledOcl) over --threads, or 1..N by default")
+            ("epilogue", "run bias, activation and residual add after the multiplication, once fused into the kernel "
+             "and once as separate passes over C (default kernels Simd, MultithreadSimd, TiledOcl)")
+            ("dispatch_latency", "measure fork-join latency of empty tasks on --threads (default 1, 2, 4, ... N) with "
+             "a std::thread per task, the ThreadPool and the persistent thread team")
+            ("throughput", boost_po::value<std::string>(),
+             "run concurrent independent multiplications at --shapes and --dtypes (default kernels Simd, MultithreadSimd, "
+             "TiledOcl): shared (each job "
+             "on all host threads), partitioned (each on an equal slice) or both. Reports aggregate GFLOPS, latency "
+             "percentiles and the slowdown against one job alone")
+            ("jobs", boost_po::value<std::vector<std::string>>()->multitoken(),
+             "concurrent job counts for --throughput, values or ranges like 1:8:x2 (default 1, 2, 4, ... N)")
+            ("structured", "run SYRK (A * A^T, with and without mirroring) and lower triangular TRMM next to the general "
+             "MultithreadSimd product at --shapes and --dtypes")
+        ;
+
+        boost_po::options_description iterationDesc("Iteration policy");
+        iterationDesc.add_options()
+            ("warmup", boost_po::value<uint32_t>(), "untimed warmup iterations per benchmark")
+            ("min_iterations", boost_po::value<uint32_t>(), "minimum number of timed iterations per benchmark")
+            ("max_iterations", boost_po::value<uint32_t>(), "maximum number of timed iterations per benchmark")
+            ("target_ci", boost_po::value<double>(),
+             "stop once the 95% confidence interval is within this fraction of the mean, e.g. 0.02")
+            ("time_budget", boost_po::value<double>(), "stop after this many seconds of measuring per benchmark")
+            ("outlier_threshold", boost_po::value<double>(), "modified z-score above which samples are rejected, 0 disables")
+            ("no_counters", "do not collect hardware performance counters")
+            ("no_energy", "do not read RAPL energy counters")
+            ("cache_mode", boost_po::value<std::string>()->default_value("warm"),
+             "cache state at the start of each timed iteration: warm (operands pre-touched), cold (operands "
+             "flushed) or rotating (cycle through operand sets larger than the last level cache)")
+            ("verify_rounds", boost_po::value<uint32_t>(),
+             "Freivalds rounds checking the result after the timed iterations, 0 disables. Failing results are flagged "
+             "and left out of baseline ratios and regression comparisons (default 3)")
+            ("verify_tolerance_float", boost_po::value<double>(), "accepted relative error of float results (default 1e-5)")
+            ("verify_tolerance_double", boost_po::value<double>(), "accepted relative error of double results (default 1e-12)")
+        ;
+
+        boost_po::options_description outputDesc("Output");
+        outputDesc.add_options()
+            ("output", boost_po::value<std::string>()->default_value("-"), "file to append results to, - for stdout")
+            ("format", boost_po::value<std::string>()->default_value("pretty"), "pretty (JSON objects) or ndjson")
+            ("trace", boost_po::value<std::string>(),
+             "record per-thread and per-device timelines and write them to this Chrome trace-event JSON file "
+             "(open in Perfetto); needs a build with ENABLE_TRACING")
+        ;
+
+        boost_po::options_description storeDesc("Results store");
+        storeDesc.add_options()
+            ("results_dir", boost_po::value<std::string>()->default_value(constants::RESULTS_DIR.string()),
+             "directory holding the per-host NDJSON history of all results")
+            ("no_store", "do not record results in the results directory")
+            ("skip_unchanged", "reuse stored results of configurations this executable already measured on this host")
+            ("compare", "compare every benchmark with a stored baseline and exit with 2 on a significant slowdown")
+            ("baseline", boost_po::value<std::string>()->default_value("latest"),
+             "baseline run for --compare: latest, or a prefix of a run id or git revision")
+            ("regression_threshold", boost_po::value<double>()->default_value(0.05),
+             "relative slowdown of the mean above which a benchmark can be flagged")
+            ("significance", boost_po::value<double>()->default_value(0.05),
+             "one-sided Welch t-test p-value below which a slowdown is significant")
+        ;
+
+        boost_po::options_description oclDesc("OpenCL");
+        oclDesc.add_options()
+            ("list_devices", "list available OpenCL devices")
+            ("device", boost_po::value<std::string>(),
+             "OpenCL device selector, e.g. platform=pocl,type=cpu,name=ryzen,index=0")
+            ("sub_device", boost_po::value<std::string>(),
+             "run OpenCL kernels on a sub-device of the selected device, e.g. equally=4 or affinity=numa,index=1")
+            ("autotune", "tune the tiled OpenCL kernel on the selected device and store the result in the tuning database")
+            ("cu_sweep", "run the OpenCL kernels on 1..N compute units of the selected device next to MultithreadSimd "
+             "on the same number of threads")
+        ;
+
         boost_po::options_description desc("Allowed options");
         desc.add_options()
             ("help", "produce help message")
-            (MatBenchmarkProgOpts::MatrixDimsOpt::name, 
-             boost_po::value<MatBenchmarkProgOpts::MatrixDimsOpt>()->multitoken(),
-             std::string("at least 1 valid (" + MatBenchmarkProgOpts::MatrixDimsOpt::allowedStr() + ")").c_str())
+            ("machine_peaks", "measure peak arithmetic throughput and memory bandwidth of the host and print them")
+            ("calibrate_auto", "measure the backends at --shapes (default 2..1024) and --dtypes on this host and store "
+             "the fastest per shape as the crossover table of the Auto kernel")
+            ("tune_simd", "benchmark the register block shapes of the SIMD microkernel on this host and store the "
+             "fastest per data type in the SIMD tuning database")
         ;
+        desc.add(sweepDesc).add(iterationDesc).add(outputDesc).add(storeDesc).add(oclDesc);
 
-        boost_po::variables_map vm;        
+        boost_po::variables_map vm;
         boost_po::store(boost_po::parse_command_line(argc, argv, desc), vm);
         boost_po::notify(vm);
 
@@ -98,12 +198,158 @@ int main(int argc, char *argv[])
             return 0;
         }
 
-        if (vm.count("compression")) {
-            std::cout << "Compression level was set to " 
-                 << vm["compression"].as<double>() << ".\n";
-        } else {
-            std::cout << "Compression level was not set.\n";
+        if (vm.count("list_devices")) {
+            for (const auto &device : oclUtil::enumerateDevices()) {
+                std::cout << device.description() << "\n";
+            }
+            return 0;
+        }
+
+        if (vm.count("device")) {
+            oclUtil::defaultDeviceSelector() = oclUtil::DeviceSelector::parse(vm["device"].as<std::string>());
+        }
+
+        if (vm.count("sub_device")) {
+            oclUtil::defaultDevicePartition() = oclUtil::DevicePartition::parse(vm["sub_device"].as<std::string>());
+        }
+
+        auto &runnerConfig = Benchmarks::defaultRunnerConfig();
+        if (vm.count("warmup")) runnerConfig.warmupIterations = vm["warmup"].as<uint32_t>();
+        if (vm.count("min_iterations")) runnerConfig.minIterations = vm["min_iterations"].as<uint32_t>();
+        if (vm.count("max_iterations")) runnerConfig.maxIterations = vm["max_iterations"].as<uint32_t>();
+        if (vm.count("target_ci")) runnerConfig.targetRelativeCi = vm["target_ci"].as<double>();
+        if (vm.count("time_budget")) runnerConfig.timeBudgetSeconds = vm["time_budget"].as<double>();
+        if (vm.count("outlier_threshold")) runnerConfig.outlierThreshold = vm["outlier_threshold"].as<double>();
+        if (vm.count("no_counters")) runnerConfig.hardwareCounters = false;
+        if (vm.count("no_energy")) runnerConfig.energy = false;
+        if (vm.count("verify_rounds")) runnerConfig.verification.rounds = vm["verify_rounds"].as<uint32_t>();
+        if (vm.count("verify_tolerance_float")) runnerConfig.verification.floatTolerance = vm["verify_tolerance_float"].as<double>();
+        if (vm.count("verify_tolerance_double")) runnerConfig.verification.doubleTolerance = vm["verify_tolerance_double"].as<double>();
+        runnerConfig.cacheMode = cache::modeFromString(vm["cache_mode"].as<std::string>());
+
+        auto &sink = Benchmarks::defaultResultSink();
+        sink.setFormat(Benchmarks::ResultSink::formatFromString(vm["format"].as<std::string>()));
+        sink.open(vm["output"].as<std::string>());
+
+        std::optional<TraceWriter> traceWriter;
+        if (vm.count("trace")) {
+            traceWriter.emplace(vm["trace"].as<std::string>());
+        }
+
+        if (vm.count("machine_peaks")) {
+            util::prettyPrint(std::cout, roofline::measureMachinePeaks());
+            return 0;
+        }
+
+        if (vm.count("tune_simd")) {
+            util::prettyPrint(std::cout, simdTuner::autotuneHost(simdTuner::TuningDatabase::instance()));
+            return 0;
+        }
+
+        if (vm.count("autotune")) {
+            const auto device = oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+            util::prettyPrint(std::cout, oclTuner::autotuneDevice(device, oclTuner::TuningDatabase::instance()));
+            return 0;
+        }
+
+        const Benchmarks::SweepSpec spec{
+            optionOr<MatrixDimsOpt>(vm, { 128, 256 }),
+            optionOr<MatMultTypeOpt>(vm, { MatMultType::Naive, MatMultType::NaiveOcl }),
+            optionOr<MatMultDataTypeOpt>(vm, { MatMultDataType::Float, MatMultDataType::Double }),
+            countsOption(vm, "threads")
+        };
+
+        if (vm.count("calibrate_auto")) {
+            const auto allDataTypes = util::enumAll<MatMultDataType>();
+            util::prettyPrint(std::cout, kernelSelector::calibrate(
+                kernelSelector::CrossoverTable::instance(), optionOr<MatrixDimsOpt>(vm, { 2, 64, 128, 256, 512, 1024 }),
+                optionOr<MatMultDataTypeOpt>(vm, { allDataTypes.begin(), allDataTypes.end() })));
+            return 0;
+        }
+
+        // Every mode below checks --list before it measures anything and prints its own plan instead.
+        const bool listOnly = vm.count("list") > 0;
+
+        if (vm.count("cu_sweep")) {
+            const auto dataTypes = optionOr<MatMultDataTypeOpt>(vm, { MatMultDataType::Float });
+            if (listOnly) return printPlan(Benchmarks::computeUnitSweepPlan(spec.orders, dataTypes));
+            roofline::measureMachinePeaks();
+            return Benchmarks::runComputeUnitSweep(spec.orders, dataTypes);
+        }
+
+        if (vm.count("dispatch_latency")) {
+            if (listOnly) return printPlan(Benchmarks::dispatchLatencyPlan(spec.threadCounts));
+            return Benchmarks::runDispatchLatency(spec.threadCounts);
+        }
+
+        if (vm.count("structured")) {
+            if (listOnly) return printPlan(Benchmarks::structuredPlan(spec.orders, spec.dataTypes));
+            return Benchmarks::runStructuredComparison(spec.orders, spec.dataTypes);
+        }
+
+        if (vm.count("epilogue")) {
+            const auto multTypes = optionOr<MatMultTypeOpt>(
+                vm, { MatMultType::Simd, MatMultType::MultithreadSimd, MatMultType::TiledOcl });
+            if (listOnly) return printPlan(Benchmarks::epiloguePlan(spec.orders, multTypes, spec.dataTypes));
+            return Benchmarks::runEpilogueComparison(spec.orders, multTypes, spec.dataTypes);
         }
+
+        if (vm.count("throughput")) {
+            const auto multTypes = optionOr<MatMultTypeOpt>(
+                vm, { MatMultType::Simd, MatMultType::MultithreadSimd, MatMultType::TiledOcl });
+            const auto jobCounts = countsOption(vm, "jobs");
+            const auto poolModes = Benchmarks::poolModesFromString(vm["throughput"].as<std::string>());
+            if (listOnly) {
+                return printPlan(Benchmarks::throughputPlan(spec.orders, multTypes, spec.dataTypes, jobCounts, poolModes));
+            }
+            return Benchmarks::runThroughputStudy(spec.orders, multTypes, spec.dataTypes, jobCounts, poolModes);
+        }
+
+        std::vector<Benchmarks::ScalingKind> scalingKinds;
+        if (vm.count("scaling")) {
+            scalingKinds = Benchmarks::scalingKindsFromString(vm["scaling"].as<std::string>());
+        }
+        const auto scalingTypes = optionOr<MatMultTypeOpt>(
+            vm, { MatMultType::MultithreadSimd, MatMultType::NaiveOcl, MatMultType::TiledOcl });
+        if (not scalingKinds.empty() && listOnly) {
+            return printPlan(Benchmarks::scalingPlan(scalingKinds, spec.orders, scalingTypes, spec.dataTypes,
+                                                     spec.threadCounts));
+        }
+
+        const auto plan = Benchmarks::expandSweep(spec);
+
+        if (listOnly) {
+            std::vector<std::string> lines;
+            for (const auto &point : plan) {
+                lines.push_back(point.description());
+            }
+            return printPlan(lines);
+        }
+
+        Benchmarks::StoreOptions storeOptions;
+        storeOptions.skipUnchanged = vm.count("skip_unchanged") > 0;
+        storeOptions.compare = vm.count("compare") > 0;
+        storeOptions.baselineSelector = vm["baseline"].as<std::string>();
+        storeOptions.regressionThreshold = vm["regression_threshold"].as<double>();
+        storeOptions.significance = vm["significance"].as<double>();
+
+        std::optional<Benchmarks::ResultsStore> store;
+        if (not vm.count("no_store")) {
+            store.emplace(vm["results_dir"].as<std::string>());
+            store->load();
+            storeOptions.store = &*store;
+        } else if (storeOptions.skipUnchanged || storeOptions.compare) {
+            throw std::invalid_argument("--skip_unchanged and --compare need the results store, drop --no_store");
+        }
+
+        roofline::measureMachinePeaks();
+
+        if (not scalingKinds.empty()) {
+            return Benchmarks::runScalingStudy(scalingKinds, spec.orders, scalingTypes, spec.dataTypes,
+                                               spec.threadCounts, storeOptions);
+        }
+
+        return Benchmarks::runSweep(plan, storeOptions);
     }
     catch(std::exception& e) {
         std::cerr << "error: " << e.what() << "\n";
@@ -111,17 +357,6 @@ int main(int argc, char *argv[])
     }
     catch(...) {
         std::cerr << "Exception of unknown type!\n";
+        return 1;
     }
-
-    std::vector<int> matrixOrdersToDispatch = { 128, 256 };
-    std::vector<MatMultType> multTypesToDispatch = { MatMultType::Naive, MatMultType::NaiveOcl };
-    std::vector<MatMultDataType> dataTypesToDispatch = { MatMultDataType::Float, MatMultDataType::Double };
-
-    return Benchmarks::dispatchMatMultBenchmarks(matrixOrdersToDispatch,multTypesToDispatch, dataTypesToDispatch);
-
-
-    // //assert(util::allEqual(res1, res2, res5, res6));
-
-    // // return result;
-    // return 0;
-}
\ No newline at end of file
+}
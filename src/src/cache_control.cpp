@@ -0,0 +1,151 @@
+#include "cache_control.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define CACHE_CONTROL_HAVE_CLFLUSH 1
+#endif
+
+namespace cache
+{
+
+namespace
+{
+
+constexpr size_t CACHE_LINE_BYTES = 64;
+constexpr size_t FALLBACK_LLC_BYTES = 32u << 20;
+
+volatile std::byte touchSink{};
+
+size_t parseCacheSize(std::string str)
+{
+    size_t multiplier = 1;
+    if (not str.empty() && (str.back() == 'K' || str.back() == 'M'))
+    {
+        multiplier = str.back() == 'K' ? 1024 : 1024 * 1024;
+        str.pop_back();
+    }
+    try
+    {
+        return std::stoul(str) * multiplier;
+    } catch (const std::exception &)
+    {
+        return 0;
+    }
+}
+
+size_t readLastLevelCacheBytes()
+{
+    namespace fs = std::filesystem;
+    const fs::path cacheDir = "/sys/devices/system/cpu/cpu0/cache";
+    std::error_code ec;
+    if (not fs::is_directory(cacheDir, ec)) return FALLBACK_LLC_BYTES;
+
+    int bestLevel = 0;
+    size_t bestSize = 0;
+    for (const auto &entry : fs::directory_iterator(cacheDir, ec))
+    {
+        if (entry.path().filename().string().rfind("index", 0) != 0) continue;
+
+        std::ifstream typeFile(entry.path() / "type");
+        std::ifstream levelFile(entry.path() / "level");
+        std::ifstream sizeFile(entry.path() / "size");
+        std::string type, size;
+        int level = 0;
+        if (not (typeFile >> type) || not (levelFile >> level) || not (sizeFile >> size)) continue;
+        if (type == "Instruction") continue;
+
+        const size_t bytes = parseCacheSize(size);
+        if (level > bestLevel || (level == bestLevel && bytes > bestSize))
+        {
+            bestLevel = level;
+            bestSize = bytes;
+        }
+    }
+    return bestSize ? bestSize : FALLBACK_LLC_BYTES;
+}
+
+[[maybe_unused]] void evictLastLevelCache()
+{
+    static std::vector<uint8_t> buffer(2 * lastLevelCacheBytes());
+    static uint8_t generation = 0;
+    ++generation;
+    for (size_t i = 0; i < buffer.size(); i += CACHE_LINE_BYTES)
+    {
+        buffer[i] = generation;
+    }
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+} // namespace
+
+std::string toString(Mode mode)
+{
+    switch (mode)
+    {
+        case Mode::Warm: return "warm";
+        case Mode::Cold: return "cold";
+        case Mode::Rotating: return "rotating";
+        default: return "unknown";
+    }
+}
+
+Mode modeFromString(std::string_view str)
+{
+    const std::string strLower = util::toLower(str);
+    for (size_t i = 0; i < static_cast<size_t>(Mode::Last); ++i)
+    {
+        if (toString(static_cast<Mode>(i)) == strLower) return static_cast<Mode>(i);
+    }
+    throw std::invalid_argument("Unknown cache mode: " + std::string(str));
+}
+
+size_t lastLevelCacheBytes()
+{
+    static const size_t bytes = readLastLevelCacheBytes();
+    return bytes;
+}
+
+void touch(std::span<const std::byte> buffer)
+{
+    std::byte accumulated{};
+    for (size_t i = 0; i < buffer.size(); i += CACHE_LINE_BYTES)
+    {
+        accumulated ^= buffer[i];
+    }
+    if (not buffer.empty()) accumulated ^= buffer.back();
+    touchSink = accumulated;
+}
+
+void flush(std::span<const std::byte> buffer)
+{
+#ifdef CACHE_CONTROL_HAVE_CLFLUSH
+    if (buffer.empty()) return;
+    for (size_t i = 0; i < buffer.size(); i += CACHE_LINE_BYTES)
+    {
+        _mm_clflush(buffer.data() + i);
+    }
+    _mm_clflush(&buffer.back());
+    _mm_mfence();
+#else
+    (void)buffer;
+    evictLastLevelCache();
+#endif
+}
+
+size_t rotatingSetCount(size_t setBytes, size_t maxSets)
+{
+    if (setBytes == 0) return 2;
+    const size_t needed = (2 * lastLevelCacheBytes() + setBytes - 1) / setBytes;
+    return std::clamp<size_t>(needed, 2, std::max<size_t>(maxSets, 2));
+}
+
+} // namespace cache
@@ -0,0 +1,163 @@
+#include "energy.hpp"
+
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace energy
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+template<typename T>
+std::optional<T> readValue(const fs::path &path)
+{
+    std::ifstream file(path);
+    T value{};
+    if (not (file >> value)) return std::nullopt;
+    return value;
+}
+
+bool startsWith(std::string_view str, std::string_view prefix)
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+const char *domainName(Domain domain)
+{
+    switch (domain)
+    {
+        case Domain::Package: return "package";
+        case Domain::Dram: return "dram";
+        default: return "unknown";
+    }
+}
+
+uint64_t counterDelta(uint64_t start, uint64_t end, uint64_t maxRange)
+{
+    if (end >= start || maxRange == 0) return end - start;
+    return maxRange - start + end;
+}
+
+EnergyMeter::EnergyMeter()
+{
+    discoverPowercap();
+    if (m_zones.empty()) discoverHwmon();
+    if (not m_zones.empty()) m_reason.clear();
+    else if (m_reason.empty()) m_reason = "no RAPL powercap zones or amd_energy sensors found";
+}
+
+// Top level zones are the packages (intel-rapl:0, intel-rapl:1), their subzones hold core, uncore and dram.
+void EnergyMeter::discoverPowercap()
+{
+    std::error_code ec;
+    const fs::path root = "/sys/class/powercap";
+    if (not fs::is_directory(root, ec)) return;
+
+    for (const auto &entry : fs::directory_iterator(root, ec))
+    {
+        const std::string zoneName = entry.path().filename().string();
+        if (not startsWith(zoneName, "intel-rapl:") && not startsWith(zoneName, "amd-rapl:")) continue;
+
+        const auto name = readValue<std::string>(entry.path() / "name");
+        if (not name) continue;
+
+        Domain domain;
+        if (startsWith(*name, "package")) domain = Domain::Package;
+        else if (*name == "dram") domain = Domain::Dram;
+        else continue;
+
+        const fs::path energyFile = entry.path() / "energy_uj";
+        if (not readValue<uint64_t>(energyFile))
+        {
+            m_reason = "cannot read " + energyFile.string() + " (RAPL counters usually need root)";
+            continue;
+        }
+        m_zones.push_back({domain, energyFile, readValue<uint64_t>(entry.path() / "max_energy_range_uj").value_or(0), 0});
+    }
+}
+
+// The amd_energy driver accumulates into 64 bit counters itself, so its values never wrap.
+void EnergyMeter::discoverHwmon()
+{
+    std::error_code ec;
+    const fs::path root = "/sys/class/hwmon";
+    if (not fs::is_directory(root, ec)) return;
+
+    for (const auto &entry : fs::directory_iterator(root, ec))
+    {
+        if (readValue<std::string>(entry.path() / "name").value_or("") != "amd_energy") continue;
+
+        for (const auto &sensor : fs::directory_iterator(entry.path(), ec))
+        {
+            const std::string file = sensor.path().filename().string();
+            if (not startsWith(file, "energy") || file.find("_label") == std::string::npos) continue;
+            if (not startsWith(readValue<std::string>(sensor.path()).value_or(""), "Esocket")) continue;
+
+            const fs::path energyFile = entry.path() / (file.substr(0, file.find("_label")) + "_input");
+            if (not readValue<uint64_t>(energyFile))
+            {
+                m_reason = "cannot read " + energyFile.string();
+                continue;
+            }
+            m_zones.push_back({Domain::Package, energyFile, 0, 0});
+        }
+    }
+}
+
+void EnergyMeter::start()
+{
+    for (auto &zone : m_zones)
+    {
+        zone.startValue = readValue<uint64_t>(zone.energyFile).value_or(0);
+    }
+}
+
+EnergyValues EnergyMeter::stop()
+{
+    EnergyValues result;
+    for (const auto &zone : m_zones)
+    {
+        const auto end = readValue<uint64_t>(zone.energyFile);
+        if (not end) continue;
+
+        const size_t index = static_cast<size_t>(zone.domain);
+        result.joules[index] += static_cast<double>(counterDelta(zone.startValue, *end, zone.maxRange)) * 1e-6;
+        result.valid[index] = true;
+    }
+    return result;
+}
+
+boost::json::object toJson(const EnergyValues &totals, uint32_t iterations, double seconds, double flopsPerIteration)
+{
+    boost::json::object obj;
+    double joules = 0.0;
+    bool anyValid = false;
+    for (size_t i = 0; i < DOMAIN_COUNT; ++i)
+    {
+        if (not totals.valid[i]) continue;
+        anyValid = true;
+        joules += totals.joules[i];
+        obj[std::string(domainName(static_cast<Domain>(i))) + "_joules"] = totals.joules[i];
+    }
+    obj["available"] = anyValid;
+    obj["iterations"] = iterations;
+    if (not anyValid || iterations == 0) return obj;
+
+    obj["joules"] = joules;
+    obj["joules_per_iteration"] = joules / iterations;
+    if (seconds > 0.0) obj["average_watts"] = joules / seconds;
+    if (flopsPerIteration > 0.0 && joules > 0.0)
+    {
+        obj["gflops_per_watt"] = flopsPerIteration * iterations * 1e-9 / joules;
+    }
+    return obj;
+}
+
+} // namespace energy
@@ -0,0 +1,65 @@
+#include "kernel_registry.hpp"
+
+#include "embedded_kernel_sources.hpp"
+
+namespace oclUtil
+{
+
+KernelRegistry &KernelRegistry::instance()
+{
+    static KernelRegistry registry;
+    return registry;
+}
+
+std::optional<std::string_view> KernelRegistry::source(std::string_view kernelFilename) const
+{
+    for (const auto &kernel : embeddedKernels::all)
+    {
+        if (kernel.name == kernelFilename)
+        {
+            return std::string_view(reinterpret_cast<const char *>(kernel.data), kernel.size);
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string_view> KernelRegistry::sourceNames() const
+{
+    std::vector<std::string_view> names;
+    for (const auto &kernel : embeddedKernels::all)
+    {
+        names.push_back(kernel.name);
+    }
+    return names;
+}
+
+void KernelRegistry::registerBinary(std::string_view kernelFilename, std::string_view deviceKey, std::string_view options, 
+                                    const unsigned char *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_binaries[BinaryKey{kernelFilename, deviceKey, options}] = KernelBinary(data, data + size);
+}
+
+std::optional<KernelBinary> KernelRegistry::binary(std::string_view kernelFilename, std::string_view deviceKey, std::string_view options) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_binaries.find(BinaryKey{kernelFilename, deviceKey, options});
+    if (it == m_binaries.end()) return std::nullopt;
+    return it->second;
+}
+
+void KernelRegistry::registerIl(std::string_view kernelFilename, std::string_view options, const unsigned char *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ils[IlKey{kernelFilename, options}] = KernelBinary(data, data + size);
+}
+
+std::optional<KernelBinary> KernelRegistry::il(std::string_view kernelFilename, std::string_view options) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ils.find(IlKey{kernelFilename, options});
+    if (it == m_ils.end()) return std::nullopt;
+    return it->second;
+}
+
+} // namespace oclUtil
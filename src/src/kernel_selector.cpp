@@ -0,0 +1,273 @@
+#include "kernel_selector.hpp"
+#include "matrix_benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+
+namespace kernelSelector
+{
+
+namespace
+{
+
+// Naive is not measured at larger orders once it is this much slower than the best backend.
+constexpr double NAIVE_DROP_FACTOR = 4.0;
+
+volatile double resultSink = 0.0;
+
+template<typename T, int Order>
+double timeChoice(const Choice &choice, uint32_t repeats)
+{
+    using Mat = Matrix<T, Order, Order>;
+    Mat a;
+    Mat b;
+    a.randomFill(1u);
+    b.randomFill(2u);
+
+    double best = std::numeric_limits<double>::infinity();
+    // The first run warms up caches, thread creation and program builds and is not counted.
+    for (uint32_t i = 0; i <= repeats; ++i)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        Mat c = [&]()
+        {
+            switch (choice.type)
+            {
+                case MatMultType::Simd: return MatrixMultImpl<MatMultType::Simd, Mat, Mat>::multiply(a, b);
+                case MatMultType::MultithreadSimd:
+                    return MatrixMultImpl<MatMultType::MultithreadSimd, Mat, Mat>::multiply(a, b, static_cast<int>(choice.threads));
+                case MatMultType::TiledOcl: return MatrixMultImpl<MatMultType::TiledOcl, Mat, Mat>::multiply(a, b);
+                default: return MatrixMultImpl<MatMultType::Naive, Mat, Mat>::multiply(a, b);
+            }
+        }();
+        const double elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+        resultSink = resultSink + static_cast<double>(c[0]);
+        if (i > 0) best = std::min(best, elapsed);
+    }
+    return best;
+}
+
+bool deviceAvailable()
+{
+    try
+    {
+        oclUtil::selectDevice(oclUtil::defaultDeviceSelector());
+        return true;
+    } catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+// Empty when every candidate failed, so the order is left to the neighbouring crossovers.
+template<typename T, int Order>
+std::optional<Crossover> calibrateOrder(bool &naiveCompetitive, bool withDevice, uint32_t repeats, boost::json::array &report)
+{
+    std::vector<Choice> candidates;
+    if (naiveCompetitive) candidates.push_back({MatMultType::Naive, 0});
+    candidates.push_back({MatMultType::Simd, 0});
+    for (uint32_t threads : Benchmarks::scalingSteps(std::max(1u, std::thread::hardware_concurrency())))
+    {
+        if (threads > 1) candidates.push_back({MatMultType::MultithreadSimd, threads});
+    }
+    if (withDevice) candidates.push_back({MatMultType::TiledOcl, 0});
+
+    std::optional<Crossover> best;
+    double naiveSeconds = std::numeric_limits<double>::infinity();
+    for (const Choice &choice : candidates)
+    {
+        boost::json::object item;
+        item["data_type"] = oclUtil::getOpenCLTypeName<T>();
+        item["order"] = Order;
+        item["kernel"] = choice.description();
+        try
+        {
+            const double seconds = timeChoice<T, Order>(choice, repeats);
+            item["seconds"] = seconds;
+            if (choice.type == MatMultType::Naive) naiveSeconds = seconds;
+            if (not best || seconds < best->seconds) best = Crossover{Order, choice, seconds};
+        } catch (const std::exception &e)
+        {
+            item["error"] = e.what();
+        }
+        report.emplace_back(item);
+    }
+
+    if (best) naiveCompetitive = naiveCompetitive && naiveSeconds < NAIVE_DROP_FACTOR * best->seconds;
+    return best;
+}
+
+template<typename T, size_t... OrderIndices>
+std::vector<Crossover> calibrateType(const std::vector<int> &orders, uint32_t repeats, boost::json::array &report, 
+                                     std::index_sequence<OrderIndices...>)
+{
+    const bool withDevice = deviceAvailable();
+    bool naiveCompetitive = true;
+    std::vector<Crossover> crossovers;
+    for (int order : orders)
+    {
+        std::optional<Crossover> crossover;
+        const bool dispatched = ((order == Benchmarks::MatMultOrders[OrderIndices] 
+                                  && (crossover = calibrateOrder<T, Benchmarks::MatMultOrders[OrderIndices]>(
+                                          naiveCompetitive, withDevice, repeats, report), true)) || ...);
+        if (not dispatched) throw std::runtime_error("Unsupported mat mult order\n");
+
+        if (crossover) crossovers.push_back(*crossover);
+        else std::cerr << "Skipping order " << order << ": every kernel failed\n";
+    }
+    return crossovers;
+}
+
+template<typename T>
+void calibrateAndStore(CrossoverTable &table, const std::vector<int> &orders, uint32_t repeats, boost::json::array &report)
+{
+    table.store(oclUtil::getOpenCLTypeName<T>(), 
+                calibrateType<T>(orders, repeats, report, std::make_index_sequence<Benchmarks::MatMultOrders.size()>{}));
+}
+
+} // namespace
+
+CrossoverTable &CrossoverTable::instance()
+{
+    static CrossoverTable table(constants::AUTO_CALIBRATION_PATH);
+    static std::once_flag loaded;
+    std::call_once(loaded, []() { table.load(); });
+    return table;
+}
+
+std::optional<Choice> CrossoverTable::lookup(std::string_view dataType, int order) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(dataType);
+    if (it == m_entries.end() || it->second.empty()) return std::nullopt;
+
+    const auto &crossovers = it->second;
+    auto next = std::ranges::upper_bound(crossovers, order, {}, &Crossover::order);
+    return next == crossovers.begin() ? crossovers.front().choice : std::prev(next)->choice;
+}
+
+void CrossoverTable::store(std::string_view dataType, std::vector<Crossover> crossovers)
+{
+    std::ranges::sort(crossovers, {}, &Crossover::order);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[std::string(dataType)] = std::move(crossovers);
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void CrossoverTable::load()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_generation.fetch_add(1, std::memory_order_release);
+
+    std::ifstream file(m_path);
+    if (not file) return;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+
+    try
+    {
+        const boost::json::value root = boost::json::parse(ss.str());
+        for (const auto &item : root.at("entries").as_object())
+        {
+            std::vector<Crossover> crossovers;
+            for (const auto &value : item.value().as_array())
+            {
+                const auto &obj = value.as_object();
+                Crossover crossover;
+                crossover.order = obj.at("order").to_number<int>();
+                crossover.choice.type = util::fromString<MatMultType>(obj.at("kernel").as_string());
+                crossover.choice.threads = obj.at("threads").to_number<uint32_t>();
+                crossover.seconds = obj.at("seconds").to_number<double>();
+                if (not isSelectable(crossover.choice.type))
+                {
+                    throw std::runtime_error("kernel " + std::string(obj.at("kernel").as_string()) + " cannot be selected by Auto");
+                }
+                const bool multithreaded = crossover.choice.type == MatMultType::MultithreadSimd;
+                if (multithreaded ? crossover.choice.threads < 1 : crossover.choice.threads != 0)
+                {
+                    throw std::runtime_error(std::format("kernel {} cannot run with threads {}",
+                                                         util::toString(crossover.choice.type), crossover.choice.threads));
+                }
+                crossovers.push_back(crossover);
+            }
+            std::ranges::sort(crossovers, {}, &Crossover::order);
+            m_entries[std::string(item.key())] = std::move(crossovers);
+        }
+    } catch (const std::exception &e)
+    {
+        std::cerr << "Ignoring malformed calibration " << m_path << ": " << e.what() << '\n';
+        m_entries.clear();
+    }
+}
+
+void CrossoverTable::save() const
+{
+    boost::json::object entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[dataType, crossovers] : m_entries)
+        {
+            boost::json::array items;
+            for (const auto &crossover : crossovers)
+            {
+                boost::json::object obj;
+                obj["order"] = crossover.order;
+                obj["kernel"] = util::toString(crossover.choice.type);
+                obj["threads"] = crossover.choice.threads;
+                obj["seconds"] = crossover.seconds;
+                items.emplace_back(obj);
+            }
+            entries[dataType] = items;
+        }
+    }
+
+    boost::json::object root;
+    root["version"] = 1;
+    root["hardware_threads"] = std::thread::hardware_concurrency();
+    root["entries"] = entries;
+
+    std::ofstream file(m_path);
+    if (not file) throw std::runtime_error("Failed to open calibration file " + m_path.string());
+    util::prettyPrint(file, root);
+}
+
+Choice heuristicChoice(int order, uint32_t hardwareThreads)
+{
+    if (order < 16) return {MatMultType::Naive, 0};
+
+    const uint32_t threads = std::min(std::max(1u, hardwareThreads), static_cast<uint32_t>(order / 64));
+    if (threads <= 1) return {MatMultType::Simd, 0};
+    return {MatMultType::MultithreadSimd, threads};
+}
+
+boost::json::array calibrate(CrossoverTable &table, const std::vector<int> &orders,
+                             const std::vector<MatMultDataType> &dataTypes, uint32_t repeats)
+{
+    std::vector<int> sortedOrders = orders;
+    std::ranges::sort(sortedOrders);
+
+    boost::json::array report;
+    for (MatMultDataType dataType : dataTypes)
+    {
+        switch (dataType)
+        {
+            case MatMultDataType::Int32: calibrateAndStore<int32_t>(table, sortedOrders, repeats, report); break;
+            case MatMultDataType::Uint32: calibrateAndStore<uint32_t>(table, sortedOrders, repeats, report); break;
+            case MatMultDataType::Float: calibrateAndStore<float>(table, sortedOrders, repeats, report); break;
+            case MatMultDataType::Double: calibrateAndStore<double>(table, sortedOrders, repeats, report); break;
+            default: throw std::runtime_error("Unsupported mat mult data type\n");
+        }
+    }
+    table.save();
+    return report;
+}
+
+} // namespace kernelSelector
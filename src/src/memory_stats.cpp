@@ -0,0 +1,206 @@
+#include "memory_stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#if defined(TRACK_ALLOCATIONS) && defined(__GLIBC__)
+#include <malloc.h>
+#define MEMORY_STATS_HOOKS 1
+#endif
+
+namespace memory
+{
+
+namespace
+{
+
+std::atomic<bool> regionOpen{false};
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> deallocations{0};
+std::atomic<uint64_t> bytesAllocated{0};
+std::atomic<int64_t> liveBytes{0};
+std::atomic<int64_t> peakLiveBytes{0};
+
+[[maybe_unused]] void recordAllocation(size_t bytes)
+{
+    if (not regionOpen.load(std::memory_order_relaxed)) return;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+    const int64_t live = liveBytes.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+    int64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && not peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+[[maybe_unused]] void recordDeallocation(size_t bytes)
+{
+    if (not regionOpen.load(std::memory_order_relaxed)) return;
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    liveBytes.fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+}
+
+uint64_t statusValueBytes(const std::string &status, const std::string &key)
+{
+    std::istringstream lines(status);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        if (line.rfind(key + ":", 0) != 0) continue;
+        std::istringstream fields(line.substr(key.size() + 1));
+        uint64_t kilobytes = 0;
+        fields >> kilobytes;
+        return kilobytes * 1024;
+    }
+    return 0;
+}
+
+} // namespace
+
+bool allocationTrackingEnabled()
+{
+#ifdef MEMORY_STATS_HOOKS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void beginRegion()
+{
+    allocations = 0;
+    deallocations = 0;
+    bytesAllocated = 0;
+    liveBytes = 0;
+    peakLiveBytes = 0;
+    regionOpen.store(true, std::memory_order_release);
+}
+
+AllocationStats endRegion()
+{
+    regionOpen.store(false, std::memory_order_release);
+    AllocationStats stats;
+    stats.allocations = allocations.load();
+    stats.deallocations = deallocations.load();
+    stats.bytesAllocated = bytesAllocated.load();
+    stats.peakLiveBytes = static_cast<uint64_t>(std::max<int64_t>(0, peakLiveBytes.load()));
+    return stats;
+}
+
+ProcessMemory processMemory()
+{
+    ProcessMemory process;
+#ifdef __linux__
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) process.maxRssBytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+
+    std::ifstream file("/proc/self/status");
+    std::stringstream status;
+    status << file.rdbuf();
+    process.highWaterMarkBytes = statusValueBytes(status.str(), "VmHWM");
+    process.residentBytes = statusValueBytes(status.str(), "VmRSS");
+#endif
+    return process;
+}
+
+bool resetPeakResidentSet()
+{
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+#else
+    return false;
+#endif
+}
+
+boost::json::object toJson(const AllocationStats &totals, uint32_t iterations, const ProcessMemory &process, 
+                           bool peakWasReset)
+{
+    boost::json::object obj;
+    obj["allocation_tracking"] = allocationTrackingEnabled();
+    if (allocationTrackingEnabled() && iterations > 0)
+    {
+        obj["allocations"] = totals.allocations;
+        obj["deallocations"] = totals.deallocations;
+        obj["bytes_allocated"] = totals.bytesAllocated;
+        obj["allocations_per_iteration"] = static_cast<double>(totals.allocations) / iterations;
+        obj["bytes_per_iteration"] = static_cast<double>(totals.bytesAllocated) / iterations;
+        obj["peak_live_bytes"] = totals.peakLiveBytes;
+    }
+    if (process.maxRssBytes) obj["max_rss_bytes"] = process.maxRssBytes;
+    if (process.highWaterMarkBytes)
+    {
+        obj["peak_rss_bytes"] = process.highWaterMarkBytes;
+        obj["peak_rss_scope"] = peakWasReset ? "benchmark" : "process";
+    }
+    if (process.residentBytes) obj["rss_bytes"] = process.residentBytes;
+    return obj;
+}
+
+} // namespace memory
+
+#ifdef MEMORY_STATS_HOOKS
+
+namespace
+{
+
+void *trackedAllocate(size_t size)
+{
+    void *ptr = std::malloc(size ? size : 1);
+    if (not ptr) throw std::bad_alloc();
+    memory::recordAllocation(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void *trackedAllocateAligned(size_t size, std::align_val_t alignment)
+{
+    const size_t align = static_cast<size_t>(alignment);
+    void *ptr = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+    if (not ptr) throw std::bad_alloc();
+    memory::recordAllocation(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void trackedFree(void *ptr) noexcept
+{
+    if (not ptr) return;
+    memory::recordDeallocation(malloc_usable_size(ptr));
+    std::free(ptr);
+}
+
+} // namespace
+
+void *operator new(size_t size) { return trackedAllocate(size); }
+void *operator new[](size_t size) { return trackedAllocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return trackedAllocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return trackedAllocateAligned(size, alignment); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    try { return trackedAllocate(size); } catch (...) { return nullptr; }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    try { return trackedAllocate(size); } catch (...) { return nullptr; }
+}
+
+void operator delete(void *ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+
+#endif
@@ -0,0 +1,149 @@
+#include "ocl_tuner.hpp"
+
+#include <fstream>
+#include <sstream>
+
+namespace oclTuner
+{
+
+std::string toString(ShapeClass shapeClass)
+{
+    switch (shapeClass)
+    {
+        case ShapeClass::Small:
+            return "small";
+        case ShapeClass::Medium:
+            return "medium";
+        case ShapeClass::Large:
+            return "large";
+        default:
+            return "unknown";
+    }
+}
+
+TuningDatabase &TuningDatabase::instance()
+{
+    static TuningDatabase database(constants::OCL_TUNING_DB_PATH);
+    static std::once_flag loaded;
+    std::call_once(loaded, []() { database.load(); });
+    return database;
+}
+
+std::string TuningDatabase::makeKey(std::string_view device, std::string_view dataType, ShapeClass shapeClass)
+{
+    return std::format("{}|{}|{}", device, dataType, toString(shapeClass));
+}
+
+std::optional<TuningEntry> TuningDatabase::lookup(std::string_view device, std::string_view dataType, ShapeClass shapeClass) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(makeKey(device, dataType, shapeClass));
+    if (it == m_entries.end()) return std::nullopt;
+    return it->second;
+}
+
+void TuningDatabase::store(std::string_view device, std::string_view dataType, ShapeClass shapeClass, const TuningEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[makeKey(device, dataType, shapeClass)] = entry;
+}
+
+void TuningDatabase::load()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+
+    std::ifstream file(m_path);
+    if (not file) return;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+
+    try
+    {
+        const boost::json::value root = boost::json::parse(ss.str());
+        for (const auto &item : root.at("entries").as_object())
+        {
+            const auto &obj = item.value().as_object();
+            TuningEntry entry;
+            entry.config.tileSize = obj.at("tile_size").to_number<uint32_t>();
+            entry.config.workPerThread = obj.at("work_per_thread").to_number<uint32_t>();
+            entry.kernelSeconds = obj.at("kernel_seconds").to_number<double>();
+            m_entries[std::string(item.key())] = entry;
+        }
+    } catch (const std::exception &e)
+    {
+        std::cerr << "Ignoring malformed tuning database " << m_path << ": " << e.what() << '\n';
+        m_entries.clear();
+    }
+}
+
+void TuningDatabase::save() const
+{
+    boost::json::object entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[key, entry] : m_entries)
+        {
+            boost::json::object obj;
+            obj["tile_size"] = entry.config.tileSize;
+            obj["work_per_thread"] = entry.config.workPerThread;
+            obj["kernel_seconds"] = entry.kernelSeconds;
+            entries[key] = obj;
+        }
+    }
+
+    boost::json::object root;
+    root["version"] = 1;
+    root["entries"] = entries;
+
+    std::ofstream file(m_path);
+    if (not file) throw std::runtime_error("Failed to open tuning database " + m_path.string());
+    util::prettyPrint(file, root);
+}
+
+template<typename T>
+static void autotuneType(const oclUtil::DeviceInfo &device, TuningDatabase &database, boost::json::array &report)
+{
+    for (ShapeClass shapeClass : {ShapeClass::Small, ShapeClass::Medium, ShapeClass::Large})
+    {
+        const int order = representativeOrder(shapeClass);
+
+        boost::json::object output;
+        output["device"] = device.description();
+        output["data_type"] = oclUtil::getOpenCLTypeName<T>();
+        output["shape_class"] = toString(shapeClass);
+        output["order"] = order;
+
+        try
+        {
+            const TuningResult result = TiledKernelTuner<T>(device, order).run();
+            database.store(oclUtil::deviceKey(device.device), oclUtil::getOpenCLTypeName<T>(), shapeClass, 
+                           TuningEntry{result.config, result.kernelSeconds});
+
+            output["tile_size"] = result.config.tileSize;
+            output["work_per_thread"] = result.config.workPerThread;
+            output["kernel_seconds"] = result.kernelSeconds;
+            output["variants_measured"] = result.variantsMeasured;
+            output["variants_pruned"] = result.variantsPruned;
+            output["variants_failed"] = result.variantsFailed;
+        } catch (const std::runtime_error &e)
+        {
+            output["error"] = e.what();
+        }
+        report.emplace_back(output);
+    }
+}
+
+boost::json::array autotuneDevice(const oclUtil::DeviceInfo &device, TuningDatabase &database)
+{
+    boost::json::array report;
+    autotuneType<int32_t>(device, database, report);
+    autotuneType<uint32_t>(device, database, report);
+    autotuneType<float>(device, database, report);
+    autotuneType<double>(device, database, report);
+    database.save();
+    return report;
+}
+
+} // namespace oclTuner
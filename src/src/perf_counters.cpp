@@ -0,0 +1,296 @@
+#include "perf_counters.hpp"
+
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <set>
+#endif
+
+namespace perf
+{
+
+const char *counterName(Counter counter)
+{
+    switch (counter)
+    {
+        case Counter::Cycles: return "cycles";
+        case Counter::Instructions: return "instructions";
+        case Counter::L1dMisses: return "l1d_misses";
+        case Counter::LlcMisses: return "llc_misses";
+        case Counter::DtlbMisses: return "dtlb_misses";
+        case Counter::BranchMisses: return "branch_misses";
+        default: return "unknown";
+    }
+}
+
+namespace
+{
+
+std::atomic<uint64_t> unattachedPoolWork{0};
+
+} // namespace
+
+void noteUnattachedPoolWork()
+{
+    unattachedPoolWork.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __linux__
+
+namespace
+{
+
+constexpr uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+perf_event_attr counterAttributes(Counter counter)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter)
+    {
+        case Counter::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case Counter::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case Counter::L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case Counter::LlcMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case Counter::DtlbMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case Counter::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            break;
+    }
+    return attr;
+}
+
+struct PooledThreads
+{
+    std::mutex mutex;
+    std::set<pid_t> tids;
+};
+
+// Never destroyed, pooled threads held by other statics unregister during static destruction.
+PooledThreads &pooledThreads()
+{
+    static auto *threads = new PooledThreads;
+    return *threads;
+}
+
+pid_t currentTid()
+{
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+struct PooledRegistration
+{
+    PooledRegistration() : tid(currentTid())
+    {
+        auto &threads = pooledThreads();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        threads.tids.insert(tid);
+    }
+
+    ~PooledRegistration()
+    {
+        auto &threads = pooledThreads();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        threads.tids.erase(tid);
+    }
+
+    const pid_t tid;
+};
+
+// Opens every counter for tid (0 for the calling thread), refused ones stay -1. Returns the first error.
+int openCounters(pid_t tid, std::array<int, COUNTER_COUNT> &fds)
+{
+    int error = 0;
+    fds.fill(-1);
+    for (size_t i = 0; i < COUNTER_COUNT; ++i)
+    {
+        perf_event_attr attr = counterAttributes(static_cast<Counter>(i));
+        const long fd = syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd < 0)
+        {
+            if (error == 0) error = errno;
+            continue;
+        }
+        fds[i] = static_cast<int>(fd);
+    }
+    return error;
+}
+
+} // namespace
+
+void registerPooledThread()
+{
+    static thread_local PooledRegistration registration;
+    (void)registration;
+}
+
+PerfCounterGroup::PerfCounterGroup()
+{
+    ThreadFds own;
+    if (const int error = openCounters(0, own); error != 0)
+    {
+        m_reason = std::string("perf_event_open failed: ") + std::strerror(error);
+    }
+    for (int fd : own) m_available = m_available || fd >= 0;
+    m_fds.push_back(own);
+    if (not m_available) return;
+    m_reason.clear();
+
+    // Threads spawned from here on are inherited through the calling thread's counters, only the ones that
+    // already exist are attached. Those that exit in between are simply gone.
+    std::set<pid_t> tids;
+    {
+        auto &threads = pooledThreads();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        tids = threads.tids;
+    }
+    tids.erase(currentTid());
+    for (pid_t tid : tids)
+    {
+        ThreadFds pooled;
+        const int error = openCounters(tid, pooled);
+        if (error == ESRCH) continue;
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            m_partial = m_partial || (own[i] >= 0 && pooled[i] < 0);
+        }
+        m_fds.push_back(pooled);
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+    for (const auto &fds : m_fds)
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0) close(fd);
+        }
+    }
+}
+
+void PerfCounterGroup::start()
+{
+    m_unattachedAtStart = unattachedPoolWork.load(std::memory_order_relaxed);
+    for (const auto &fds : m_fds)
+    {
+        for (int fd : fds)
+        {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+CounterValues PerfCounterGroup::stop()
+{
+    for (const auto &fds : m_fds)
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    CounterValues result;
+    result.partial = m_partial || unattachedPoolWork.load(std::memory_order_relaxed) != m_unattachedAtStart;
+    for (const auto &fds : m_fds)
+    {
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            if (fds[i] < 0 || m_fds[0][i] < 0) continue;
+
+            uint64_t data[3] = {0, 0, 0};
+            if (read(fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) continue;
+
+            const double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            result.values[i] += static_cast<uint64_t>(static_cast<double>(data[0]) * scale);
+            result.valid[i] = true;
+        }
+    }
+    return result;
+}
+
+#else
+
+void registerPooledThread() {}
+
+PerfCounterGroup::PerfCounterGroup() : m_reason("hardware counters need perf_event_open (Linux only)") {}
+
+PerfCounterGroup::~PerfCounterGroup() = default;
+
+void PerfCounterGroup::start() {}
+
+CounterValues PerfCounterGroup::stop() { return {}; }
+
+#endif
+
+boost::json::object toJson(const CounterValues &totals, uint32_t iterations, double flopsPerIteration)
+{
+    boost::json::object obj;
+    bool anyValid = false;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i)
+    {
+        if (not totals.valid[i]) continue;
+        anyValid = true;
+        obj[counterName(static_cast<Counter>(i))] = totals.values[i];
+    }
+    obj["available"] = anyValid;
+    if (anyValid && totals.partial) obj["partial"] = true;
+    obj["iterations"] = iterations;
+    if (not anyValid || iterations == 0) return obj;
+
+    if (totals.has(Counter::Cycles) && totals.has(Counter::Instructions) && totals[Counter::Cycles] > 0)
+    {
+        obj["ipc"] = static_cast<double>(totals[Counter::Instructions]) / static_cast<double>(totals[Counter::Cycles]);
+    }
+
+    const double kiloFlops = flopsPerIteration * iterations * 1e-3;
+    if (kiloFlops <= 0.0) return obj;
+
+    for (Counter counter : {Counter::L1dMisses, Counter::LlcMisses, Counter::DtlbMisses, Counter::BranchMisses})
+    {
+        if (not totals.has(counter)) continue;
+        obj[std::string(counterName(counter)) + "_per_kflop"] = static_cast<double>(totals[counter]) / kiloFlops;
+    }
+    return obj;
+}
+
+} // namespace perf
@@ -0,0 +1,292 @@
+#include "results_store.hpp"
+#include "benchmark_stats.hpp"
+
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+#ifndef BUILD_GIT_REVISION
+#define BUILD_GIT_REVISION "unknown"
+#endif
+#ifndef BUILD_COMPILER
+#define BUILD_COMPILER "unknown"
+#endif
+#ifndef BUILD_CXX_FLAGS
+#define BUILD_CXX_FLAGS ""
+#endif
+#ifndef BUILD_TYPE
+#define BUILD_TYPE ""
+#endif
+
+namespace Benchmarks
+{
+
+namespace
+{
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t fnv1a(uint64_t hash, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+std::string readCpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line))
+    {
+        if (line.rfind("model name", 0) != 0) continue;
+        const auto colon = line.find(':');
+        if (colon == std::string::npos) break;
+        return line.substr(line.find_first_not_of(" \t", colon + 1));
+    }
+    return "unknown";
+}
+
+std::vector<std::string> detectIsa()
+{
+    std::vector<std::string> isa;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) isa.push_back("sse4.2");
+    if (__builtin_cpu_supports("avx")) isa.push_back("avx");
+    if (__builtin_cpu_supports("avx2")) isa.push_back("avx2");
+    if (__builtin_cpu_supports("fma")) isa.push_back("fma");
+    if (__builtin_cpu_supports("avx512f")) isa.push_back("avx512f");
+#endif
+    return isa;
+}
+
+std::string makeRunId()
+{
+    const std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", std::gmtime(&now));
+    std::random_device random;
+    return std::format("{}-{:08x}", stamp, random());
+}
+
+std::string timestamp()
+{
+    const std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return stamp;
+}
+
+bool startsWith(std::string_view str, std::string_view prefix)
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+std::string stringField(const boost::json::object &obj, std::string_view key)
+{
+    const auto *value = obj.if_contains(key);
+    return value && value->is_string() ? std::string(value->as_string()) : std::string();
+}
+
+double numberField(const boost::json::object &obj, std::string_view key)
+{
+    const auto *value = obj.if_contains(key);
+    return value && value->is_number() ? value->to_number<double>() : 0.0;
+}
+
+} // namespace
+
+std::string fnv1aHex(std::string_view data)
+{
+    return std::format("{:016x}", fnv1a(FNV_OFFSET, data.data(), data.size()));
+}
+
+std::string HostInfo::fingerprint() const
+{
+    return fnv1aHex(std::format("{}|{}|{}|{}", hostname, cpuModel, os, hardwareThreads));
+}
+
+boost::json::object HostInfo::toJson() const
+{
+    boost::json::object obj;
+    obj["hostname"] = hostname;
+    obj["cpu_model"] = cpuModel;
+    obj["os"] = os;
+    obj["hardware_threads"] = hardwareThreads;
+    obj["fingerprint"] = fingerprint();
+    return obj;
+}
+
+const HostInfo &hostInfo()
+{
+    static const HostInfo info = []()
+    {
+        HostInfo host;
+        host.hardwareThreads = std::thread::hardware_concurrency();
+        host.cpuModel = readCpuModel();
+        host.isa = detectIsa();
+#ifdef __linux__
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) == 0) host.hostname = name;
+
+        utsname uts;
+        if (uname(&uts) == 0) host.os = std::format("{} {} {}", uts.sysname, uts.release, uts.machine);
+#else
+        if (const char *name = std::getenv("COMPUTERNAME")) host.hostname = name;
+        host.os = "windows";
+#endif
+        return host;
+    }();
+    return info;
+}
+
+boost::json::object buildInfo()
+{
+    boost::json::object obj;
+    obj["git_revision"] = BUILD_GIT_REVISION;
+    obj["compiler"] = BUILD_COMPILER;
+    obj["cxx_flags"] = BUILD_CXX_FLAGS;
+    obj["build_type"] = BUILD_TYPE;
+    obj["binary_hash"] = binaryHash();
+    return obj;
+}
+
+const std::string &binaryHash()
+{
+    static const std::string hash = []()
+    {
+        std::ifstream binary("/proc/self/exe", std::ios::binary);
+        if (not binary) return fnv1aHex(std::string(BUILD_GIT_REVISION) + BUILD_COMPILER + BUILD_CXX_FLAGS + BUILD_TYPE);
+
+        uint64_t value = FNV_OFFSET;
+        std::array<char, 1 << 16> buffer;
+        while (binary.read(buffer.data(), buffer.size()) || binary.gcount() > 0)
+        {
+            value = fnv1a(value, buffer.data(), static_cast<size_t>(binary.gcount()));
+        }
+        return std::format("{:016x}", value);
+    }();
+    return hash;
+}
+
+RegressionCheck compareRecords(const boost::json::object &baseline, const boost::json::object &current,
+                               double threshold, double alpha)
+{
+    RegressionCheck check;
+    check.name = stringField(current, "name");
+    check.baselineRunId = stringField(baseline, "run_id");
+    check.baselineMean = numberField(baseline, "avg_execution_time_seconds");
+    check.currentMean = numberField(current, "avg_execution_time_seconds");
+    if (check.baselineMean <= 0.0) return check;
+
+    check.change = check.currentMean / check.baselineMean - 1.0;
+    check.pValue = welchTTest(check.baselineMean, numberField(baseline, "stddev_execution_time_seconds"),
+                              static_cast<size_t>(numberField(baseline, "times_executed")),
+                              check.currentMean, numberField(current, "stddev_execution_time_seconds"),
+                              static_cast<size_t>(numberField(current, "times_executed"))).pValue;
+    check.regression = check.change > threshold && check.pValue < alpha;
+    return check;
+}
+
+ResultsStore::ResultsStore(std::filesystem::path directory)
+    : m_path(std::move(directory) / (hostInfo().fingerprint() + ".ndjson"))
+    , m_runId(makeRunId())
+{
+}
+
+void ResultsStore::load()
+{
+    m_records.clear();
+
+    std::ifstream file(m_path);
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        if (line.empty()) continue;
+        try
+        {
+            m_records.push_back(boost::json::parse(line).as_object());
+        } catch (const std::exception &e)
+        {
+            std::cerr << "Ignoring malformed record " << m_path << ":" << lineNumber << ": " << e.what() << '\n';
+        }
+    }
+}
+
+void ResultsStore::append(boost::json::object record, const boost::json::object &config, const std::string &configHash)
+{
+    record["run_id"] = m_runId;
+    record["timestamp"] = timestamp();
+    record["host"] = hostInfo().toJson();
+    record["build"] = buildInfo();
+
+    boost::json::array isa;
+    for (const auto &feature : hostInfo().isa) isa.push_back(boost::json::value(feature));
+    record["isa"] = isa;
+
+    record["config"] = config;
+    record["config_hash"] = configHash;
+
+    std::filesystem::create_directories(m_path.parent_path());
+    std::ofstream file(m_path, std::ios::app);
+    if (not file) throw std::runtime_error("Failed to open results store " + m_path.string());
+    file << boost::json::serialize(record) << '\n';
+
+    m_records.push_back(std::move(record));
+}
+
+std::optional<boost::json::object> ResultsStore::unchanged(const std::string &configHash) const
+{
+    for (auto it = m_records.rbegin(); it != m_records.rend(); ++it)
+    {
+        if (stringField(*it, "config_hash") != configHash || stringField(*it, "run_id") == m_runId) continue;
+        if (verification::failed(*it)) continue;
+
+        const auto *build = it->if_contains("build");
+        if (build && build->is_object() && stringField(build->as_object(), "binary_hash") == binaryHash()
+            && numberField(*it, "times_executed") > 0)
+        {
+            return *it;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<boost::json::object> ResultsStore::baseline(const std::string &configHash, std::string_view selector,
+                                                          std::string_view excludeRunId) const
+{
+    const bool latest = selector.empty() || selector == "latest";
+    for (auto it = m_records.rbegin(); it != m_records.rend(); ++it)
+    {
+        const std::string runId = stringField(*it, "run_id");
+        if (stringField(*it, "config_hash") != configHash || runId == m_runId || runId == excludeRunId) continue;
+        if (verification::failed(*it)) continue;
+        if (latest) return *it;
+
+        const auto *build = it->if_contains("build");
+        const std::string revision = build && build->is_object() ? stringField(build->as_object(), "git_revision") : "";
+        if (startsWith(runId, selector) || (not revision.empty() && startsWith(revision, selector)))
+        {
+            return *it;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,69 @@
+#include "roofline.hpp"
+
+namespace roofline
+{
+
+BandwidthPeaks measureBandwidthPeaks()
+{
+    constexpr size_t elements = size_t{1} << 23;
+    constexpr double scalar = 3.0;
+    std::vector<double> a(elements, 0.0);
+    std::vector<double> b(elements, 1.0);
+    std::vector<double> c(elements, 2.0);
+
+    auto triad = [&](uint32_t tid, uint32_t threadCount)
+    {
+        const size_t begin = elements * tid / threadCount;
+        const size_t end = elements * (tid + 1) / threadCount;
+        for (size_t i = begin; i < end; ++i)
+        {
+            a[i] = b[i] + scalar * c[i];
+        }
+        return 3.0 * sizeof(double) * static_cast<double>(end - begin);
+    };
+
+    const uint32_t cores = hostCoreCount();
+    BandwidthPeaks peaks;
+    peaks.singleCoreGBs = bestRate(1, 5, [&](uint32_t tid) { return triad(tid, 1); }) * 1e-9;
+    peaks.allCoresGBs = bestRate(cores, 5, [&](uint32_t tid) { return triad(tid, cores); }) * 1e-9;
+
+    resultSink = a[elements / 2];
+
+    return peaks;
+}
+
+const BandwidthPeaks &bandwidthPeaks()
+{
+    static const BandwidthPeaks peaks = measureBandwidthPeaks();
+    return peaks;
+}
+
+boost::json::object measureMachinePeaks()
+{
+    auto computeJson = [](const ComputePeaks &peaks)
+    {
+        boost::json::object obj;
+        obj["single_core_gflops"] = peaks.singleCoreGflops;
+        obj["all_cores_gflops"] = peaks.allCoresGflops;
+        return obj;
+    };
+
+    boost::json::object compute;
+    compute["int32"] = computeJson(computePeaks<int32_t>());
+    compute["uint32"] = computeJson(computePeaks<uint32_t>());
+    compute["float"] = computeJson(computePeaks<float>());
+    compute["double"] = computeJson(computePeaks<double>());
+
+    const auto &bandwidth = bandwidthPeaks();
+    boost::json::object memory;
+    memory["single_core_gbs"] = bandwidth.singleCoreGBs;
+    memory["all_cores_gbs"] = bandwidth.allCoresGBs;
+
+    boost::json::object peaks;
+    peaks["cores"] = hostCoreCount();
+    peaks["compute"] = compute;
+    peaks["memory"] = memory;
+    return peaks;
+}
+
+} // namespace roofline
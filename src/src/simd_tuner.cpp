@@ -0,0 +1,189 @@
+#include "simd_tuner.hpp"
+#include "matrix.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace simdTuner
+{
+
+TuningDatabase &TuningDatabase::instance()
+{
+    static TuningDatabase database(constants::SIMD_TUNING_DB_PATH);
+    static std::once_flag loaded;
+    std::call_once(loaded, []() { database.load(); });
+    return database;
+}
+
+std::string TuningDatabase::makeKey(std::string_view isa, std::string_view dataType)
+{
+    return std::format("{}|{}", isa, dataType);
+}
+
+std::optional<TuningEntry> TuningDatabase::lookup(std::string_view isa, std::string_view dataType) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(makeKey(isa, dataType));
+    if (it == m_entries.end()) return std::nullopt;
+    return it->second;
+}
+
+void TuningDatabase::store(std::string_view isa, std::string_view dataType, const TuningEntry &entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[makeKey(isa, dataType)] = entry;
+}
+
+void TuningDatabase::load()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+
+    std::ifstream file(m_path);
+    if (not file) return;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+
+    try
+    {
+        const boost::json::value root = boost::json::parse(ss.str());
+        for (const auto &item : root.at("entries").as_object())
+        {
+            const auto &obj = item.value().as_object();
+            TuningEntry entry;
+            entry.shape.regsA = obj.at("regs_a").to_number<int>();
+            entry.shape.regsB = obj.at("regs_b").to_number<int>();
+            entry.shape.kUnroll = obj.at("k_unroll").to_number<int>();
+            entry.gflops = obj.at("gflops").to_number<double>();
+            m_entries[std::string(item.key())] = entry;
+        }
+    } catch (const std::exception &e)
+    {
+        std::cerr << "Ignoring malformed SIMD tuning database " << m_path << ": " << e.what() << '\n';
+        m_entries.clear();
+    }
+}
+
+void TuningDatabase::save() const
+{
+    boost::json::object entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &[key, entry] : m_entries)
+        {
+            boost::json::object obj;
+            obj["regs_a"] = entry.shape.regsA;
+            obj["regs_b"] = entry.shape.regsB;
+            obj["k_unroll"] = entry.shape.kUnroll;
+            obj["gflops"] = entry.gflops;
+            entries[key] = obj;
+        }
+    }
+
+    boost::json::object root;
+    root["version"] = 1;
+    root["entries"] = entries;
+
+    std::ofstream file(m_path);
+    if (not file) throw std::runtime_error("Failed to open SIMD tuning database " + m_path.string());
+    util::prettyPrint(file, root);
+}
+
+// Small integer operands keep every product exact, so all shapes must agree with the scalar reference bit for bit.
+template<typename T>
+static bool verifySample(const std::vector<T> &a, const std::vector<T> &b, const std::vector<T> &c, int order)
+{
+    std::mt19937 gen(2u);
+    std::uniform_int_distribution<int> distrib(0, order - 1);
+    for (int sample = 0; sample < 64; ++sample)
+    {
+        const int i = distrib(gen);
+        const int j = distrib(gen);
+        T expected = 0;
+        for (int k = 0; k < order; ++k)
+        {
+            expected += a[i * order + k] * b[k * order + j];
+        }
+        if (c[i * order + j] != expected) return false;
+    }
+    return true;
+}
+
+template<typename T>
+static void autotuneType(TuningDatabase &database, int order, uint32_t repeats, boost::json::array &report)
+{
+    std::mt19937 gen(1u);
+    std::uniform_int_distribution<int> distrib(0, 10);
+    const size_t size = static_cast<size_t>(order) * order;
+    std::vector<T> a(size);
+    std::vector<T> b(size);
+    std::vector<T> c(size);
+    std::ranges::generate(a, [&]() { return static_cast<T>(distrib(gen)); });
+    std::ranges::generate(b, [&]() { return static_cast<T>(distrib(gen)); });
+
+    const double flops = 2.0 * static_cast<double>(order) * order * order;
+    boost::json::array shapes;
+    size_t bestIndex = DEFAULT_SHAPE_INDEX;
+    double bestSeconds = std::numeric_limits<double>::infinity();
+    for (size_t index = 0; index < MicroKernelShapes.size(); ++index)
+    {
+        const auto kernel = simdRowKernels<T>[index];
+        double seconds = std::numeric_limits<double>::infinity();
+        // The first run warms up caches and is not counted.
+        for (uint32_t i = 0; i <= repeats; ++i)
+        {
+            const auto start{std::chrono::steady_clock::now()};
+            kernel(a.data(), b.data(), c.data(), order, order, 0, order, {});
+            const double elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - start}.count();
+            if (i > 0) seconds = std::min(seconds, elapsed);
+        }
+
+        boost::json::object shape;
+        shape["shape"] = MicroKernelShapes[index].description();
+        shape["gflops"] = flops / seconds * 1e-9;
+        if (not verifySample(a, b, c, order))
+        {
+            shape["error"] = "wrong result";
+        } else if (seconds < bestSeconds)
+        {
+            bestSeconds = seconds;
+            bestIndex = index;
+        }
+        shapes.emplace_back(shape);
+    }
+
+    boost::json::object output;
+    output["isa"] = compiledIsa();
+    output["data_type"] = oclUtil::getOpenCLTypeName<T>();
+    output["order"] = order;
+    output["shapes"] = shapes;
+    if (bestSeconds < std::numeric_limits<double>::infinity())
+    {
+        const MicroKernelShape &best = MicroKernelShapes[bestIndex];
+        database.store(compiledIsa(), oclUtil::getOpenCLTypeName<T>(), TuningEntry{best, flops / bestSeconds * 1e-9});
+        setActiveShape<T>(bestIndex);
+        output["best"] = best.description();
+    } else
+    {
+        output["error"] = "no shape produced a correct result";
+    }
+    report.emplace_back(output);
+}
+
+boost::json::array autotuneHost(TuningDatabase &database, int order, uint32_t repeats)
+{
+    boost::json::array report;
+    autotuneType<int32_t>(database, order, repeats, report);
+    autotuneType<uint32_t>(database, order, repeats, report);
+    autotuneType<float>(database, order, repeats, report);
+    autotuneType<double>(database, order, repeats, report);
+    database.save();
+    return report;
+}
+
+} // namespace simdTuner
@@ -1,4 +1,6 @@
 #include "thread_pool.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
 
 ThreadPool::ThreadPool(size_t numThreads) : stop(false) 
 {
@@ -6,6 +8,7 @@ ThreadPool::ThreadPool(size_t numThreads) : stop(false)
     {
         workers.emplace_back([this]() 
         {
+            perf::registerPooledThread();
             while (true) 
             {
                 std::function<void()> task;
@@ -21,6 +24,7 @@ ThreadPool::ThreadPool(size_t numThreads) : stop(false)
                     task = std::move(this->tasks.front());
                     this->tasks.pop();
                 }
+                TRACE_SCOPE("task", "thread_pool");
                 task();
             }
         });
@@ -0,0 +1,124 @@
+#include "thread_team.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace
+{
+
+// Tens of microseconds of pause instructions, longer than the gap between back to back kernels. Spinning on a
+// single hardware thread only delays the thread that is about to change the value.
+int spinIterations()
+{
+    static const int iterations = std::thread::hardware_concurrency() > 1 ? 1 << 11 : 0;
+    return iterations;
+}
+
+} // namespace
+
+uint32_t spinThenWait(const std::atomic<uint32_t> &value, uint32_t old, std::atomic<uint32_t> &sleepers)
+{
+    for (int i = 0; i < spinIterations(); ++i)
+    {
+        const uint32_t current = value.load(std::memory_order_acquire);
+        if (current != old) return current;
+        _mm_pause();
+    }
+
+    // Sequentially consistent on both sides: either the notifier sees the sleeper or the sleeper sees the new value.
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t current = value.load(std::memory_order_seq_cst);
+    while (current == old)
+    {
+        value.wait(old, std::memory_order_acquire);
+        current = value.load(std::memory_order_acquire);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    return current;
+}
+
+void SpinBarrier::arriveAndWait(uint32_t participants)
+{
+    // The generation cannot move on before this thread arrives, so the value read here is the current phase.
+    const uint32_t generation = m_generation.load(std::memory_order_acquire);
+    if (m_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == participants)
+    {
+        m_arrived.store(0, std::memory_order_relaxed);
+        m_generation.store(generation + 1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst) > 0) m_generation.notify_all();
+        return;
+    }
+    spinThenWait(m_generation, generation, m_sleepers);
+}
+
+ThreadTeam::ThreadTeam(size_t size) : m_members(std::max<size_t>(size, 1)), m_barrier(static_cast<uint32_t>(m_members.size()))
+{
+    for (size_t member = 1; member < m_members.size(); ++member)
+    {
+        m_threads.emplace_back([this, member]() { workerLoop(static_cast<int>(member)); });
+    }
+}
+
+ThreadTeam::~ThreadTeam()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_stop = true;
+        for (size_t member = 1; member < m_members.size(); ++member) wake(m_members[member]);
+    }
+    for (auto &thread : m_threads) thread.join();
+}
+
+void ThreadTeam::wake(Member &member)
+{
+    member.epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (member.sleepers.load(std::memory_order_seq_cst) > 0) member.epoch.notify_one();
+}
+
+void ThreadTeam::dispatch(int count, const void *context, Invoke invoke)
+{
+    m_context = context;
+    m_invoke = invoke;
+    m_count = count;
+    for (int member = 1; member < count; ++member) wake(m_members[member]);
+
+    Member &self = m_members[0];
+    {
+        TRACE_SCOPE("team job", "thread_team");
+        invoke(context, 0, count);
+    }
+    ++self.jobs;
+    m_barrier.arriveAndWait(static_cast<uint32_t>(count));
+}
+
+void ThreadTeam::workerLoop(int member)
+{
+    perf::registerPooledThread();
+    Member &self = m_members[member];
+    uint32_t epoch = 0;
+    while (true)
+    {
+        epoch = spinThenWait(self.epoch, epoch, self.sleepers);
+        if (m_stop) return;
+
+        const int count = m_count;
+        {
+            TRACE_SCOPE("team job", "thread_team");
+            m_invoke(m_context, member, count);
+        }
+        ++self.jobs;
+        m_barrier.arriveAndWait(static_cast<uint32_t>(count));
+    }
+}
+
+std::shared_ptr<ThreadTeam> sharedThreadTeam(size_t size)
+{
+    static std::mutex mutex;
+    static std::shared_ptr<ThreadTeam> team;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (not team || team->size() < size) team = std::make_shared<ThreadTeam>(size);
+    return team;
+}
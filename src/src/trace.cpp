@@ -0,0 +1,296 @@
+#include "trace.hpp"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace trace
+{
+
+namespace
+{
+
+// Per thread ring. All rings come from a pool allocated when tracing is enabled, so recording never allocates;
+// the first event of a thread only takes a ring from the pool under the registry lock.
+constexpr size_t THREAD_RING_CAPACITY = 1 << 12;
+// Bounds the memory of kernels that start a thread per row or element: once every ring is held by a running
+// thread, further threads drop their events.
+constexpr size_t THREAD_BUFFER_POOL_SIZE = 128;
+constexpr size_t TRACK_CAPACITY = 1 << 16;
+
+struct Event
+{
+    const char *name = nullptr;
+    const char *category = nullptr;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+};
+
+// Single writer ring: only the owning thread appends, readers look at it once the writers are idle.
+struct ThreadBuffer
+{
+    uint32_t tid = 0;
+    std::string name;
+    std::unique_ptr<Event[]> events = std::make_unique<Event[]>(THREAD_RING_CAPACITY);
+    std::atomic<uint64_t> written{0};
+
+    void append(const Event &event)
+    {
+        const uint64_t index = written.load(std::memory_order_relaxed);
+        events[index % THREAD_RING_CAPACITY] = event;
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(std::min<uint64_t>(written.load(std::memory_order_acquire), THREAD_RING_CAPACITY));
+    }
+};
+
+struct Track
+{
+    uint32_t tid = 0;
+    std::vector<Event> events;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    // Owns every ring, at most THREAD_BUFFER_POOL_SIZE. Live ones belong to a running thread, retired ones hold
+    // the events of exited threads in exit order and spare ones wait for the next new thread.
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::deque<ThreadBuffer *> retired;
+    std::vector<ThreadBuffer *> spare;
+    std::map<std::string, Track, std::less<>> tracks;
+    std::set<std::string, std::less<>> strings;
+    uint32_t nextTid = 1;
+    uint64_t epochNs = 0;
+};
+
+std::atomic<uint64_t> droppedEvents{0};
+
+// Never destroyed, threads that outlive static destruction still release their buffers.
+Registry &registry()
+{
+    static auto *instance = new Registry;
+    return *instance;
+}
+
+void makeSpare(Registry &reg, ThreadBuffer *buffer)
+{
+    buffer->written.store(0, std::memory_order_relaxed);
+    buffer->name.clear();
+    if (reg.spare.size() < THREAD_BUFFER_POOL_SIZE)
+    {
+        reg.spare.push_back(buffer);
+        return;
+    }
+    std::erase_if(reg.buffers, [buffer](const auto &owned) { return owned.get() == buffer; });
+}
+
+// A spare ring, else the ring of the thread that exited first, whose events are dropped. Null when every ring
+// is held by a running thread.
+ThreadBuffer *acquireBuffer()
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    ThreadBuffer *buffer = nullptr;
+    if (not reg.spare.empty())
+    {
+        buffer = reg.spare.back();
+        reg.spare.pop_back();
+    } else if (not reg.retired.empty())
+    {
+        buffer = reg.retired.front();
+        reg.retired.pop_front();
+        droppedEvents.fetch_add(buffer->size(), std::memory_order_relaxed);
+        buffer->written.store(0, std::memory_order_relaxed);
+        buffer->name.clear();
+    } else
+    {
+        return nullptr;
+    }
+    buffer->tid = reg.nextTid++;
+    return buffer;
+}
+
+void releaseBuffer(ThreadBuffer *buffer)
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if (buffer->written.load(std::memory_order_acquire) == 0) makeSpare(reg, buffer);
+    else reg.retired.push_back(buffer);
+}
+
+struct BufferHandle
+{
+    ThreadBuffer *buffer = acquireBuffer();
+
+    ~BufferHandle()
+    {
+        if (buffer) releaseBuffer(buffer);
+    }
+};
+
+// Null when the pool was exhausted at the thread's first event, the thread then drops all its events.
+ThreadBuffer *threadBuffer()
+{
+    thread_local BufferHandle handle;
+    return handle.buffer;
+}
+
+boost::json::object completeEvent(const Event &event, uint32_t pid, uint32_t tid, uint64_t epochNs)
+{
+    boost::json::object obj;
+    obj["name"] = event.name;
+    obj["cat"] = event.category;
+    obj["ph"] = "X";
+    obj["ts"] = static_cast<double>(event.startNs - std::min(event.startNs, epochNs)) * 1e-3;
+    obj["dur"] = static_cast<double>(event.endNs - std::min(event.endNs, event.startNs)) * 1e-3;
+    obj["pid"] = pid;
+    obj["tid"] = tid;
+    return obj;
+}
+
+boost::json::object metadataEvent(const char *kind, uint32_t pid, uint32_t tid, std::string_view name)
+{
+    boost::json::object args;
+    args["name"] = name;
+    boost::json::object obj;
+    obj["name"] = kind;
+    obj["ph"] = "M";
+    obj["pid"] = pid;
+    obj["tid"] = tid;
+    obj["args"] = args;
+    return obj;
+}
+
+constexpr uint32_t HOST_PID = 1;
+constexpr uint32_t DEVICE_PID = 2;
+
+} // namespace
+
+void setEnabled(bool enable)
+{
+    if (enable)
+    {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (reg.epochNs == 0) reg.epochNs = nowNs();
+        while (reg.buffers.size() < THREAD_BUFFER_POOL_SIZE)
+        {
+            reg.spare.push_back(reg.buffers.emplace_back(std::make_unique<ThreadBuffer>()).get());
+        }
+    }
+    tracingEnabled.store(enable, std::memory_order_relaxed);
+}
+
+const char *intern(std::string_view str)
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.strings.find(str);
+    if (it == reg.strings.end()) it = reg.strings.emplace(str).first;
+    return it->c_str();
+}
+
+void recordComplete(const char *name, const char *category, uint64_t startNs, uint64_t endNs)
+{
+    if (ThreadBuffer *buffer = threadBuffer()) buffer->append({name, category, startNs, endNs});
+    else droppedEvents.fetch_add(1, std::memory_order_relaxed);
+}
+
+void recordTrackEvent(std::string_view track, const char *name, const char *category, uint64_t startNs, uint64_t endNs)
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.tracks.find(track);
+    if (it == reg.tracks.end())
+    {
+        it = reg.tracks.emplace(std::string(track), Track{static_cast<uint32_t>(reg.tracks.size() + 1), {}}).first;
+    }
+    if (it->second.events.size() < TRACK_CAPACITY) it->second.events.push_back({name, category, startNs, endNs});
+}
+
+void setThreadName(std::string_view name)
+{
+    if (ThreadBuffer *buffer = threadBuffer()) buffer->name = name;
+}
+
+void writeChromeTrace(const std::filesystem::path &path)
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    boost::json::array events;
+    events.push_back(metadataEvent("process_name", HOST_PID, 0, "host"));
+    for (const auto &buffer : reg.buffers)
+    {
+        const size_t count = buffer->size();
+        if (count == 0) continue;
+
+        events.push_back(metadataEvent("thread_name", HOST_PID, buffer->tid, 
+                                       buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name));
+        for (size_t i = 0; i < count; ++i)
+        {
+            events.push_back(completeEvent(buffer->events[i], HOST_PID, buffer->tid, reg.epochNs));
+        }
+    }
+
+    if (not reg.tracks.empty()) events.push_back(metadataEvent("process_name", DEVICE_PID, 0, "OpenCL devices"));
+    for (const auto &[name, track] : reg.tracks)
+    {
+        events.push_back(metadataEvent("thread_name", DEVICE_PID, track.tid, name));
+        for (const auto &event : track.events)
+        {
+            events.push_back(completeEvent(event, DEVICE_PID, track.tid, reg.epochNs));
+        }
+    }
+
+    boost::json::object root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ns";
+
+    std::ofstream file(path);
+    if (not file) throw std::runtime_error("Failed to open trace file " + path.string());
+    file << boost::json::serialize(root);
+}
+
+void clear()
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto &buffer : reg.buffers)
+    {
+        buffer->written.store(0, std::memory_order_release);
+    }
+    for (ThreadBuffer *buffer : reg.retired) makeSpare(reg, buffer);
+    reg.retired.clear();
+    droppedEvents.store(0, std::memory_order_relaxed);
+    for (auto &[name, track] : reg.tracks) track.events.clear();
+}
+
+size_t droppedEventCount()
+{
+    return static_cast<size_t>(droppedEvents.load(std::memory_order_relaxed));
+}
+
+size_t eventCount()
+{
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = 0;
+    for (const auto &buffer : reg.buffers) count += buffer->size();
+    for (const auto &[name, track] : reg.tracks) count += track.events.size();
+    return count;
+}
+
+} // namespace trace
@@ -23,6 +23,41 @@ std::string toString(MatMultType type)
             return "MultithreadSimd";
         case MatMultType::NaiveOcl:   
             return "NaiveOcl";
+        case MatMultType::HeterogeneousOcl:   
+            return "HeterogeneousOcl";
+        case MatMultType::TiledOcl:   
+            return "TiledOcl";
+        case MatMultType::OmpStatic:   
+            return "OmpStatic";
+        case MatMultType::OmpDynamic:   
+            return "OmpDynamic";
+        case MatMultType::OmpGuided:   
+            return "OmpGuided";
+        case MatMultType::ParUnseq:   
+            return "ParUnseq";
+        case MatMultType::Auto:   
+            return "Auto";
+        case MatMultType::Ublas:   
+            return "Ublas";
+        case MatMultType::Blas:   
+            return "Blas";
+        default:                                    
+            return "Unknown";
+    }
+}
+
+std::string toString(MatMultDataType type)
+{
+    switch (type) 
+    {
+        case MatMultDataType::Int32:             
+            return "int32";
+        case MatMultDataType::Uint32:              
+            return "uint32";
+        case MatMultDataType::Float:    
+            return "float";
+        case MatMultDataType::Double:
+            return "double";
         default:                                    
             return "Unknown";
     }
@@ -38,6 +73,15 @@ MatMultType fromString(std::string_view str)
     if (strLower == "multithreadelement") { return MatMultType::MultithreadElement; }
     if (strLower == "multithreadsimd") { return MatMultType::MultithreadSimd; }
     if (strLower == "naiveocl") { return MatMultType::NaiveOcl; }
+    if (strLower == "heterogeneousocl") { return MatMultType::HeterogeneousOcl; }
+    if (strLower == "tiledocl") { return MatMultType::TiledOcl; }
+    if (strLower == "ompstatic") { return MatMultType::OmpStatic; }
+    if (strLower == "ompdynamic") { return MatMultType::OmpDynamic; }
+    if (strLower == "ompguided") { return MatMultType::OmpGuided; }
+    if (strLower == "parunseq") { return MatMultType::ParUnseq; }
+    if (strLower == "auto") { return MatMultType::Auto; }
+    if (strLower == "ublas") { return MatMultType::Ublas; }
+    if (strLower == "blas") { return MatMultType::Blas; }
     return MatMultType::Last;
 }
 
@@ -48,7 +92,7 @@ MatMultDataType fromString(std::string_view str)
     if (strLower == "int32") { return MatMultDataType::Int32; }
     if (strLower == "uint32") { return MatMultDataType::Uint32; }
     if (strLower == "float") { return MatMultDataType::Float; }
-    if (strLower == "doble") { return MatMultDataType::Double; }
+    if (strLower == "double") { return MatMultDataType::Double; }
     return MatMultDataType::Last;
 }
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "kernel_registry.hpp"
+#include "ocl_tuner.hpp"
+#include "ocl_utils.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Builds every embedded kernel variant for every local OpenCL device and writes a C++ source file
+// that registers the resulting binaries with oclUtil::KernelRegistry at startup.
+
+namespace
+{
+
+struct Variant
+{
+    std::string kernel;
+    std::string options;
+};
+
+template<typename T>
+void appendMatMultVariants(const oclUtil::DeviceInfo &device, std::vector<Variant> &variants)
+{
+    const std::string typeOption = "-DT=" + oclUtil::getOpenCLTypeName<T>();
+    variants.push_back({"mat_mult.cl", typeOption});
+    variants.push_back({"mat_mult.cl", typeOption + " " + oclTuner::TiledKernelConfig{}.buildOptions()});
+
+    for (auto shapeClass : {oclTuner::ShapeClass::Small, oclTuner::ShapeClass::Medium, oclTuner::ShapeClass::Large})
+    {
+        auto entry = oclTuner::TuningDatabase::instance().lookup(oclUtil::deviceKey(device.device), 
+                                                                 oclUtil::getOpenCLTypeName<T>(), shapeClass);
+        if (entry)
+        {
+            variants.push_back({"mat_mult.cl", typeOption + " " + entry->config.buildOptions()});
+        }
+    }
+}
+
+std::vector<Variant> variantsFor(const oclUtil::DeviceInfo &device)
+{
+    std::vector<Variant> variants;
+    appendMatMultVariants<int32_t>(device, variants);
+    appendMatMultVariants<uint32_t>(device, variants);
+    appendMatMultVariants<float>(device, variants);
+    appendMatMultVariants<double>(device, variants);
+    variants.push_back({"test.cl", ""});
+
+    std::ranges::sort(variants, {}, [](const Variant &v) { return std::tie(v.kernel, v.options); });
+    auto duplicates = std::ranges::unique(variants, {}, [](const Variant &v) { return std::tie(v.kernel, v.options); });
+    variants.erase(duplicates.begin(), duplicates.end());
+    return variants;
+}
+
+std::string escape(std::string_view str)
+{
+    std::string result;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <generated source file>\n";
+        return 1;
+    }
+
+    std::string arrays;
+    std::string registrations;
+    size_t binaryCount{0};
+
+    for (const auto &device : oclUtil::enumerateDevices())
+    {
+        const std::string key = oclUtil::deviceKey(device.device);
+        for (const auto &variant : variantsFor(device))
+        {
+            try
+            {
+                oclUtil::Program program(variant.kernel);
+                program.initialize(device);
+                program.build(variant.options.c_str());
+                const oclUtil::KernelBinary binary = program.binary();
+
+                const std::string name = std::format("binary{}", binaryCount++);
+                arrays += std::format("constexpr unsigned char {}[] = {{", name);
+                for (size_t i = 0; i < binary.size(); ++i)
+                {
+                    arrays += std::format("{}{}", i % 16 == 0 ? "\n    " : " ", static_cast<unsigned>(binary[i])) + ",";
+                }
+                arrays += "\n};\n\n";
+
+                registrations += std::format("    registry.registerBinary(\"{}\", \"{}\", \"{}\", {}, sizeof({}));\n",
+                                             escape(variant.kernel), escape(key), escape(variant.options), name, name);
+                std::cerr << std::format("Precompiled {} [{}] for {}\n", variant.kernel, variant.options, device.description());
+            } catch (const std::runtime_error &e)
+            {
+                std::cerr << std::format("Skipping {} [{}] for {}: {}\n", variant.kernel, variant.options, device.description(), e.what());
+            }
+        }
+    }
+
+    std::ofstream output(argv[1]);
+    if (not output)
+    {
+        std::cerr << "Failed to open " << argv[1] << '\n';
+        return 1;
+    }
+
+    output << "// Generated by kernel_precompiler, do not edit.\n"
+           << "#include \"kernel_registry.hpp\"\n\n"
+           << "namespace\n{\n\n"
+           << arrays
+           << "const bool registered = []()\n{\n"
+           << "    [[maybe_unused]] auto &registry = oclUtil::KernelRegistry::instance();\n"
+           << registrations
+           << "    return true;\n}();\n\n"
+           << "} // namespace\n";
+
+    return 0;
+}
@@ -1,6 +1,12 @@
 #pragma once
+#include "matrix.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
 #include <cstdint>
 #include <random>
+#include <type_traits>
 
 class GlobalRNG {
 public:
@@ -19,4 +25,52 @@ public:
     static unsigned int getSeed() { return s_seed; }
 private:
     inline static unsigned int s_seed{ std::random_device{}() };
-};
\ No newline at end of file
+};
+
+namespace testUtils
+{
+
+// Leaves partial tiles at the bottom and right edges for every microkernel shape.
+inline constexpr int ODD_ORDER = 37;
+
+// Element by element: within relTol * |expected| + absTol for floating point, exact for integers.
+template<typename M>
+void expectNear(const M &result, const M &expected, double relTol = 1e-4, double absTol = 0.0)
+{
+    for (int i = 0; i < M::Size; ++i)
+    {
+        if constexpr (std::is_floating_point_v<std::decay_t<decltype(expected[i])>>)
+        {
+            ASSERT_NEAR(result[i], expected[i], relTol * std::abs(expected[i]) + absTol) << "at " << i;
+        } else
+        {
+            ASSERT_EQ(result[i], expected[i]) << "at " << i;
+        }
+    }
+}
+
+// The operands the kernel tests multiply, filled from fixed seeds so a failure reproduces.
+template<typename T, int Order = ODD_ORDER>
+struct RandomOperands
+{
+    RandomOperands()
+    {
+        a.randomFill(1u);
+        b.randomFill(2u);
+    }
+
+    Matrix<T, Order, Order> naiveProduct() const { return a.template mult<MatMultType::Naive>(b); }
+
+    Matrix<T, Order, Order> a;
+    Matrix<T, Order, Order> b;
+};
+
+// multiply(a, b) of the RandomOperands against the Naive kernel.
+template<typename T, int Order = ODD_ORDER, typename Multiply>
+void expectMatchesNaive(Multiply &&multiply, double relTol = 1e-4)
+{
+    const RandomOperands<T, Order> operands;
+    expectNear(multiply(operands.a, operands.b), operands.naiveProduct(), relTol);
+}
+
+} // namespace testUtils
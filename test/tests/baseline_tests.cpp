@@ -0,0 +1,69 @@
+#include "matrix_benchmarks.hpp"
+#include "sweep.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+template<typename T>
+struct BlasBaselineFixture : public ::testing::Test {};
+
+using BlasTypes = ::testing::Types<float, double>;
+TYPED_TEST_SUITE(BlasBaselineFixture, BlasTypes);
+
+TYPED_TEST(BlasBaselineFixture, WhenBlasAvailableThenResultMatchesNaive)
+{
+    if constexpr (not baselines::blasSupports<TypeParam>)
+    {
+        GTEST_SKIP() << "built without cblas";
+    } else
+    {
+        testUtils::expectMatchesNaive<TypeParam>(
+            [](const auto &a, const auto &b) { return a.template mult<MatMultType::Blas>(b); }, 1e-2);
+    }
+}
+
+TEST(BaselineTest, WhenBaselineMeasuredFirstThenKernelsAreReportedRelativeToTheBest)
+{
+    Benchmarks::baselineResults().clear();
+    auto record = [](double gflops)
+    {
+        boost::json::object obj;
+        obj["gflops"] = gflops;
+        return obj;
+    };
+
+    auto ublas = record(2.0);
+    Benchmarks::injectBaselineRatio<float>(ublas, MatMultType::Ublas, 64);
+    auto blas = record(8.0);
+    Benchmarks::injectBaselineRatio<float>(blas, MatMultType::Blas, 64);
+    EXPECT_FALSE(blas.contains("baseline_ratio"));
+
+    auto simd = record(4.0);
+    Benchmarks::injectBaselineRatio<float>(simd, MatMultType::Simd, 64);
+    EXPECT_EQ(simd.at("baseline_kernel").as_string(), "Blas");
+    EXPECT_DOUBLE_EQ(simd.at("baseline_ratio").to_number<double>(), 0.5);
+
+    auto otherOrder = record(4.0);
+    Benchmarks::injectBaselineRatio<float>(otherOrder, MatMultType::Simd, 128);
+    EXPECT_FALSE(otherOrder.contains("baseline_ratio"));
+
+    Benchmarks::baselineResults().clear();
+}
+
+TEST(BaselineTest, WhenSweepExpandedThenBaselinesRunFirstAtEveryShape)
+{
+    const Benchmarks::SweepSpec spec{
+        { 64, 128 },
+        { MatMultType::Simd, MatMultType::Ublas, MatMultType::Naive },
+        { MatMultDataType::Float },
+        {}
+    };
+
+    const auto plan = Benchmarks::expandSweep(spec);
+
+    ASSERT_EQ(plan.size(), 6u);
+    EXPECT_EQ(plan[0].multType, MatMultType::Ublas);
+    EXPECT_EQ(plan[1].multType, MatMultType::Simd);
+    EXPECT_EQ(plan[2].multType, MatMultType::Naive);
+    EXPECT_EQ(plan[3].multType, MatMultType::Ublas);
+}
@@ -0,0 +1,111 @@
+#include "benchmark.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+TEST(BenchmarkStatsTest, WhenStatisticsComputedThenPercentilesAndSpreadMatch)
+{
+    std::vector<double> samples(101);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        samples[i] = static_cast<double>(100 - i);
+    }
+
+    const auto stats = Benchmarks::computeStatistics(samples);
+
+    EXPECT_EQ(stats.count, 101u);
+    EXPECT_DOUBLE_EQ(stats.min, 0.0);
+    EXPECT_DOUBLE_EQ(stats.max, 100.0);
+    EXPECT_DOUBLE_EQ(stats.mean, 50.0);
+    EXPECT_DOUBLE_EQ(stats.median, 50.0);
+    EXPECT_DOUBLE_EQ(stats.p90, 90.0);
+    EXPECT_DOUBLE_EQ(stats.p99, 99.0);
+    EXPECT_DOUBLE_EQ(stats.mad, 25.0);
+    EXPECT_NEAR(stats.stddev, 29.3002, 1e-4);
+}
+
+TEST(BenchmarkStatsTest, WhenSampleHasSpikeThenItIsRejected)
+{
+    size_t rejected = 0;
+    const auto kept = Benchmarks::rejectOutliers({1.0, 1.1, 0.9, 1.05, 0.95, 10.0}, 3.5, &rejected);
+
+    EXPECT_EQ(rejected, 1u);
+    EXPECT_EQ(kept, (std::vector<double>{1.0, 1.1, 0.9, 1.05, 0.95}));
+}
+
+namespace
+{
+
+class FlakyRunner : public Benchmarks::Runner
+{
+public:
+    uint32_t computeCalls = 0;
+protected:
+    void compute() override
+    {
+        if (++computeCalls % 3 == 0) throw std::runtime_error("flaky iteration");
+    }
+};
+
+class InvalidArgumentRunner : public Benchmarks::Runner
+{
+protected:
+    void compute() override
+    {
+        throw std::invalid_argument("unsupported shape");
+    }
+};
+
+} // namespace
+
+TEST(BenchmarkRunnerTest, WhenIterationsThrowThenTheyAreExcludedFromStatistics)
+{
+    FlakyRunner runner;
+    runner.config() = Benchmarks::RunnerConfig{
+        .warmupIterations = 1,
+        .minIterations = 6,
+        .maxIterations = 6,
+        .targetRelativeCi = 0.0,
+        .timeBudgetSeconds = 60.0,
+        .outlierThreshold = 0.0
+    };
+
+    runner.run<1>();
+
+    EXPECT_EQ(runner.computeCalls, 7u);
+    EXPECT_EQ(runner.failedIterations(), 2u);
+    EXPECT_EQ(runner.statistics().count, 4u);
+}
+
+TEST(BenchmarkRunnerTest, WhenTimeBudgetIsExhaustedThenRunStopsAfterMinIterations)
+{
+    FlakyRunner runner;
+    runner.config() = Benchmarks::RunnerConfig{
+        .warmupIterations = 0,
+        .minIterations = 3,
+        .maxIterations = 1000,
+        .targetRelativeCi = 0.0,
+        .timeBudgetSeconds = 0.0,
+        .outlierThreshold = 3.5
+    };
+
+    runner.run<1>();
+
+    EXPECT_EQ(runner.computeCalls, 3u);
+}
+
+TEST(BenchmarkRunnerTest, WhenIterationThrowsAnyStdExceptionThenItCountsAsFailed)
+{
+    InvalidArgumentRunner runner;
+    runner.config() = Benchmarks::RunnerConfig{
+        .warmupIterations = 0,
+        .minIterations = 2,
+        .maxIterations = 2
+    };
+
+    EXPECT_NO_THROW(runner.run<1>());
+    EXPECT_EQ(runner.failedIterations(), 2u);
+    EXPECT_EQ(runner.statistics().count, 0u);
+}
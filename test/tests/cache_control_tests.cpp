@@ -0,0 +1,38 @@
+#include "cache_control.hpp"
+#include "matrix_benchmarks.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+TEST(CacheControlTest, WhenModeParsedThenNamesRoundTrip)
+{
+    for (auto mode : { cache::Mode::Warm, cache::Mode::Cold, cache::Mode::Rotating })
+    {
+        EXPECT_EQ(cache::modeFromString(cache::toString(mode)), mode);
+    }
+    EXPECT_EQ(cache::modeFromString("COLD"), cache::Mode::Cold);
+    EXPECT_THROW(cache::modeFromString("lukewarm"), std::invalid_argument);
+}
+
+TEST(CacheControlTest, WhenOperandsRotateThenSetsOverflowTheLastLevelCache)
+{
+    const size_t llc = cache::lastLevelCacheBytes();
+    EXPECT_GT(llc, 0u);
+    EXPECT_EQ(cache::rotatingSetCount(4 * llc), 2u);
+    EXPECT_GE(cache::rotatingSetCount(llc / 8) * (llc / 8), 2 * llc);
+
+    Benchmarks::MatMultOperands<float, 64, 64> operands;
+    operands.prepare(cache::Mode::Rotating);
+    const size_t sets = operands.setCount();
+    ASSERT_GE(sets, 2u);
+
+    const float *first = operands.a().data().data();
+    operands.prepare(cache::Mode::Rotating);
+    EXPECT_NE(operands.a().data().data(), first);
+    for (size_t i = 1; i < sets; ++i) operands.prepare(cache::Mode::Rotating);
+    EXPECT_EQ(operands.a().data().data(), first);
+
+    operands.prepare(cache::Mode::Cold);
+    EXPECT_EQ(operands.setCount(), 1u);
+}
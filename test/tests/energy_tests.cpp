@@ -0,0 +1,42 @@
+#include "energy.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(EnergyTest, WhenCounterWrapsThenDeltaCountsThroughMaxRange)
+{
+    EXPECT_EQ(energy::counterDelta(100, 350, 1000), 250u);
+    EXPECT_EQ(energy::counterDelta(900, 50, 1000), 150u);
+    EXPECT_EQ(energy::counterDelta(5, 5, 1000), 0u);
+}
+
+TEST(EnergyTest, WhenTotalsConvertedThenWattsAndEfficiencyAreDerived)
+{
+    energy::EnergyValues totals;
+    totals.joules = { 8.0, 2.0 };
+    totals.valid = { true, true };
+
+    const auto obj = energy::toJson(totals, 4, 2.0, 5e9);
+
+    EXPECT_TRUE(obj.at("available").as_bool());
+    EXPECT_DOUBLE_EQ(obj.at("joules").as_double(), 10.0);
+    EXPECT_DOUBLE_EQ(obj.at("average_watts").as_double(), 5.0);
+    EXPECT_DOUBLE_EQ(obj.at("gflops_per_watt").as_double(), 2.0);
+
+    const auto unavailable = energy::toJson({}, 4, 2.0, 5e9);
+    EXPECT_FALSE(unavailable.at("available").as_bool());
+    EXPECT_FALSE(unavailable.contains("joules"));
+}
+
+TEST(EnergyTest, WhenMeterIsUnavailableThenItReportsWhy)
+{
+    energy::EnergyMeter meter;
+
+    meter.start();
+    const auto values = meter.stop();
+
+    if (not meter.available())
+    {
+        EXPECT_FALSE(meter.unavailableReason().empty());
+        EXPECT_FALSE(values.has(energy::Domain::Package));
+    }
+}
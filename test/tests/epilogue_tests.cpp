@@ -0,0 +1,92 @@
+#include "epilogue.hpp"
+#include "epilogue_benchmarks.hpp"
+#include "matrix.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+template<typename T>
+struct EpilogueFixture : public ::testing::Test, public testUtils::RandomOperands<T>
+{
+    static constexpr int Order = testUtils::ODD_ORDER;
+    using MatrixType = Matrix<T, Order, Order>;
+
+    EpilogueFixture()
+    {
+        residual.randomFill(3u);
+        for (int j = 0; j < Order; ++j) bias[j] = static_cast<T>(j % 7) - static_cast<T>(std::is_signed_v<T> ? 3 : 0);
+    }
+
+    template<typename Epi>
+    void expectMatchesScalar(const MatrixType &result, const Epi &epi)
+    {
+        auto expected = this->naiveProduct();
+        for (int i = 0; i < Order; ++i)
+        {
+            for (int j = 0; j < Order; ++j) expected(i, j) = epi.scalar(expected(i, j), i, j);
+        }
+        testUtils::expectNear(result, expected, 1e-4, 1e-4);
+    }
+
+    MatrixType residual;
+    std::vector<T> bias = std::vector<T>(Order);
+};
+
+using EpilogueTypes = ::testing::Types<int32_t, float, double>;
+TYPED_TEST_SUITE(EpilogueFixture, EpilogueTypes);
+
+TYPED_TEST(EpilogueFixture, WhenPipelineFusedThenResultMatchesScalarEpilogue)
+{
+    using T = TypeParam;
+    using MatrixType = typename TestFixture::MatrixType;
+    Benchmarks::PipelineEpilogue<T> epi;
+    epi.bias = this->bias.data();
+    epi.residual = this->residual.data().data();
+    epi.ldr = TestFixture::Order;
+    epi.beta = T(2);
+
+    this->expectMatchesScalar(MatrixMultImpl<MatMultType::Simd, MatrixType, MatrixType>::multiply(this->a, this->b, epi), epi);
+    this->expectMatchesScalar(
+        MatrixMultImpl<MatMultType::MultithreadSimd, MatrixType, MatrixType>::multiply(this->a, this->b, 3, epi), epi);
+}
+
+TYPED_TEST(EpilogueFixture, WhenAppliedInPassesThenResultMatchesFused)
+{
+    using T = TypeParam;
+    using MatrixType = typename TestFixture::MatrixType;
+    epilogue::Ops<T, true, true, epilogue::Activation::Relu, false> epi;
+    epi.alpha = T(3);
+    epi.bias = this->bias.data();
+
+    const auto fused = MatrixMultImpl<MatMultType::Simd, MatrixType, MatrixType>::multiply(this->a, this->b, epi);
+    auto unfused = this->a.template mult<MatMultType::Simd>(this->b);
+    epi.applyInPasses(unfused.data().data(), TestFixture::Order, TestFixture::Order, TestFixture::Order);
+    testUtils::expectNear(fused, unfused, 1e-5, 1e-5);
+}
+
+TEST(EpilogueTest, WhenReluAppliedThenNegativeValuesAreClamped)
+{
+    Matrix<int32_t, 8, 8> a;
+    Matrix<int32_t, 8, 8> b;
+    for (int i = 0; i < a.Size; ++i)
+    {
+        a[i] = i % 3 - 1;
+        b[i] = 2;
+    }
+    const epilogue::Ops<int32_t, false, false, epilogue::Activation::Relu, false> relu;
+    const auto result = MatrixMultImpl<MatMultType::Simd, Matrix<int32_t, 8, 8>, Matrix<int32_t, 8, 8>>::multiply(a, b, relu);
+    const auto plain = a.mult<MatMultType::Naive>(b);
+    for (int i = 0; i < a.Size; ++i) EXPECT_EQ(result[i], std::max(plain[i], 0));
+}
+
+TEST(EpilogueTest, WhenDescribedThenBuildOptionsSelectTheSameOps)
+{
+    using Epi = Benchmarks::PipelineEpilogue<float>;
+    EXPECT_EQ(Epi::description(), "bias+gelu+residual");
+    EXPECT_EQ(Epi::oclBuildOptions(), "-DTF=float -DEPILOGUE -DEPI_BIAS -DEPI_GELU -DEPI_RESIDUAL");
+    EXPECT_EQ(epilogue::Identity<double>::oclBuildOptions(), "-DTF=double");
+    EXPECT_NEAR(epilogue::gelu(1.0), 0.8411919906, 1e-9);
+}
@@ -0,0 +1,80 @@
+#include "kernel_selector.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+TEST(KernelSelectorTest, WhenNotCalibratedThenHeuristicUsesThreadsOnlyForLargeOrders)
+{
+    using kernelSelector::Choice;
+    EXPECT_EQ(kernelSelector::heuristicChoice(2, 8), (Choice{MatMultType::Naive, 0}));
+    EXPECT_EQ(kernelSelector::heuristicChoice(64, 8), (Choice{MatMultType::Simd, 0}));
+    EXPECT_EQ(kernelSelector::heuristicChoice(256, 8), (Choice{MatMultType::MultithreadSimd, 4}));
+    EXPECT_EQ(kernelSelector::heuristicChoice(4096, 8), (Choice{MatMultType::MultithreadSimd, 8}));
+    EXPECT_EQ(kernelSelector::heuristicChoice(4096, 1), (Choice{MatMultType::Simd, 0}));
+}
+
+TEST(KernelSelectorTest, WhenSavedAndLoadedThenCrossoversApplyUpToTheNextCalibratedOrder)
+{
+    using kernelSelector::Choice;
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_auto_calibration_test.json";
+    std::filesystem::remove(path);
+
+    {
+        kernelSelector::CrossoverTable table(path);
+        table.store("float", {
+            {256, {MatMultType::MultithreadSimd, 4}, 0.01},
+            {2, {MatMultType::Naive, 0}, 1e-7},
+            {64, {MatMultType::Simd, 0}, 1e-4}
+        });
+        table.save();
+    }
+
+    kernelSelector::CrossoverTable table(path);
+    const uint64_t before = table.generation();
+    table.load();
+    EXPECT_NE(table.generation(), before);
+
+    EXPECT_EQ(table.lookup("float", 2), (Choice{MatMultType::Naive, 0}));
+    EXPECT_EQ(table.lookup("float", 128), (Choice{MatMultType::Simd, 0}));
+    EXPECT_EQ(table.lookup("float", 4096), (Choice{MatMultType::MultithreadSimd, 4}));
+    EXPECT_EQ(table.lookup("float", 1), (Choice{MatMultType::Naive, 0}));
+    EXPECT_FALSE(table.lookup("double", 128).has_value());
+
+    std::filesystem::remove(path);
+}
+
+TEST(KernelSelectorTest, WhenTableNamesKernelAutoCannotRunThenItIsIgnored)
+{
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_auto_calibration_blas_test.json";
+    {
+        std::ofstream file(path);
+        file << R"({"entries": {"float": [{"order": 64, "kernel": "Blas", "threads": 0, "seconds": 1e-5}]}})";
+    }
+
+    kernelSelector::CrossoverTable table(path);
+    table.load();
+
+    EXPECT_FALSE(table.lookup("float", 64).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(KernelSelectorTest, WhenTableThreadCountDoesNotFitKernelThenItIsIgnored)
+{
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_auto_calibration_threads_test.json";
+    for (const char *entry : { R"({"order": 64, "kernel": "MultithreadSimd", "threads": 0, "seconds": 1e-5})",
+                               R"({"order": 64, "kernel": "Simd", "threads": 4, "seconds": 1e-5})" })
+    {
+        {
+            std::ofstream file(path);
+            file << R"({"entries": {"float": [)" << entry << "]}}";
+        }
+
+        kernelSelector::CrossoverTable table(path);
+        table.load();
+
+        EXPECT_FALSE(table.lookup("float", 64).has_value()) << entry;
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,69 @@
+#include "load_balancer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+TEST(LoadBalancerTest, WhenNothingMeasuredThenSplitsEvenly)
+{
+    LoadBalancer balancer(4);
+
+    const auto bounds = balancer.partition(100);
+
+    ASSERT_EQ(bounds.size(), 5u);
+    EXPECT_EQ(bounds.front(), 0u);
+    EXPECT_EQ(bounds.back(), 100u);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(bounds[i + 1] - bounds[i], 25u);
+    }
+}
+
+TEST(LoadBalancerTest, WhenWorkerIsFasterThenItGetsProportionallyMoreWork)
+{
+    LoadBalancer balancer(2, 1.0);
+
+    balancer.update({50, 50}, {1.0, 3.0});
+    const auto bounds = balancer.partition(400);
+
+    EXPECT_EQ(bounds[1] - bounds[0], 300u);
+    EXPECT_EQ(bounds[2] - bounds[1], 100u);
+}
+
+TEST(LoadBalancerTest, WhenRepeatedlyUpdatedThenConvergesToEqualFinishTimes)
+{
+    LoadBalancer balancer(3, 0.5);
+    const std::vector<double> itemsPerSecond = {100.0, 300.0, 600.0};
+    constexpr size_t itemCount = 1000;
+
+    for (int run = 0; run < 20; ++run)
+    {
+        const auto bounds = balancer.partition(itemCount);
+        std::vector<size_t> items(3);
+        std::vector<double> seconds(3);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            items[i] = bounds[i + 1] - bounds[i];
+            seconds[i] = static_cast<double>(items[i]) / itemsPerSecond[i];
+        }
+        balancer.update(items, seconds);
+    }
+
+    const auto ratios = balancer.ratios();
+    EXPECT_NEAR(ratios[0], 0.1, 1e-3);
+    EXPECT_NEAR(ratios[1], 0.3, 1e-3);
+    EXPECT_NEAR(ratios[2], 0.6, 1e-3);
+    EXPECT_NEAR(std::accumulate(ratios.begin(), ratios.end(), 0.0), 1.0, 1e-9);
+}
+
+TEST(LoadBalancerTest, WhenWorkerGetsNoItemsThenKeepsPreviousEstimate)
+{
+    LoadBalancer balancer(2, 1.0);
+
+    balancer.update({10, 10}, {1.0, 1.0});
+    balancer.update({20, 0}, {1.0, 0.0});
+
+    const auto ratios = balancer.ratios();
+    EXPECT_NEAR(ratios[0], 2.0 / 3.0, 1e-9);
+    EXPECT_NEAR(ratios[1], 1.0 / 3.0, 1e-9);
+}
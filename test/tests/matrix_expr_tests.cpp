@@ -0,0 +1,79 @@
+#include "matrix_expr.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(MatrixExprTest, WhenChainPlannedThenTextbookOrderIsFound)
+{
+    constexpr auto plan = matrixExpr::planChain<6>({ 30, 35, 15, 5, 10, 20, 25 });
+    static_assert(plan.cost[0][5] == 15125);
+    EXPECT_EQ(plan.description(), "((M0 (M1 M2)) ((M3 M4) M5))");
+    EXPECT_LT(plan.flops(), matrixExpr::leftToRightFlops<6>({ 30, 35, 15, 5, 10, 20, 25 }));
+}
+
+TEST(MatrixExprTest, WhenChainAssignedThenResultMatchesEagerProduct)
+{
+    Matrix<double, 40, 9> a;
+    Matrix<double, 9, 33> b;
+    Matrix<double, 33, 5> c;
+    Matrix<double, 5, 17> d;
+    a.randomFill(1u);
+    b.randomFill(2u);
+    c.randomFill(3u);
+    d.randomFill(4u);
+
+    const auto expected = a.mult<MatMultType::Naive>(b).mult<MatMultType::Naive>(c).mult<MatMultType::Naive>(d);
+    const Matrix<double, 40, 17> result = a * b * c * d;
+    testUtils::expectNear(result, expected, 1e-9, 1e-9);
+
+    using ChainT = decltype(a * b * c * d);
+    EXPECT_EQ(ChainT::plan.description(), "((M0 (M1 M2)) M3)");
+}
+
+TEST(MatrixExprTest, WhenScaledAndAddedThenEpilogueAppliesToTheResult)
+{
+    Matrix<float, 19, 23> a;
+    Matrix<float, 23, 19> b;
+    Matrix<float, 19, 19> d;
+    a.randomFill(5u);
+    b.randomFill(6u);
+    d.randomFill(7u);
+
+    const auto product = a.mult<MatMultType::Naive>(b);
+    Matrix<float, 19, 19> expected;
+    for (int i = 0; i < expected.Size; ++i) expected[i] = 2.0f * product[i] + 0.5f * d[i];
+
+    // The addend is also the destination, which the epilogue has to read before it overwrites it.
+    d = 2.0f * a * b + 0.5f * d;
+    testUtils::expectNear(d, expected);
+}
+
+TEST(MatrixExprTest, WhenOperandIsTheDestinationThenItIsReadBeforeOverwritten)
+{
+    Matrix<int32_t, 12, 12> a;
+    Matrix<int32_t, 12, 12> b;
+    a.randomFill(8u);
+    b.randomFill(9u);
+
+    const auto expected = a.mult<MatMultType::Naive>(b);
+    a = a * b;
+    EXPECT_TRUE(a == expected);
+}
+
+TEST(MatrixExprTest, WhenEvaluatedAgainThenArenaDoesNotGrow)
+{
+    Matrix<double, 16, 64> a;
+    Matrix<double, 64, 8> b;
+    Matrix<double, 8, 64> c;
+    Matrix<double, 16, 64> result;
+    a.randomFill(10u);
+    b.randomFill(11u);
+    c.randomFill(12u);
+
+    result = 3.0 * a * b * c;
+    const size_t capacity = matrixExpr::Arena::threadLocal().capacity();
+    EXPECT_GT(capacity, 0u);
+    result = 3.0 * a * b * c;
+    EXPECT_EQ(matrixExpr::Arena::threadLocal().capacity(), capacity);
+    EXPECT_EQ(matrixExpr::Arena::threadLocal().used(), 0u);
+}
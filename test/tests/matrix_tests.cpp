@@ -1,6 +1,8 @@
 #include "test_utils.hpp"
 
+#include "baseline_kernels.hpp"
 #include "constants.hpp"
+#include "kernel_selector.hpp"
 #include "matrix.hpp"
 #include "ocl_utils.hpp"
 
@@ -13,6 +15,7 @@
 #define MATRIX_DIMS_FOR_TYPE(T)                     \
     MatrixParams<T, 2, 2>,                          \
     MatrixParams<T, 4, 4>,                          \
+    MatrixParams<T, 37, 37>,                        \
     MatrixParams<T, 64, 64>
 
 template<typename T>
@@ -127,4 +130,8 @@ MAT_MULT_TYPED_TEST(MatrixMultFixture, Simd);
 MAT_MULT_TYPED_TEST(MatrixMultFixture, MultithreadElement);
 MAT_MULT_TYPED_TEST(MatrixMultFixture, MultithreadRow);
 MAT_MULT_TYPED_TEST(MatrixMultFixture, MultithreadSimd);
-MAT_MULT_TYPED_TEST(MatrixMultFixtureOcl, NaiveOcl);
\ No newline at end of file
+MAT_MULT_TYPED_TEST(MatrixMultFixture, Auto);
+MAT_MULT_TYPED_TEST(MatrixMultFixture, Ublas);
+MAT_MULT_TYPED_TEST(MatrixMultFixtureOcl, NaiveOcl);
+MAT_MULT_TYPED_TEST(MatrixMultFixtureOcl, HeterogeneousOcl);
+MAT_MULT_TYPED_TEST(MatrixMultFixtureOcl, TiledOcl);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "memory_stats.hpp"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+TEST(MemoryStatsTest, WhenRegionAllocatesThenTrackerCountsItOnlyInTrackingBuilds)
+{
+    memory::beginRegion();
+    {
+        std::vector<double> buffer(1 << 16);
+        auto other = std::make_unique<int>(42);
+        buffer[0] = *other;
+    }
+    const auto stats = memory::endRegion();
+
+    if (memory::allocationTrackingEnabled())
+    {
+        EXPECT_GE(stats.allocations, 2u);
+        EXPECT_EQ(stats.allocations, stats.deallocations);
+        EXPECT_GE(stats.bytesAllocated, sizeof(double) << 16);
+        EXPECT_GE(stats.peakLiveBytes, sizeof(double) << 16);
+    } else
+    {
+        EXPECT_EQ(stats.allocations, 0u);
+        EXPECT_EQ(stats.bytesAllocated, 0u);
+    }
+}
+
+TEST(MemoryStatsTest, WhenConvertedThenProcessFiguresAreReported)
+{
+    memory::AllocationStats totals;
+    totals.allocations = 10;
+    totals.bytesAllocated = 4000;
+    memory::ProcessMemory process;
+    process.highWaterMarkBytes = 1 << 20;
+
+    const auto obj = memory::toJson(totals, 2, process, true);
+
+    EXPECT_EQ(obj.at("allocation_tracking").as_bool(), memory::allocationTrackingEnabled());
+    EXPECT_EQ(obj.at("peak_rss_scope").as_string(), "benchmark");
+    if (memory::allocationTrackingEnabled())
+    {
+        EXPECT_DOUBLE_EQ(obj.at("bytes_per_iteration").as_double(), 2000.0);
+    }
+#ifdef __linux__
+    EXPECT_GT(memory::processMemory().residentBytes, 0u);
+#endif
+}
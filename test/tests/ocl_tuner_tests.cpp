@@ -0,0 +1,46 @@
+#include "ocl_tuner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+TEST(TuningDatabaseTest, WhenSavedAndLoadedThenEntriesRoundTrip)
+{
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_tuning_db_test.json";
+    std::filesystem::remove(path);
+
+    {
+        oclTuner::TuningDatabase database(path);
+        database.store("pocl / cpu", "float", oclTuner::ShapeClass::Medium, {{32, 4}, 0.25});
+        database.store("pocl / cpu", "double", oclTuner::ShapeClass::Large, {{16, 2}, 1.5});
+        database.save();
+    }
+
+    oclTuner::TuningDatabase database(path);
+    database.load();
+
+    const auto entry = database.lookup("pocl / cpu", "float", oclTuner::ShapeClass::Medium);
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->config, (oclTuner::TiledKernelConfig{32, 4}));
+    EXPECT_DOUBLE_EQ(entry->kernelSeconds, 0.25);
+    EXPECT_FALSE(database.lookup("pocl / cpu", "float", oclTuner::ShapeClass::Small).has_value());
+
+    std::filesystem::remove(path);
+}
+
+TEST(TuningDatabaseTest, WhenOrderIsClassifiedThenShapeClassMatchesThresholds)
+{
+    EXPECT_EQ(oclTuner::shapeClassOf(2), oclTuner::ShapeClass::Small);
+    EXPECT_EQ(oclTuner::shapeClassOf(256), oclTuner::ShapeClass::Medium);
+    EXPECT_EQ(oclTuner::shapeClassOf(1024), oclTuner::ShapeClass::Large);
+}
+
+TEST(TuningDatabaseTest, WhenWorkSizesComputedThenGlobalSizeIsRoundedUpToTile)
+{
+    const auto [global, local] = oclTuner::workSizes({16, 4}, 100, 70);
+
+    EXPECT_EQ(global[0], 80u);
+    EXPECT_EQ(global[1], 28u);
+    EXPECT_EQ(local[0], 16u);
+    EXPECT_EQ(local[1], 4u);
+}
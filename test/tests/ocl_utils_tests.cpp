@@ -0,0 +1,35 @@
+#include "ocl_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+TEST(DevicePartitionTest, WhenSpecIsParsedThenKindAndParametersAreSet)
+{
+    const auto equally = oclUtil::DevicePartition::parse("equally=4,index=1");
+    EXPECT_EQ(equally.kind, oclUtil::DevicePartition::Kind::Equally);
+    EXPECT_EQ(equally.computeUnits, 4u);
+    EXPECT_EQ(equally.index, 1u);
+
+    const auto affinity = oclUtil::DevicePartition::parse("affinity=NUMA");
+    EXPECT_EQ(affinity.kind, oclUtil::DevicePartition::Kind::ByAffinityDomain);
+    EXPECT_EQ(affinity.affinityDomain, static_cast<cl_device_affinity_domain>(CL_DEVICE_AFFINITY_DOMAIN_NUMA));
+    EXPECT_EQ(oclUtil::DevicePartition::parse(affinity.description()), affinity);
+}
+
+TEST(DevicePartitionTest, WhenSpecIsInvalidThenParseThrows)
+{
+    EXPECT_THROW(oclUtil::DevicePartition::parse("equally=0"), std::invalid_argument);
+    EXPECT_THROW(oclUtil::DevicePartition::parse("affinity=l5"), std::invalid_argument);
+    EXPECT_THROW(oclUtil::DevicePartition::parse("cores=2"), std::invalid_argument);
+}
+
+TEST(DevicePartitionTest, WhenPartitionIsEqualThenPropertiesListComputeUnits)
+{
+    const auto properties = oclUtil::DevicePartition::equally(3).properties();
+    ASSERT_EQ(properties.size(), 3u);
+    EXPECT_EQ(properties[0], CL_DEVICE_PARTITION_EQUALLY);
+    EXPECT_EQ(properties[1], 3);
+    EXPECT_EQ(properties[2], 0);
+    EXPECT_TRUE(oclUtil::DevicePartition{}.properties().empty());
+}
@@ -0,0 +1,59 @@
+#include "matrix_benchmarks.hpp"
+#include "parallel_backends.hpp"
+#include "sweep.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <type_traits>
+
+template<typename T>
+struct ParallelBackendsFixture : public ::testing::Test
+{
+    template<MatMultType Type>
+    void run(int threadCount = 1)
+    {
+        testUtils::expectMatchesNaive<T>([threadCount](const auto &a, const auto &b) -> std::decay_t<decltype(a)>
+        {
+            using MatrixType = std::decay_t<decltype(a)>;
+            if constexpr (parallelBackends::isOpenMp(Type))
+            {
+                return MatrixMultImpl<Type, MatrixType, MatrixType>::multiply(a, b, threadCount);
+            } else
+            {
+                return a.template mult<Type>(b);
+            }
+        });
+    }
+};
+
+using ParallelBackendTypes = ::testing::Types<int32_t, float, double>;
+TYPED_TEST_SUITE(ParallelBackendsFixture, ParallelBackendTypes);
+
+TYPED_TEST(ParallelBackendsFixture, WhenOpenMpSchedulesUsedThenResultMatchesNaive)
+{
+    if (not parallelBackends::openMpAvailable) GTEST_SKIP() << "built without OpenMP";
+    this->template run<MatMultType::OmpStatic>(2);
+    this->template run<MatMultType::OmpDynamic>(3);
+    this->template run<MatMultType::OmpGuided>(5);
+}
+
+TYPED_TEST(ParallelBackendsFixture, WhenParUnseqUsedThenResultMatchesNaive)
+{
+    if (not parallelBackends::parUnseqAvailable) GTEST_SKIP() << "built without a parallel std::execution backend";
+    this->template run<MatMultType::ParUnseq>();
+}
+
+TEST(ParallelBackendsTest, WhenOpenMpTypeSweptThenThreadCountsApply)
+{
+    const auto plan = Benchmarks::expandSweep({ { 64 }, { MatMultType::OmpGuided, MatMultType::ParUnseq },
+                                                { MatMultDataType::Float }, { 1, 2 } });
+    ASSERT_EQ(plan.size(), 3u);
+    EXPECT_EQ(plan[0].threads, 1u);
+    EXPECT_EQ(plan[1].threads, 2u);
+    EXPECT_EQ(plan[2].multType, MatMultType::ParUnseq);
+    EXPECT_EQ(plan[2].threads, 0u);
+    EXPECT_EQ(util::fromString<MatMultType>("ompguided"), MatMultType::OmpGuided);
+    EXPECT_EQ(util::toString(MatMultType::ParUnseq), "ParUnseq");
+}
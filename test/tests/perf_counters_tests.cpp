@@ -0,0 +1,57 @@
+#include "perf_counters.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(PerfCountersTest, WhenGroupCannotCountThenItReportsWhy)
+{
+    perf::PerfCounterGroup group;
+
+    group.start();
+    const auto values = group.stop();
+
+    if (group.available())
+    {
+        EXPECT_TRUE(group.unavailableReason().empty());
+    } else
+    {
+        EXPECT_FALSE(group.unavailableReason().empty());
+        for (size_t i = 0; i < perf::COUNTER_COUNT; ++i)
+        {
+            EXPECT_FALSE(values.valid[i]);
+        }
+    }
+}
+
+TEST(PerfCountersTest, WhenTotalsConvertedThenDerivedMetricsAreNormalized)
+{
+    perf::CounterValues totals;
+    auto set = [&totals](perf::Counter counter, uint64_t value)
+    {
+        totals.values[static_cast<size_t>(counter)] = value;
+        totals.valid[static_cast<size_t>(counter)] = true;
+    };
+    set(perf::Counter::Cycles, 1000);
+    set(perf::Counter::Instructions, 2500);
+    set(perf::Counter::LlcMisses, 30);
+
+    const auto obj = perf::toJson(totals, 2, 5000.0);
+
+    EXPECT_TRUE(obj.at("available").as_bool());
+    EXPECT_DOUBLE_EQ(obj.at("ipc").as_double(), 2.5);
+    EXPECT_DOUBLE_EQ(obj.at("llc_misses_per_kflop").as_double(), 3.0);
+    EXPECT_FALSE(obj.contains("l1d_misses"));
+}
+
+TEST(PerfCountersTest, WhenPooledWorkCouldNotBeCountedThenTotalsArePartial)
+{
+    perf::CounterValues totals;
+    totals.values[static_cast<size_t>(perf::Counter::Cycles)] = 1000;
+    totals.valid[static_cast<size_t>(perf::Counter::Cycles)] = true;
+    EXPECT_FALSE(perf::toJson(totals, 1, 0.0).contains("partial"));
+
+    perf::CounterValues unattached;
+    unattached.partial = true;
+    totals += unattached;
+
+    EXPECT_TRUE(perf::toJson(totals, 1, 0.0).at("partial").as_bool());
+}
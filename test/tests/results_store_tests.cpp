@@ -0,0 +1,97 @@
+#include "benchmark_stats.hpp"
+#include "results_store.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace
+{
+
+boost::json::object makeRecord(double mean, double stddev, uint32_t count)
+{
+    boost::json::object record;
+    record["name"] = "MatMult_Naive";
+    record["times_executed"] = count;
+    record["avg_execution_time_seconds"] = mean;
+    record["stddev_execution_time_seconds"] = stddev;
+    return record;
+}
+
+} // namespace
+
+TEST(ResultsStoreTest, WhenStudentTCdfEvaluatedThenItMatchesTables)
+{
+    EXPECT_NEAR(Benchmarks::studentTCdf(0.0, 7.0), 0.5, 1e-12);
+    EXPECT_NEAR(Benchmarks::studentTCdf(2.228, 10.0), 0.975, 1e-4);
+    EXPECT_NEAR(Benchmarks::studentTCdf(-1.833, 9.0), 0.05, 1e-4);
+}
+
+TEST(ResultsStoreTest, WhenSlowdownIsLargeAndConsistentThenItIsARegression)
+{
+    const auto baseline = makeRecord(1.0, 0.01, 20);
+
+    const auto slower = Benchmarks::compareRecords(baseline, makeRecord(1.10, 0.01, 20), 0.05, 0.05);
+    EXPECT_TRUE(slower.regression);
+    EXPECT_NEAR(slower.change, 0.10, 1e-9);
+    EXPECT_LT(slower.pValue, 1e-6);
+
+    const auto noisy = Benchmarks::compareRecords(baseline, makeRecord(1.10, 0.5, 3), 0.05, 0.05);
+    EXPECT_FALSE(noisy.regression);
+
+    const auto faster = Benchmarks::compareRecords(baseline, makeRecord(0.9, 0.01, 20), 0.05, 0.05);
+    EXPECT_FALSE(faster.regression);
+    EXPECT_GT(faster.pValue, 0.5);
+}
+
+TEST(ResultsStoreTest, WhenRecordsAppendedThenLaterRunsFindThemAsBaselineAndUnchanged)
+{
+    const auto directory = std::filesystem::temp_directory_path() / "parallel_benchmark_results_store_test";
+    std::filesystem::remove_all(directory);
+
+    boost::json::object config;
+    config["order"] = 64;
+    const std::string configHash = Benchmarks::fnv1aHex(boost::json::serialize(config));
+
+    Benchmarks::ResultsStore first(directory);
+    first.load();
+    first.append(makeRecord(1.0, 0.01, 5), config, configHash);
+    EXPECT_FALSE(first.baseline(configHash, "latest"));
+
+    Benchmarks::ResultsStore second(directory);
+    second.load();
+    ASSERT_EQ(second.records().size(), 1u);
+
+    const auto baseline = second.baseline(configHash, "latest");
+    ASSERT_TRUE(baseline);
+    EXPECT_EQ(baseline->at("run_id").as_string(), first.runId());
+    EXPECT_TRUE(second.baseline(configHash, first.runId().substr(0, 8)));
+    EXPECT_FALSE(second.baseline(configHash, "latest", first.runId()));
+    EXPECT_FALSE(second.baseline("0000000000000000", "latest"));
+    EXPECT_TRUE(second.unchanged(configHash));
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(ResultsStoreTest, WhenRecordFailedVerificationThenItIsNeitherBaselineNorUnchanged)
+{
+    const auto directory = std::filesystem::temp_directory_path() / "parallel_benchmark_results_store_verify_test";
+    std::filesystem::remove_all(directory);
+
+    boost::json::object config;
+    config["order"] = 128;
+    const std::string configHash = Benchmarks::fnv1aHex(boost::json::serialize(config));
+
+    Benchmarks::ResultsStore first(directory);
+    first.load();
+    auto record = makeRecord(0.5, 0.01, 5);
+    record["verified"] = false;
+    first.append(record, config, configHash);
+
+    Benchmarks::ResultsStore second(directory);
+    second.load();
+    EXPECT_FALSE(second.baseline(configHash, "latest"));
+    EXPECT_FALSE(second.unchanged(configHash));
+
+    std::filesystem::remove_all(directory);
+}
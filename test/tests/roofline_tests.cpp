@@ -0,0 +1,22 @@
+#include "roofline.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RooflineTest, WhenWorkEstimatedThenFlopsAreTwiceTheMultiplyAdds)
+{
+    const auto naive = roofline::matMultWork(MatMultType::Naive, sizeof(float), 4, 4, 4);
+    const auto simd = roofline::matMultWork(MatMultType::Simd, sizeof(float), 6, 4, 4);
+
+    EXPECT_DOUBLE_EQ(naive.flops, 128.0);
+    EXPECT_DOUBLE_EQ(naive.bytes, sizeof(float) * (16.0 + 4 * 16.0 + 16.0));
+    EXPECT_DOUBLE_EQ(simd.bytes, sizeof(float) * (24.0 + 2 * 16.0 + 24.0));
+    EXPECT_GT(simd.intensity(), naive.intensity());
+}
+
+TEST(RooflineTest, WhenIntensityIsLowThenBandwidthBoundsTheRoofline)
+{
+    const roofline::Ceiling ceiling{100.0, 20.0};
+
+    EXPECT_DOUBLE_EQ(ceiling.boundGflops(0.5), 10.0);
+    EXPECT_DOUBLE_EQ(ceiling.boundGflops(50.0), 100.0);
+}
@@ -0,0 +1,64 @@
+#include "scaling.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Execution times of a kernel with serial fraction s on p workers, for fixed work of one unit per second.
+std::vector<Benchmarks::ScalingSample> amdahlSamples(double serialFraction)
+{
+    std::vector<Benchmarks::ScalingSample> samples;
+    for (uint32_t p : { 8u, 1u, 2u, 4u })
+    {
+        samples.push_back({p, 256, serialFraction + (1.0 - serialFraction) / p, 1.0});
+    }
+    return samples;
+}
+
+} // namespace
+
+TEST(ScalingTest, WhenStrongScalingFollowsAmdahlThenSerialFractionIsRecovered)
+{
+    const auto analysis = Benchmarks::analyzeScaling(amdahlSamples(0.1));
+
+    ASSERT_EQ(analysis.points.size(), 4u);
+    EXPECT_EQ(analysis.points.front().sample.workers, 1u);
+    EXPECT_DOUBLE_EQ(analysis.points.front().speedup, 1.0);
+    EXPECT_NEAR(analysis.points.back().speedup, 1.0 / (0.1 + 0.9 / 8), 1e-9);
+    EXPECT_NEAR(analysis.points.back().efficiency, analysis.points.back().speedup / 8, 1e-12);
+    EXPECT_NEAR(analysis.amdahlSerialFraction, 0.1, 1e-9);
+}
+
+TEST(ScalingTest, WhenWeakScalingIsPerfectThenEfficiencyIsOne)
+{
+    std::vector<Benchmarks::ScalingSample> samples;
+    for (uint32_t p : { 1u, 2u, 4u })
+    {
+        samples.push_back({p, 256, 2.0, 3.0 * p});
+    }
+
+    const auto analysis = Benchmarks::analyzeScaling(samples);
+
+    for (const auto &point : analysis.points)
+    {
+        EXPECT_NEAR(point.efficiency, 1.0, 1e-12);
+    }
+    EXPECT_NEAR(analysis.gustafsonSerialFraction, 0.0, 1e-12);
+    EXPECT_EQ(Benchmarks::weakScalingOrder(256, 1), 256);
+    EXPECT_EQ(Benchmarks::weakScalingOrder(256, 8), 512);
+    EXPECT_EQ(Benchmarks::weakScalingOrder(4096, 64), 4096);
+}
+
+TEST(ScalingTest, WhenListingWeakScalingThenOrderGrowsWithWorkers)
+{
+    const auto plan = Benchmarks::scalingPlan({ Benchmarks::ScalingKind::Weak }, { 256 },
+                                              { MatMultType::Simd, MatMultType::MultithreadSimd },
+                                              { MatMultDataType::Float }, { 1, 8 });
+    ASSERT_EQ(plan.size(), 2u);
+    EXPECT_NE(plan[0].find("256x256 threads=1"), std::string::npos);
+    EXPECT_NE(plan[1].find("512x512 threads=8"), std::string::npos);
+}
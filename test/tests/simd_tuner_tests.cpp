@@ -0,0 +1,67 @@
+#include "matrix.hpp"
+#include "simd_tuner.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <random>
+#include <vector>
+
+template<typename T>
+struct SimdTunerFixture : public ::testing::Test {};
+
+using SimdTunerTypes = ::testing::Types<int32_t, uint32_t, float, double>;
+TYPED_TEST_SUITE(SimdTunerFixture, SimdTunerTypes);
+
+TYPED_TEST(SimdTunerFixture, WhenAnyShapeMultipliesAwkwardShapesThenResultMatchesScalarReference)
+{
+    using T = TypeParam;
+    constexpr int M = 37;
+    constexpr int K = 29;
+    constexpr int N = 45;
+
+    std::mt19937 gen(3u);
+    std::uniform_int_distribution<int> distrib(0, 10);
+    std::vector<T> a(M * K);
+    std::vector<T> b(K * N);
+    std::ranges::generate(a, [&]() { return static_cast<T>(distrib(gen)); });
+    std::ranges::generate(b, [&]() { return static_cast<T>(distrib(gen)); });
+
+    std::vector<T> expected(M * N);
+    for (int i = 0; i < M; ++i)
+        for (int j = 0; j < N; ++j)
+            for (int k = 0; k < K; ++k)
+                expected[i * N + j] += a[i * K + k] * b[k * N + j];
+
+    for (size_t index = 0; index < simdTuner::MicroKernelShapes.size(); ++index)
+    {
+        std::vector<T> c(M * N);
+        simdRowKernels<T>[index](a.data(), b.data(), c.data(), N, K, 0, M, {});
+        EXPECT_EQ(c, expected) << simdTuner::MicroKernelShapes[index].description();
+    }
+}
+
+TEST(SimdTuningDatabaseTest, WhenSavedAndLoadedThenEntriesRoundTrip)
+{
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_simd_tuning_db_test.json";
+    std::filesystem::remove(path);
+
+    {
+        simdTuner::TuningDatabase database(path);
+        database.store("avx2+fma", "float", {{4, 3, 2}, 42.0});
+        database.save();
+    }
+
+    simdTuner::TuningDatabase database(path);
+    database.load();
+
+    const auto entry = database.lookup("avx2+fma", "float");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->shape, (simdTuner::MicroKernelShape{4, 3, 2}));
+    EXPECT_DOUBLE_EQ(entry->gflops, 42.0);
+    EXPECT_FALSE(database.lookup("avx2+fma", "double").has_value());
+    EXPECT_EQ(simdTuner::shapeIndexOf(entry->shape), 4u);
+    EXPECT_FALSE(simdTuner::shapeIndexOf({7, 7, 7}).has_value());
+
+    std::filesystem::remove(path);
+}
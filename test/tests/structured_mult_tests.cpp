@@ -0,0 +1,88 @@
+#include "structured_mult.hpp"
+#include "test_utils.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+namespace
+{
+
+template<typename T, int Rows, int Columns>
+Matrix<T, Columns, Rows> transposed(const Matrix<T, Rows, Columns> &a)
+{
+    Matrix<T, Columns, Rows> t;
+    structured::packTransposed(a.data().data(), Columns, Rows, Columns, t.data().data(), Rows);
+    return t;
+}
+
+}
+
+template<typename T>
+struct StructuredMultFixture : public ::testing::Test {};
+
+using StructuredMultTypes = ::testing::Types<int32_t, float, double>;
+TYPED_TEST_SUITE(StructuredMultFixture, StructuredMultTypes);
+
+// Odd shapes leave partial tiles on both edges and diagonal tiles that straddle the triangle.
+TYPED_TEST(StructuredMultFixture, WhenSyrkMirroredThenResultMatchesGeneralProduct)
+{
+    using T = TypeParam;
+    Matrix<T, 37, 29> a;
+    a.randomFill(1u);
+
+    const auto aat = a.template mult<MatMultType::Naive>(transposed(a));
+    testUtils::expectNear(structured::syrk<structured::Triangle::Lower>(a, true, 3), aat);
+    testUtils::expectNear(structured::syrk<structured::Triangle::Upper>(a, true, 2), aat);
+
+    const auto ata = transposed(a).template mult<MatMultType::Naive>(a);
+    testUtils::expectNear(structured::syrk<structured::Triangle::Lower, structured::Transpose::Yes>(a, true, 4), ata);
+}
+
+TYPED_TEST(StructuredMultFixture, WhenTrmmUsedThenOtherTriangleIsNotRead)
+{
+    using T = TypeParam;
+    Matrix<T, 37, 37> t;
+    Matrix<T, 37, 19> b;
+    t.randomFill(2u);
+    b.randomFill(3u);
+
+    Matrix<T, 37, 37> lower = t;
+    Matrix<T, 37, 37> upper = t;
+    for (int i = 0; i < 37; ++i)
+    {
+        for (int j = 0; j < 37; ++j)
+        {
+            if (j > i) lower(i, j) = T(0);
+            if (j < i) upper(i, j) = T(0);
+        }
+    }
+    testUtils::expectNear(structured::trmm<structured::Triangle::Lower>(t, b, 3), lower.template mult<MatMultType::Naive>(b));
+    testUtils::expectNear(structured::trmm<structured::Triangle::Upper>(t, b, 1), upper.template mult<MatMultType::Naive>(b));
+}
+
+TEST(StructuredMultTest, WhenWorkIsTriangularThenSplitBalancesIt)
+{
+    std::vector<int64_t> work(100);
+    for (int i = 0; i < 100; ++i) work[i] = i + 1;
+    const auto bounds = structured::balancedSplit(work, 4);
+    ASSERT_EQ(bounds.size(), 5u);
+    EXPECT_EQ(bounds.front(), 0);
+    EXPECT_EQ(bounds.back(), 100);
+    // Equal shares of a growing triangle end at n * sqrt(k / 4).
+    EXPECT_NEAR(bounds[1], 50, 1);
+    EXPECT_NEAR(bounds[2], 71, 1);
+    EXPECT_NEAR(bounds[3], 87, 1);
+}
+
+TEST(StructuredMultTest, WhenSyrkNotMirroredThenComputedTriangleIsComplete)
+{
+    Matrix<float, 21, 13> a;
+    a.randomFill(4u);
+    const auto full = structured::syrk<structured::Triangle::Lower>(a, true, 2);
+    const auto half = structured::syrk<structured::Triangle::Lower>(a, false, 2);
+    for (int i = 0; i < 21; ++i)
+    {
+        for (int j = 0; j <= i; ++j) EXPECT_EQ(half(i, j), full(i, j));
+    }
+}
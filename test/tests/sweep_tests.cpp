@@ -0,0 +1,94 @@
+#include "matrix_benchmark_prog_opts.hpp"
+#include "sweep.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+TEST(SweepTest, WhenRangeSpecExpandedThenProgressionIncludesBounds)
+{
+    EXPECT_EQ(MatBenchmarkProgOpts::expandRangeSpec("512"), (std::vector<int>{512}));
+    EXPECT_EQ(MatBenchmarkProgOpts::expandRangeSpec("128:4096:x2"), (std::vector<int>{128, 256, 512, 1024, 2048, 4096}));
+    EXPECT_EQ(MatBenchmarkProgOpts::expandRangeSpec("1:8"), (std::vector<int>{1, 2, 4, 8}));
+    EXPECT_EQ(MatBenchmarkProgOpts::expandRangeSpec("256:1000:+256"), (std::vector<int>{256, 512, 768}));
+}
+
+TEST(SweepTest, WhenRangeSpecIsMalformedThenItThrows)
+{
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("abc"), std::invalid_argument);
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("0"), std::invalid_argument);
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("-1"), std::invalid_argument);
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("512:128"), std::invalid_argument);
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("128:512:x1"), std::invalid_argument);
+    EXPECT_THROW(MatBenchmarkProgOpts::expandRangeSpec("128:512:*2"), std::invalid_argument);
+}
+
+TEST(SweepTest, WhenSweepExpandedThenOnlyThreadedKernelsAreRepeatedPerThreadCount)
+{
+    const Benchmarks::SweepSpec spec{
+        { 64, 128 },
+        { MatMultType::Simd, MatMultType::MultithreadSimd },
+        { MatMultDataType::Float },
+        { 1, 2, 4 }
+    };
+
+    const auto plan = Benchmarks::expandSweep(spec);
+
+    ASSERT_EQ(plan.size(), 8u);
+    EXPECT_EQ(plan[0].multType, MatMultType::Simd);
+    EXPECT_EQ(plan[0].threads, 0u);
+    EXPECT_EQ(plan[3].threads, 4u);
+    EXPECT_EQ(plan[4].order, 128);
+}
+
+TEST(SweepTest, WhenThreadPerElementKernelsExceedTheirOrderThenTheyAreLeftOut)
+{
+    const Benchmarks::SweepSpec spec{
+        { 64, 2048 },
+        { MatMultType::MultithreadElement, MatMultType::MultithreadRow, MatMultType::Simd },
+        { MatMultDataType::Float },
+        {}
+    };
+
+    const auto plan = Benchmarks::expandSweep(spec);
+
+    ASSERT_EQ(plan.size(), 4u);
+    EXPECT_EQ(plan[3].order, 2048);
+    EXPECT_EQ(plan[3].multType, MatMultType::Simd);
+}
+
+TEST(SweepTest, WhenEnumNamesParsedThenDoubleIsRecognized)
+{
+    EXPECT_EQ(util::fromString<MatMultDataType>("Double"), MatMultDataType::Double);
+    EXPECT_EQ(util::fromString<MatMultType>("tiledocl"), MatMultType::TiledOcl);
+    EXPECT_EQ(util::enumAll<MatMultType>().size(), static_cast<size_t>(MatMultType::Last));
+}
+
+TEST(SweepTest, WhenVerificationChangesThenPointConfigDiffers)
+{
+    const Benchmarks::SweepPoint point{ 64, MatMultType::Simd, MatMultDataType::Float, 0 };
+    RunnerConfig &runner = defaultRunnerConfig();
+    const auto saved = runner.verification;
+
+    const auto before = Benchmarks::sweepPointConfig(point);
+    runner.verification.rounds = saved.rounds + 1;
+    const auto after = Benchmarks::sweepPointConfig(point);
+    runner.verification = saved;
+
+    EXPECT_TRUE(before.contains("verification"));
+    EXPECT_NE(before, after);
+}
+
+TEST(SweepTest, WhenShapeRangeMissesCompiledOrdersThenTheyAreSkipped)
+{
+    using MatBenchmarkProgOpts::MatrixDimsOpt;
+    boost::any value;
+
+    MatBenchmarkProgOpts::validate(value, { "256:1024:+256" }, static_cast<MatrixDimsOpt *>(nullptr), 0);
+    EXPECT_EQ(boost::any_cast<MatrixDimsOpt>(value).opts, (std::vector<int>{256, 512, 1024}));
+
+    boost::any none;
+    EXPECT_THROW(MatBenchmarkProgOpts::validate(none, { "300:700:+100" }, static_cast<MatrixDimsOpt *>(nullptr), 0),
+                 std::invalid_argument);
+}
@@ -0,0 +1,113 @@
+#include "matrix.hpp"
+#include "thread_team.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+TEST(ThreadTeamTest, WhenJobRunThenEveryMemberRunsItOnce)
+{
+    ThreadTeam team(4);
+    std::vector<std::atomic<int>> calls(4);
+    for (int job = 0; job < 1000; ++job)
+    {
+        ASSERT_TRUE(team.tryRun(4, [&](int member, int count)
+        {
+            EXPECT_EQ(count, 4);
+            calls[member].fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    for (const auto &c : calls) EXPECT_EQ(c.load(), 1000);
+    EXPECT_EQ(team.jobsRun(), 1000u);
+}
+
+TEST(ThreadTeamTest, WhenCountBelowSizeThenRemainingMembersIdle)
+{
+    ThreadTeam team(4);
+    std::vector<std::atomic<int>> calls(4);
+    ASSERT_TRUE(team.tryRun(2, [&](int member, int) { calls[member].fetch_add(1); }));
+    EXPECT_EQ(calls[0].load(), 1);
+    EXPECT_EQ(calls[1].load(), 1);
+    EXPECT_EQ(calls[2].load(), 0);
+    EXPECT_EQ(calls[3].load(), 0);
+
+    EXPECT_FALSE(team.tryRun(5, [](int, int) {}));
+    EXPECT_FALSE(team.tryRun(0, [](int, int) {}));
+}
+
+TEST(ThreadTeamTest, WhenJobCountsVaryThenOnlyTheUsedMembersRun)
+{
+    ThreadTeam team(4);
+    std::vector<std::atomic<int>> calls(4);
+    for (int job = 0; job < 300; ++job)
+    {
+        const int count = 1 + job % 4;
+        ASSERT_TRUE(team.tryRun(count, [&](int member, int) { calls[member].fetch_add(1, std::memory_order_relaxed); }));
+    }
+    EXPECT_EQ(calls[0].load(), 300);
+    EXPECT_EQ(calls[1].load(), 225);
+    EXPECT_EQ(calls[2].load(), 150);
+    EXPECT_EQ(calls[3].load(), 75);
+}
+
+TEST(ThreadTeamTest, WhenTeamBusyThenTryRunRefuses)
+{
+    ThreadTeam team(2);
+    std::atomic<bool> nestedRan{true};
+    ASSERT_TRUE(team.tryRun(1, [&](int, int) { nestedRan = team.tryRun(1, [](int, int) {}); }));
+    EXPECT_FALSE(nestedRan.load());
+}
+
+TEST(ThreadTeamTest, WhenThreadsPassBarrierThenNoneRunsAhead)
+{
+    constexpr int threads = 3;
+    constexpr int phases = 500;
+    SpinBarrier barrier(threads);
+    std::atomic<int> arrived{0};
+    std::atomic<bool> ranAhead{false};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]()
+        {
+            for (int phase = 0; phase < phases; ++phase)
+            {
+                arrived.fetch_add(1);
+                barrier.arriveAndWait();
+                if (arrived.load() < (phase + 1) * threads) ranAhead = true;
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    EXPECT_FALSE(ranAhead.load());
+    EXPECT_EQ(arrived.load(), threads * phases);
+}
+
+TEST(ThreadTeamTest, WhenSmallProductRunOnSharedTeamThenResultMatchesNaive)
+{
+    Matrix<float, 67, 45> a;
+    Matrix<float, 45, 53> b;
+    a.randomFill(1u);
+    b.randomFill(2u);
+
+    const auto expected = a.mult<MatMultType::Naive>(b);
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+        const auto result = a.mult<MatMultType::MultithreadSimd>(b);
+        for (int i = 0; i < 67 * 53; ++i) ASSERT_NEAR(result[i], expected[i], 1e-4f * std::abs(expected[i]));
+    }
+}
+
+TEST(ThreadTeamTest, WhenSharedTeamRequestedSmallerThenLargestTeamIsReused)
+{
+    const auto large = sharedThreadTeam(5);
+    const auto small = sharedThreadTeam(2);
+
+    EXPECT_GE(large->size(), 5u);
+    EXPECT_EQ(small.get(), large.get());
+    EXPECT_TRUE(small->tryRun(2, [](int, int) {}));
+}
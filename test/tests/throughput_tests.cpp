@@ -0,0 +1,69 @@
+#include "throughput_benchmarks.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+using namespace Benchmarks;
+
+TEST(ThroughputTest, WhenPartitionedThenJobsGetEqualSlices)
+{
+    EXPECT_EQ(threadsPerJob(PoolMode::Shared, 4, 8), 8u);
+    EXPECT_EQ(threadsPerJob(PoolMode::Partitioned, 4, 8), 2u);
+    EXPECT_EQ(threadsPerJob(PoolMode::Partitioned, 3, 8), 2u);
+    EXPECT_EQ(threadsPerJob(PoolMode::Partitioned, 16, 8), 1u);
+    EXPECT_THROW(poolModesFromString("pinned"), std::invalid_argument);
+    EXPECT_EQ(poolModesFromString("Both").size(), 2u);
+}
+
+TEST(ThroughputTest, WhenJobsRunConcurrentlyThenEveryProductIsTimedAndVerified)
+{
+    RunnerConfig config;
+    config.warmupIterations = 1;
+    config.minIterations = 4;
+    config.maxIterations = 4;
+
+    const auto sample = runConcurrentJobs<float, 64, MatMultType::MultithreadSimd>(3, 2, config);
+    EXPECT_EQ(sample.jobs, 3u);
+    EXPECT_EQ(sample.threadsPerJob, 2u);
+    EXPECT_EQ(sample.latencies.size(), 12u);
+    EXPECT_GT(sample.wallSeconds, 0.0);
+    ASSERT_TRUE(sample.verification.has_value());
+    EXPECT_TRUE(sample.verification->passed);
+}
+
+TEST(ThroughputTest, WhenJobsContendThenSlowdownIsRelativeToIsolatedMedian)
+{
+    ThroughputSample isolated;
+    isolated.latencies = { 1.0, 1.0, 1.0 };
+    isolated.wallSeconds = 3.0;
+
+    ThroughputSample sample;
+    sample.jobs = 2;
+    sample.threadsPerJob = 4;
+    sample.latencies = { 1.5, 1.5, 1.5, 1.5 };
+    sample.wallSeconds = 3.0;
+
+    const auto obj = throughputJson(MatMultType::MultithreadSimd, PoolMode::Partitioned, sample, isolated, 1e9);
+    EXPECT_EQ(obj.at("pool").as_string(), "partitioned");
+    EXPECT_EQ(obj.at("products").to_number<uint64_t>(), 4u);
+    EXPECT_DOUBLE_EQ(obj.at("aggregate_gflops").to_number<double>(), 4.0 / 3.0);
+    EXPECT_DOUBLE_EQ(obj.at("slowdown_vs_isolated").to_number<double>(), 1.5);
+    EXPECT_DOUBLE_EQ(obj.at("throughput_vs_isolated").to_number<double>(), 4.0 / 3.0);
+    EXPECT_FALSE(obj.contains("verified"));
+
+    const auto unpooled = throughputJson(MatMultType::Simd, std::nullopt, sample, isolated, 1e9);
+    EXPECT_FALSE(unpooled.contains("pool"));
+    EXPECT_FALSE(unpooled.contains("threads_per_job"));
+}
+
+TEST(ThroughputTest, WhenListingThenOnlyHostThreadKernelsRepeatPerPoolMode)
+{
+    const auto plan = throughputPlan({ 64 }, { MatMultType::Simd, MatMultType::MultithreadSimd },
+                                     { MatMultDataType::Float }, { 1, 2 }, { PoolMode::Shared, PoolMode::Partitioned });
+    ASSERT_EQ(plan.size(), 6u);
+    EXPECT_EQ(plan[0].find("pool="), std::string::npos);
+    EXPECT_NE(plan[2].find("jobs=1 pool=shared"), std::string::npos);
+    EXPECT_NE(plan[5].find("jobs=2 pool=partitioned"), std::string::npos);
+}
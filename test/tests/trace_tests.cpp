@@ -0,0 +1,75 @@
+#include "trace.hpp"
+
+#include <boost/json.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+TEST(TraceTest, WhenDisabledThenScopesRecordNothing)
+{
+    trace::setEnabled(false);
+    trace::clear();
+    {
+        trace::Scope scope("disabled");
+    }
+    EXPECT_EQ(trace::eventCount(), 0u);
+}
+
+TEST(TraceTest, WhenEnabledThenThreadsAndTracksAreWrittenAsChromeTrace)
+{
+    trace::clear();
+    trace::setEnabled(true);
+    {
+        trace::Scope outer("outer", "test");
+        std::thread worker([]()
+        {
+            trace::setThreadName("worker");
+            trace::Scope inner("inner", "test");
+        });
+        worker.join();
+        trace::recordTrackEvent("device", "kernel", "opencl", trace::nowNs(), trace::nowNs() + 1000);
+    }
+    trace::setEnabled(false);
+    EXPECT_EQ(trace::eventCount(), 3u);
+
+    const auto path = std::filesystem::temp_directory_path() / "parallel_benchmark_trace_test.json";
+    trace::writeChromeTrace(path);
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const auto root = boost::json::parse(ss.str()).as_object();
+    std::filesystem::remove(path);
+
+    size_t complete = 0;
+    bool namedWorker = false;
+    for (const auto &value : root.at("traceEvents").as_array())
+    {
+        const auto &event = value.as_object();
+        if (event.at("ph").as_string() == "X") ++complete;
+        if (event.at("ph").as_string() == "M" && event.at("args").at("name").as_string() == "worker") namedWorker = true;
+    }
+    EXPECT_EQ(complete, 3u);
+    EXPECT_TRUE(namedWorker);
+    trace::clear();
+}
+
+TEST(TraceTest, WhenManyShortLivedThreadsTraceThenOnlyRecentOnesAreKept)
+{
+    trace::clear();
+    trace::setEnabled(true);
+    for (int i = 0; i < 200; ++i)
+    {
+        std::thread worker([]() { trace::Scope scope("short", "test"); });
+        worker.join();
+    }
+    trace::setEnabled(false);
+
+    EXPECT_GT(trace::eventCount(), 0u);
+    EXPECT_LT(trace::eventCount(), 200u);
+    EXPECT_EQ(trace::eventCount() + trace::droppedEventCount(), 200u);
+    trace::clear();
+}
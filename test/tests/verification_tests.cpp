@@ -0,0 +1,80 @@
+#include "matrix.hpp"
+#include "test_utils.hpp"
+#include "verification.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+
+template<typename T>
+struct VerificationFixture : public ::testing::Test, public testUtils::RandomOperands<T>
+{
+    static constexpr int Order = testUtils::ODD_ORDER;
+
+    VerificationFixture()
+    {
+        c = this->a.template mult<MatMultType::Simd>(this->b);
+    }
+
+    verification::Result check(uint64_t seed = 7) const
+    {
+        return verification::freivalds(this->a.data().data(), this->b.data().data(), c.data().data(), Order, Order,
+                                       Order, verification::Config{}, seed);
+    }
+
+    Matrix<T, Order, Order> c;
+};
+
+using VerificationTypes = ::testing::Types<int32_t, uint32_t, float, double>;
+TYPED_TEST_SUITE(VerificationFixture, VerificationTypes);
+
+TYPED_TEST(VerificationFixture, WhenProductIsCorrectThenAllRoundsPass)
+{
+    const auto result = this->check();
+    EXPECT_TRUE(result.passed);
+    EXPECT_EQ(result.rounds, verification::Config{}.rounds);
+    EXPECT_EQ(result.failedRow, -1);
+}
+
+TYPED_TEST(VerificationFixture, WhenOneElementIsWrongThenItsRowIsReported)
+{
+    this->c(23, 11) = this->c(23, 11) * TypeParam(2) + TypeParam(1);
+    // A {0, 1} vector misses the element with probability 1/2 per round, so try a few seeds.
+    bool detected = false;
+    for (uint64_t seed = 0; seed < 8 && not detected; ++seed)
+    {
+        const auto result = this->check(seed);
+        detected = not result.passed;
+        if (detected)
+        {
+            EXPECT_EQ(result.failedRow, 23);
+        }
+    }
+    EXPECT_TRUE(detected);
+}
+
+TEST(VerificationTest, WhenResultHoldsNanThenItFails)
+{
+    Matrix<float, 8, 8> a;
+    Matrix<float, 8, 8> b;
+    a.randomFill(3u);
+    b.randomFill(4u);
+    auto c = a.mult<MatMultType::Naive>(b);
+    c(5, 2) = std::numeric_limits<float>::quiet_NaN();
+    const auto result = verification::freivalds(a.data().data(), b.data().data(), c.data().data(), 8, 8, 8,
+                                                verification::Config{}, 1);
+    EXPECT_FALSE(result.passed);
+    EXPECT_EQ(result.failedRow, 5);
+    EXPECT_FALSE(result.toJson().contains("max_relative_error"));
+}
+
+TEST(VerificationTest, WhenRecordIsFlaggedThenItCountsAsFailed)
+{
+    boost::json::object record;
+    EXPECT_FALSE(verification::failed(record));
+    record["verified"] = true;
+    EXPECT_FALSE(verification::failed(record));
+    record["verified"] = false;
+    EXPECT_TRUE(verification::failed(record));
+}